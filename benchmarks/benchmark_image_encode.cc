@@ -0,0 +1,128 @@
+/*
+ * Project: libxviz
+ * Description: C++ Implementation of XVIZ Protocol
+ * Author: Minjun Xu (mjxu96@outlook.com)
+ * -----
+ * MIT License
+ * Copyright (c) 2023 Minjun Xu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <xviz/xviz.h>
+#include <xviz/utils/image_encoder.h>
+
+#include <google/protobuf/stubs/common.h>
+
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace xviz;
+
+constexpr uint32_t kWidth = 1920;
+constexpr uint32_t kHeight = 1080;
+constexpr int kCameraCount = 6;
+constexpr int kRepeat = 10;
+
+struct Timing {
+  double build_ms{0};
+  double frame_ms{0};
+};
+
+// build_ms is the time the producer thread is blocked in Image(), frame_ms
+// includes joining the encoded images in GetData(). The default encoder
+// writes stored PNG, so this measures copying and checksumming the pixels,
+// not compression.
+Timing Measure(const std::function<void(Builder&)>& add_images,
+               Builder& builder) {
+  Timing timing;
+  for (int i = 0; i < kRepeat; i++) {
+    builder.Reset();
+    auto start = std::chrono::steady_clock::now();
+    add_images(builder);
+    auto built = std::chrono::steady_clock::now();
+    builder.GetData();
+    auto end = std::chrono::steady_clock::now();
+    timing.build_ms +=
+        std::chrono::duration<double, std::milli>(built - start).count();
+    timing.frame_ms +=
+        std::chrono::duration<double, std::milli>(end - start).count();
+  }
+  timing.build_ms /= kRepeat;
+  timing.frame_ms /= kRepeat;
+  return timing;
+}
+
+int main() {
+  std::vector<std::vector<uint8_t>> frames(kCameraCount);
+  std::vector<std::string> stream_ids;
+  for (int camera = 0; camera < kCameraCount; camera++) {
+    frames[camera].resize(std::size_t(kWidth) * kHeight * 3);
+    for (std::size_t i = 0; i < frames[camera].size(); i++) {
+      frames[camera][i] = static_cast<uint8_t>(i * (camera + 1));
+    }
+    stream_ids.push_back("/camera/" + std::to_string(camera));
+  }
+
+  std::cout << kCameraCount << " cameras, " << kWidth << "x" << kHeight
+            << " RGB, uncompressed PNG" << std::endl;
+
+  Builder builder;
+  std::vector<PngStoreEncoder> encoders(kCameraCount);
+  auto sync = Measure(
+      [&](Builder& builder) {
+        for (int camera = 0; camera < kCameraCount; camera++) {
+          std::string encoded;
+          encoders[camera].Encode(
+              {frames[camera], kWidth, kHeight, PixelFormat::RGB8}, {},
+              encoded);
+          builder.Primitive(stream_ids[camera]).Image(std::move(encoded));
+        }
+      },
+      builder);
+  std::cout << "encode on the build thread: build " << sync.build_ms
+            << " ms, frame " << sync.frame_ms << " ms" << std::endl;
+
+  for (std::size_t threads : {1u, 2u, 4u, 6u}) {
+    ImageEncoderPool pool(threads);
+    builder.ImageEncoders(pool);
+    for (uint32_t width : {0u, kWidth / 2}) {
+      ImageEncodeOption option;
+      option.width = width;
+      auto pooled = Measure(
+          [&](Builder& builder) {
+            for (int camera = 0; camera < kCameraCount; camera++) {
+              builder.Primitive(stream_ids[camera])
+                  .Image({frames[camera], kWidth, kHeight, PixelFormat::RGB8},
+                         option);
+            }
+          },
+          builder);
+      std::cout << threads << " encoder threads" << (width ? ", half size" : "")
+                << ": build " << pooled.build_ms << " ms, frame "
+                << pooled.frame_ms << " ms" << std::endl;
+    }
+    builder.Reset();
+  }
+
+  google::protobuf::ShutdownProtobufLibrary();
+}
@@ -0,0 +1,101 @@
+/*
+ * Project: libxviz
+ * Description: C++ Implementation of XVIZ Protocol
+ * Author: Minjun Xu (mjxu96@outlook.com)
+ * -----
+ * MIT License
+ * Copyright (c) 2023 Minjun Xu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <xviz/xviz.h>
+#include <xviz/utils/thread_pool.h>
+
+#include <google/protobuf/stubs/common.h>
+
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace xviz;
+
+constexpr std::size_t kPointCount = 200'000;
+constexpr int kObjectCount = 200;
+constexpr int kRepeat = 3;
+
+double Measure(const std::function<std::size_t()>& func, std::size_t& size) {
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < kRepeat; i++) {
+    size = func();
+  }
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::milli>(end - start).count() /
+         kRepeat;
+}
+
+int main() {
+  std::mt19937 rng(42);
+  std::uniform_real_distribution<float> coordinate(-50.0f, 50.0f);
+  std::vector<float> points(kPointCount * 3);
+  for (auto& value : points) {
+    value = coordinate(rng);
+  }
+
+  Builder builder;
+  builder.Timestamp(1000)
+      .Pose("/vehicle_pose")
+      .Position(1, 2, 3)
+      .Primitive("/lidar/points")
+      .Point(points);
+  for (int i = 0; i < kObjectCount; i++) {
+    float x = coordinate(rng);
+    float y = coordinate(rng);
+    builder.Primitive("/tracking/objects")
+        .Polygon({{x, y, 0}, {x + 4, y, 0}, {x + 4, y + 2, 0}, {x, y + 2, 0}})
+        .ID("object_" + std::to_string(i));
+  }
+  builder.TimeSeries("/vehicle/speed").Timestamp(1000).Value(10.0);
+  const auto& data = builder.GetData();
+
+  std::cout << kPointCount << " points, " << kObjectCount << " objects, "
+            << util::ThreadPool::Shared().Size() << " pool threads"
+            << std::endl;
+
+  Encoder sequential;
+  std::string expected(sequential.ToJsonString(data));
+  std::size_t size = 0;
+  double ms =
+      Measure([&]() { return sequential.ToJsonString(data).size(); }, size);
+  std::cout << "sequential: " << ms << " ms, " << size << " bytes"
+            << std::endl;
+
+  for (uint32_t threads : {1u, 2u, 4u, 8u}) {
+    Encoder parallel(ParallelWriteOption{.thread_count = threads});
+    bool identical = parallel.ToJsonString(data) == expected;
+    ms = Measure([&]() { return parallel.ToJsonString(data).size(); }, size);
+    std::cout << threads << " threads: " << ms << " ms, " << size << " bytes"
+              << (identical ? "" : ", NOT IDENTICAL") << std::endl;
+  }
+
+  google::protobuf::ShutdownProtobufLibrary();
+}
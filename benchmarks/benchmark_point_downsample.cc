@@ -0,0 +1,128 @@
+/*
+ * Project: libxviz
+ * Description: C++ Implementation of XVIZ Protocol
+ * Author: Minjun Xu (mjxu96@outlook.com)
+ * -----
+ * MIT License
+ * Copyright (c) 2023 Minjun Xu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <xviz/xviz.h>
+#include <xviz/utils/point_cloud.h>
+#include <xviz/utils/thread_pool.h>
+
+#include <google/protobuf/stubs/common.h>
+
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace xviz;
+
+constexpr std::size_t kPointCount = 1'000'000;
+constexpr int kRepeat = 10;
+
+std::vector<float> GeneratePoints() {
+  // points roughly shaped like a LiDAR sweep around the origin
+  std::mt19937 rng(42);
+  std::uniform_real_distribution<float> angle(0.0f, 6.2831853f);
+  std::exponential_distribution<float> range(0.05f);
+  std::uniform_real_distribution<float> height(-2.0f, 3.0f);
+  std::vector<float> points;
+  points.reserve(kPointCount * 3);
+  for (std::size_t i = 0; i < kPointCount; i++) {
+    float a = angle(rng);
+    float r = 1.0f + range(rng);
+    points.push_back(r * std::cos(a));
+    points.push_back(r * std::sin(a));
+    points.push_back(height(rng));
+  }
+  return points;
+}
+
+double Measure(const std::function<std::size_t()>& func, std::size_t& kept) {
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < kRepeat; i++) {
+    kept = func();
+  }
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::milli>(end - start).count() /
+         kRepeat;
+}
+
+int main() {
+  auto points = GeneratePoints();
+  std::vector<uint8_t> colors(kPointCount * 4, 255);
+
+  std::vector<std::pair<std::string, PointDownsampleOption>> cases = {
+      {"voxel grid 0.2m", PointDownsampleOption::VoxelGrid(0.2f)},
+      {"uniform stride 4", PointDownsampleOption::Uniform(4)},
+      {"random 25%", PointDownsampleOption::Random(0.25f)},
+      {"distance weighted", PointDownsampleOption::DistanceWeighted(20, 0.1f)},
+  };
+  std::vector<PointDownsampleOption> lod_levels = {
+      PointDownsampleOption::VoxelGrid(0.05f),
+      PointDownsampleOption::VoxelGrid(0.2f),
+      PointDownsampleOption::VoxelGrid(0.8f)};
+
+  std::cout << kPointCount << " points, "
+            << util::ThreadPool::Shared().Size() << " pool threads"
+            << std::endl;
+  for (uint32_t threads : {1u, 2u, 4u, 8u}) {
+    for (const auto& [name, option] : cases) {
+      std::size_t kept = 0;
+      double ms = Measure(
+          [&]() {
+            return util::DownsamplePoints(points, option, threads).size();
+          },
+          kept);
+      std::cout << threads << " threads, " << name << ": " << ms << " ms, "
+                << kept << " kept" << std::endl;
+    }
+    std::size_t kept = 0;
+    double ms = Measure(
+        [&]() {
+          return util::DownsamplePoints(points, lod_levels, threads)
+              .back()
+              .size();
+        },
+        kept);
+    std::cout << threads << " threads, 3 voxel LODs: " << ms << " ms, " << kept
+              << " kept at lod2" << std::endl;
+  }
+
+  // end to end, building three LOD streams with colors
+  Builder builder;
+  std::size_t kept = 0;
+  double ms = Measure(
+      [&]() {
+        builder.Reset();
+        builder.PointLOD({"/lidar/lod0", "/lidar/lod1", "/lidar/lod2"}, points,
+                         lod_levels, colors);
+        return builder.GetData().updates(0).primitives().size();
+      },
+      kept);
+  std::cout << "Builder::PointLOD with colors: " << ms << " ms" << std::endl;
+
+  google::protobuf::ShutdownProtobufLibrary();
+}
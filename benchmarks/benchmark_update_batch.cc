@@ -0,0 +1,92 @@
+/*
+ * Project: libxviz
+ * Description: C++ Implementation of XVIZ Protocol
+ * Author: Minjun Xu (mjxu96@outlook.com)
+ * -----
+ * MIT License
+ * Copyright (c) 2023 Minjun Xu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <xviz/xviz.h>
+
+#include <google/protobuf/stubs/common.h>
+
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+using namespace xviz;
+
+// ten seconds of a 10Hz log
+constexpr int kFrameCount = 100;
+constexpr int kRepeat = 20;
+constexpr int kObjectCount = 20;
+
+void BuildFrame(Builder& builder, int frame) {
+  double timestamp = 1000 + frame * 0.1;
+  builder.Timestamp(timestamp)
+      .Pose("/vehicle_pose")
+      .Timestamp(timestamp)
+      .Position(frame, 0, 0)
+      .Orientation(0, 0, 0);
+  for (int i = 0; i < kObjectCount; i++) {
+    float x = frame + i * 2.0f;
+    builder.Primitive("/object/shape")
+        .Polygon({{x, 0, 0}, {x + 1, 0, 0}, {x + 1, 1, 0}, {x, 1, 0}})
+        .ID("object_" + std::to_string(i));
+  }
+  builder.TimeSeries("/vehicle/speed").Timestamp(timestamp).Value(10.0);
+}
+
+int main() {
+  Builder builder;
+  Encoder encoder;
+
+  for (std::size_t batch : {1, 5, 10, 50}) {
+    std::size_t messages = 0;
+    std::size_t bytes = 0;
+    UpdateBatcher batcher(
+        [&](Frame&& frame) {
+          messages++;
+          bytes += encoder.ToProtobufBinary(frame).size();
+        },
+        {.max_updates = batch, .max_window = kFrameCount});
+
+    auto start = std::chrono::steady_clock::now();
+    for (int repeat = 0; repeat < kRepeat; repeat++) {
+      for (int frame = 0; frame < kFrameCount; frame++) {
+        BuildFrame(builder, frame);
+        batcher.Add(builder.Finish());
+      }
+      batcher.Flush();
+    }
+    auto end = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(end - start).count();
+
+    std::cout << "batch " << batch << ": " << messages / seconds
+              << " messages/s, " << kFrameCount * kRepeat / seconds
+              << " frames/s, " << bytes / (kFrameCount * kRepeat)
+              << " bytes/frame, " << bytes / messages << " bytes/message"
+              << std::endl;
+  }
+
+  google::protobuf::ShutdownProtobufLibrary();
+}
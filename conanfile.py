@@ -14,14 +14,18 @@ class XVIZ(ConanFile):
         "fPIC": [True, False],
         "build_tests": [True, False],
         "build_examples": [True, False],
+        "build_benchmarks": [True, False],
         "coverage": [True, False],
+        "metrics": [True, False],
     }
     default_options = {
         "shared": False,
         "fPIC": True,
         "build_tests": False,
         "build_examples": False,
+        "build_benchmarks": False,
         "coverage": False,
+        "metrics": False,
     }
 
     # Sources are located in the same place as this recipe, copy them to the recipe
@@ -34,7 +38,8 @@ class XVIZ(ConanFile):
         "README.md",
         "LICENSE.md",
         "tests/*",
-        "examples/*"
+        "examples/*",
+        "benchmarks/*"
     )
 
     def _configure_cmake(self) -> CMake:
@@ -44,8 +49,12 @@ class XVIZ(ConanFile):
             variables["XVIZ_BUILD_TESTS"] = "ON"
         if self.options.build_examples:
             variables["XVIZ_BUILD_EXAMPLES"] = "ON"
+        if self.options.build_benchmarks:
+            variables["XVIZ_BUILD_BENCHMARKS"] = "ON"
         if self.options.coverage:
             variables["XVIZ_TEST_COVERAGE"] = "ON"
+        if self.options.metrics:
+            variables["XVIZ_ENABLE_METRICS"] = "ON"
         cmake.configure(variables=variables)
         return cmake
 
@@ -35,8 +35,15 @@
 
 #include <lodepng.h>
 
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <cstdlib>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
 
 using namespace xviz;
 
@@ -53,6 +60,24 @@ std::vector<unsigned char> image = {
     0x00, 0x00, 0x01, 0x9A, 0x60, 0xE1, 0xD5, 0x00, 0x00, 0x00, 0x00, 0x49,
     0x45, 0x4E, 0x44, 0xAE, 0x42, 0x60, 0x82};
 
+// shared by all the frames instead of being copied into each of them
+xviz::ImageBuffer image_buffer;
+// the producer thread takes a builder from here for each frame
+xviz::BuilderPool builder_pool;
+// latest state of the published streams for the viewers that join later
+xviz::StateCache state_cache;
+// recent samples of the plotted streams, sent to the viewers that join later
+xviz::TimeSeriesHistory history;
+
+// Frames are built, recorded and encoded once by the producer thread, and
+// every connection's thread sends the latest one. Building them per
+// connection would record each frame once per viewer.
+std::mutex published_mutex;
+std::condition_variable published_cv;
+std::shared_ptr<const std::string> published_update;
+uint64_t published_count = 0;
+std::atomic<bool> running = true;
+
 xviz::Message<xviz::Metadata> GetMetadata() {
   xviz::MetadataBuilder meta_builder;
 
@@ -148,15 +173,14 @@ xviz::Message<xviz::Metadata> GetMetadata() {
   return xviz::Message<xviz::Metadata>(std::move(metadata));
 }
 
-xviz::Message<xviz::StateUpdate> GetUpdate(float x) {
+xviz::Frame GetUpdate(float x) {
   auto now = std::chrono::duration<double>(
                  std::chrono::high_resolution_clock::now().time_since_epoch())
                  .count();
 
-  xviz::Builder builder;
-  builder.Reset();
+  auto builder = builder_pool.Acquire();
   // clang-format off
-  auto& a = builder
+  (*builder)
     .Timestamp(now)
     .Pose("/vehicle_pose")
       .MapOrigin(0, 0, 0)
@@ -185,9 +209,9 @@ xviz::Message<xviz::StateUpdate> GetUpdate(float x) {
       .Polyline({{x, 0, 0}, {13, 6, 0}, {13, 6, 10}})
       .Polyline({{x, 30, 0}, {13, 6, 0}, {13, 6, 10}})
     .Primitive("/sensor/camera/1")
-      .Image(image.data(), image.size())
+      .Image(image_buffer)
     .Primitive("/sensor/camera/2")
-      .Image(image.data(), image.size())
+      .Image(image_buffer)
     .Primitive("/other/text/1")
       .Text("Hello World!")
       .Position({0, 0, 10})
@@ -202,11 +226,32 @@ xviz::Message<xviz::StateUpdate> GetUpdate(float x) {
       .Value(3.0)
     .TimeSeries("/vehicle/acceleration")
       .Timestamp(now)
-      .Value(3.0)
-    .GetData();
+      .Value(3.0);
   // clang-format on
 
-  return xviz::Message<xviz::StateUpdate>(std::move(a));
+  return builder->Finish();
+}
+
+void PublishPeriodically() {
+  float x = 10;
+  // keeps its buffers across frames
+  xviz::Encoder encoder;
+  while (running) {
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+    x += 10;
+    xviz::trace::Span span("PublishPeriodically", "server");
+    auto frame = std::make_shared<const xviz::Frame>(GetUpdate(x));
+    state_cache.Update(frame);
+    history.Record(frame->Data());
+    auto update_string =
+        std::make_shared<const std::string>(encoder.ToProtobufBinary(*frame));
+    {
+      std::lock_guard<std::mutex> lock(published_mutex);
+      published_update = std::move(update_string);
+      published_count++;
+    }
+    published_cv.notify_all();
+  }
 }
 
 void UpdatePeriodcally(
@@ -217,12 +262,41 @@ void UpdatePeriodcally(
   conn->send(metadata_string.data(), metadata_string.size(),
              websocketpp::frame::opcode::binary);
   std::error_code err;
-  float x = 10;
+  uint64_t sent_count = 0;
+  {
+    std::lock_guard<std::mutex> lock(published_mutex);
+    sent_count = published_count;
+  }
+  xviz::Encoder encoder;
+  if (state_cache.StreamCount() > 0) {
+    auto snapshot_string = encoder.ToProtobufBinary(state_cache.Snapshot());
+    err = conn->send(snapshot_string.data(), snapshot_string.size(),
+                     websocketpp::frame::opcode::binary);
+  }
+  for (const auto& backfill : history.Backfill()) {
+    if (err) {
+      break;
+    }
+    auto backfill_string = encoder.ToProtobufBinary(backfill);
+    err = conn->send(backfill_string.data(), backfill_string.size(),
+                     websocketpp::frame::opcode::binary);
+  }
   while (!err) {
-    std::this_thread::sleep_for(std::chrono::seconds(1));
-    x += 10;
-    auto update_string = GetUpdate(x).ToProtobufBinary();
-    err = conn->send(update_string.data(), update_string.size(),
+    std::shared_ptr<const std::string> update_string;
+    {
+      std::unique_lock<std::mutex> lock(published_mutex);
+      published_cv.wait(lock, [&sent_count]() {
+        return published_count != sent_count || !running;
+      });
+      if (!running) {
+        break;
+      }
+      // a slow viewer skips the frames published while it was sending
+      sent_count = published_count;
+      update_string = published_update;
+    }
+    xviz::trace::Span send_span("send", "server");
+    err = conn->send(update_string->data(), update_string->size(),
                      websocketpp::frame::opcode::binary);
   }
   std::cout << "disconnected " << err << std::endl;
@@ -241,6 +315,9 @@ void CheckBytes() {
 
 int main(int argc, char* argv[]) {
   CheckBytes();
+  if (std::getenv("XVIZ_TRACE")) {
+    xviz::trace::Enable();
+  }
   server.init_asio();
   server.set_reuse_addr(true);
 
@@ -250,7 +327,12 @@ int main(int argc, char* argv[]) {
   } else {
     std::cout << "no png file provided, will use a default one" << std::endl;
   }
+  image_buffer = xviz::ImageBuffer(
+      std::make_shared<const std::vector<unsigned char>>(image));
+  history.Register("/metric/steer");
+  history.Register("/vehicle/acceleration");
 
+  std::thread producer(PublishPeriodically);
   std::vector<std::thread> threads;
 
   server.set_open_handler([&](websocketpp::connection_hdl hdl) {
@@ -259,11 +341,37 @@ int main(int argc, char* argv[]) {
     threads.emplace_back(std::bind(UpdatePeriodcally, conn));
   });
 
+  // /metrics is scraped by monitoring, its counters stay empty unless the
+  // library is built with XVIZ_ENABLE_METRICS. /trace dumps the spans
+  // recorded when the server runs with XVIZ_TRACE set.
+  server.set_http_handler([&](websocketpp::connection_hdl hdl) {
+    auto conn = server.get_con_from_hdl(hdl);
+    if (conn->get_resource() == "/metrics") {
+      conn->set_body(xviz::Metrics::Global().Snapshot().ToPrometheus());
+      conn->append_header("Content-Type", "text/plain; version=0.0.4");
+    } else if (conn->get_resource() == "/trace") {
+      // open in chrome://tracing or ui.perfetto.dev
+      conn->set_body(xviz::trace::DumpChromeTrace());
+      conn->append_header("Content-Type", "application/json");
+    } else {
+      conn->set_status(websocketpp::http::status_code::not_found);
+      return;
+    }
+    conn->set_status(websocketpp::http::status_code::ok);
+  });
+
   server.listen(8081);
   server.start_accept();
 
   server.run();
 
+  {
+    // under the lock, a waiting connection could miss it otherwise
+    std::lock_guard<std::mutex> lock(published_mutex);
+    running = false;
+  }
+  published_cv.notify_all();
+  producer.join();
   for (auto& th : threads) {
     th.join();
   }
@@ -31,29 +31,88 @@
 #include "time_series.h"
 #include "ui_primitive.h"
 
+#include <xviz/builder/frame.h>
 #include <xviz/builder/metadata/metadata.h>
 #include <xviz/builder/primitive/primitive.h>
+#include <xviz/builder/schema.h>
+#include <xviz/builder/stream_registry.h>
+#include <xviz/utils/image_buffer.h>
+#include <xviz/utils/hash.h>
+#include <xviz/utils/image_encoder.h>
+#include <xviz/utils/metrics.h>
+#include <xviz/utils/trace.h>
+#include <xviz/utils/time_series.h>
+#include <xviz/validator/validator.h>
+
+#include <algorithm>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <string_view>
+#include <tuple>
+#include <unordered_map>
 
 namespace xviz {
 
 class Builder {
  public:
-  Builder()
+  // Finished frames give their StateUpdate back to `recycler` if one is
+  // given, see BuilderPool
+  explicit Builder(std::shared_ptr<StateUpdateRecycler> recycler = nullptr)
       : pose_builder_(*this),
         primitive_builder_(*this),
         time_series_builder_(*this),
-        ui_primitive_builder_(*this) {
+        ui_primitive_builder_(*this),
+        schema_primitive_builders_(*this, *this, *this, *this, *this, *this),
+        schema_time_series_builders_(*this, *this, *this, *this),
+        recycler_(std::move(recycler)) {
     Reset();
   }
 
+  // Waits for the pending image encodes, like Reset()
+  ~Builder() { WaitForImages(); }
+
+  Builder(const Builder&) = delete;
+  Builder& operator=(const Builder&) = delete;
+
   void Reset() {
-    data_.Clear();
-    data_.set_update_type(StateUpdate::SNAPSHOT);
-    data_.add_updates();
+    WaitForImages();
+    image_buffers_.clear();
+    image_fingerprints_.clear();
+    primitive_stream_id_ = nullptr;
+    metrics_.Reset();
+    validated_ = false;
+    trace_.End();
+    ClearSlots(pose_slots_);
+    ClearSlots(primitive_slots_);
+    ClearSlots(ui_primitive_slots_);
+    ClearSlots(schema_pose_slots_);
+    ClearSlots(schema_primitive_slots_);
+    generation_++;
+    if (!data_) {
+      data_ =
+          recycler_ ? recycler_->Acquire() : std::make_unique<StateUpdate>();
+    }
+    data_->Clear();
+    data_->set_update_type(StateUpdate::SNAPSHOT);
+    update_ = data_->add_updates();
   }
 
+  // Starts another StreamSet in the same StateUpdate, e.g. for the next
+  // timestamp during playback. The calls after it build the new StreamSet.
+  Builder& NextUpdate() {
+    EndBuilders();
+    FlushAllSlots();
+    DropUnchangedImages();
+    update_ = data_->add_updates();
+    return *this;
+  }
+
+  // Number of StreamSets in the StateUpdate being built
+  int UpdateCount() const { return data_->updates_size(); }
+
   Builder& Timestamp(double timestamp) {
-    data_.mutable_updates()->at(0).set_timestamp(timestamp);
+    update_->set_timestamp(timestamp);
     return *this;
   }
 
@@ -62,83 +121,557 @@ class Builder {
     pose_builder_.End();
     std::string stream_id = std::string(std::forward<Args>(args)...);
 
-    auto poses_itr =
-        data_.mutable_updates()->at(0).mutable_poses()->find(stream_id);
-    if (poses_itr == data_.mutable_updates()->at(0).mutable_poses()->end()) {
+    auto poses_itr = update_->mutable_poses()->find(stream_id);
+    if (poses_itr == update_->mutable_poses()->end()) {
       auto insertion_res =
-          data_.mutable_updates()->at(0).mutable_poses()->insert(
-              {stream_id, xviz::Pose()});
+          update_->mutable_poses()->insert({stream_id, xviz::Pose()});
       if (!insertion_res.second) [[unlikely]] {
         throw std::runtime_error("TODO Cannot insert pose");
       }
       poses_itr = insertion_res.first;
     }
+    BeginStream(poses_itr->first);
     return pose_builder_.Start(poses_itr->second);
   }
 
+  PoseBuilder<Builder>& Pose(StreamId stream) {
+    pose_builder_.End();
+    return pose_builder_.Start(Slot(pose_slots_, stream));
+  }
+
+  template <schema::FixedString Id>
+  PoseBuilder<Builder>& Pose(const schema::Stream<Id, schema::Pose>&) {
+    using StreamT = schema::Stream<Id, schema::Pose>;
+    pose_builder_.End();
+    return pose_builder_.Start(
+        Slot(schema_pose_slots_, StreamT::Index(), StreamT::Name()));
+  }
+
   template <xviz::concepts::CanConstructString... Args>
   PrimitiveBuilder<Builder>& Primitive(Args&&... args) {
     primitive_builder_.End();
     std::string stream_id = std::string(std::forward<Args>(args)...);
 
-    auto primitives_itr =
-        data_.mutable_updates()->at(0).mutable_primitives()->find(stream_id);
-    if (primitives_itr ==
-        data_.mutable_updates()->at(0).mutable_primitives()->end()) {
+    auto primitives_itr = update_->mutable_primitives()->find(stream_id);
+    if (primitives_itr == update_->mutable_primitives()->end()) {
       auto insertion_res =
-          data_.mutable_updates()->at(0).mutable_primitives()->insert(
-              {stream_id, PrimitiveState()});
+          update_->mutable_primitives()->insert({stream_id, PrimitiveState()});
       if (!insertion_res.second) [[unlikely]] {
         throw std::runtime_error("TODO Cannot insert primitive");
       }
       primitives_itr = insertion_res.first;
     }
+    primitive_stream_id_ = &primitives_itr->first;
+    BeginStream(primitives_itr->first);
     return primitive_builder_.Start(primitives_itr->second);
   }
 
+  PrimitiveBuilder<Builder>& Primitive(StreamId stream) {
+    primitive_builder_.End();
+    auto& primitive = Slot(primitive_slots_, stream);
+    primitive_stream_id_ = &registry_->Name(stream);
+    return primitive_builder_.Start(primitive);
+  }
+
+  // Only the primitives of the stream's kind compile on the returned builder
+  template <schema::FixedString Id, schema::PrimitiveStreamKind Kind>
+  PrimitiveBuilder<Builder, Kind>& Primitive(const schema::Stream<Id, Kind>&) {
+    using StreamT = schema::Stream<Id, Kind>;
+    EndSchemaPrimitives();
+    auto& primitive =
+        Slot(schema_primitive_slots_, StreamT::Index(), StreamT::Name());
+    primitive_stream_id_ = &StreamT::Name();
+    return std::get<PrimitiveBuilder<Builder, Kind>>(schema_primitive_builders_)
+        .Start(primitive);
+  }
+
+  // Emits one point stream per level of detail, e.g. /lidar/lod0..2, from a
+  // single pass over the input points. Colors are optional.
+  Builder& PointLOD(const std::vector<std::string>& stream_ids,
+                    std::span<const float> flatten_points,
+                    std::span<const PointDownsampleOption> levels,
+                    const std::vector<uint8_t>& flatten_colors = {}) {
+    if (stream_ids.size() != levels.size()) [[unlikely]] {
+      throw std::runtime_error(
+          std::format("{} streams are given for {} levels of detail",
+                      stream_ids.size(), levels.size()));
+    }
+    auto all_indices = util::DownsamplePoints(flatten_points, levels);
+    for (std::size_t level = 0; level < levels.size(); level++) {
+      auto& point_builder = Primitive(stream_ids[level])
+                                .Point(flatten_points, all_indices[level]);
+      if (!flatten_colors.empty()) {
+        point_builder.Color(flatten_colors);
+      }
+    }
+    primitive_builder_.End();
+    return *this;
+  }
+
   template <xviz::concepts::CanConstructString... Args>
   TimeSeriesBuilder<Builder>& TimeSeries(Args&&... args) {
     time_series_builder_.End();
     std::string stream_id = std::string(std::forward<Args>(args)...);
-    auto new_time_series_ptr = data_.mutable_updates()->at(0).add_time_series();
+    auto new_time_series_ptr = update_->add_time_series();
     new_time_series_ptr->add_streams(stream_id);
+    BeginStream(new_time_series_ptr->streams(0));
+    return time_series_builder_.Start(*new_time_series_ptr);
+  }
+
+  // The stream string is copied into the one a recycled update already
+  // holds instead of being built for every call
+  TimeSeriesBuilder<Builder>& TimeSeries(StreamId stream) {
+    time_series_builder_.End();
+    auto new_time_series_ptr = update_->add_time_series();
+    new_time_series_ptr->add_streams(Registry().Name(stream));
+    BeginStream(new_time_series_ptr->streams(0));
     return time_series_builder_.Start(*new_time_series_ptr);
   }
 
+  template <schema::FixedString Id, schema::TimeSeriesStreamKind Kind>
+  TimeSeriesBuilder<Builder, Kind>& TimeSeries(
+      const schema::Stream<Id, Kind>&) {
+    auto& builder = std::get<TimeSeriesBuilder<Builder, Kind>>(
+        schema_time_series_builders_);
+    builder.End();
+    auto new_time_series_ptr = update_->add_time_series();
+    new_time_series_ptr->add_streams(schema::Stream<Id, Kind>::Name());
+    BeginStream(new_time_series_ptr->streams(0));
+    return builder.Start(*new_time_series_ptr);
+  }
+
+  // Packs the samples into as few TimeSeriesStates as possible, one per
+  // timestamp, object id and value type, instead of one per stream.
+  Builder& TimeSeriesBatch(std::span<const TimeSeriesSample> samples) {
+    time_series_builder_.End();
+    BeginStream({});
+    util::AppendTimeSeriesSamples(*update_->mutable_time_series(), samples);
+    return *this;
+  }
+
   template <xviz::concepts::CanConstructString... Args>
   UIPrimitiveBuilder<Builder>& UIPrimitive(Args&&... args) {
     ui_primitive_builder_.End();
     std::string stream_id = std::string(std::forward<Args>(args)...);
-    auto ui_primitives_itr =
-        data_.mutable_updates()->at(0).mutable_ui_primitives()->find(stream_id);
-    if (ui_primitives_itr ==
-        data_.mutable_updates()->at(0).mutable_ui_primitives()->end()) {
-      auto insertion_res =
-          data_.mutable_updates()->at(0).mutable_ui_primitives()->insert(
-              {stream_id, UIPrimitiveState()});
+    auto ui_primitives_itr = update_->mutable_ui_primitives()->find(stream_id);
+    if (ui_primitives_itr == update_->mutable_ui_primitives()->end()) {
+      auto insertion_res = update_->mutable_ui_primitives()->insert(
+          {stream_id, UIPrimitiveState()});
       if (!insertion_res.second) [[unlikely]] {
         throw std::runtime_error("TODO Cannot insert ui primitive");
       }
       ui_primitives_itr = insertion_res.first;
     }
+    BeginStream(ui_primitives_itr->first);
     return ui_primitive_builder_.Start(ui_primitives_itr->second);
   }
 
+  UIPrimitiveBuilder<Builder>& UIPrimitive(StreamId stream) {
+    ui_primitive_builder_.End();
+    return ui_primitive_builder_.Start(Slot(ui_primitive_slots_, stream));
+  }
+
+  // Streams registered here can be built by StreamId. Their data is kept in
+  // a table indexed by the id and only moved into the update's maps once,
+  // in GetData(). Give it before building a frame, the registry must
+  // outlive the builder.
+  Builder& Streams(const StreamRegistry& registry) {
+    if (registry_ != &registry) {
+      // the ids of another registry index other streams
+      pose_slots_ = {};
+      primitive_slots_ = {};
+      ui_primitive_slots_ = {};
+    }
+    registry_ = &registry;
+    return *this;
+  }
+
+  // Raw images are encoded with the shared pool unless one is given here
+  Builder& ImageEncoders(ImageEncoderPool& pool) {
+    image_encoder_pool_ = &pool;
+    return *this;
+  }
+
+  // Each frame is checked by the validator the first time GetData() hands it
+  // out, the streams are only complete then. The validator must outlive the
+  // builder, pass nullptr to stop checking.
+  Builder& Validate(Validator* validator) {
+    validator_ = validator;
+    return *this;
+  }
+
+  // Used by PrimitiveBuilder::Image(), the stream id is the encoder context
+  void EncodeImage(xviz::Image& image, const RawImage& raw_image,
+                   const ImageEncodeOption& option) {
+    auto& pool = image_encoder_pool_ ? *image_encoder_pool_
+                                     : ImageEncoderPool::Shared();
+    pending_images_.emplace_back(
+        &image, pool.Encode(primitive_stream_id_ ? *primitive_stream_id_ : "",
+                            raw_image, option));
+    if (dedup_images_) {
+      RecordImage(Fingerprint(raw_image, option));
+    }
+  }
+
+  // Used by PrimitiveBuilder::Image(ImageBuffer)
+  void ReferenceImage(const xviz::Image& image, ImageBuffer buffer) {
+    FingerprintImage(buffer.View());
+    image_buffers_.emplace_back(&image, std::move(buffer));
+  }
+
+  // Leaves out the primitive streams holding only images that are byte for
+  // byte the ones this builder sent for them last time, the viewer keeps
+  // showing those. Meant for cameras slower than the publish rate, so every
+  // message of this builder has to reach the same receivers. Calling it
+  // again forgets what was sent, e.g. to give a new client every image once.
+  Builder& DeduplicateImages(bool enable = true) {
+    dedup_images_ = enable;
+    sent_images_.clear();
+    return *this;
+  }
+
+  // Records the encoded image just added to the current primitive stream,
+  // see DeduplicateImages()
+  void FingerprintImage(std::string_view bytes) {
+    if (dedup_images_) {
+      RecordImage(util::Hash64(bytes));
+    }
+  }
+
+  // Where the images held by reference belong in GetData(), to be passed
+  // along with it to Message
+  std::vector<ImageReference> ImageReferences() const {
+    std::vector<ImageReference> ret;
+    if (image_buffers_.empty()) {
+      return ret;
+    }
+    ret.reserve(image_buffers_.size());
+    for (int update = 0; update < data_->updates_size(); update++) {
+      for (const auto& [stream_id, primitive] :
+           data_->updates(update).primitives()) {
+        for (int index = 0; index < primitive.images_size(); index++) {
+          for (const auto& [image, buffer] : image_buffers_) {
+            if (image == &primitive.images(index)) {
+              ret.push_back({update, stream_id, index, buffer});
+            }
+          }
+        }
+      }
+    }
+    return ret;
+  }
+
   StateUpdate& GetData() {
+    trace_.End();
+    trace::Span span("Builder::GetData", "builder");
+    EndBuilders();
+
+    // proto messages are not moved by later insertions, so the pointers
+    // are still valid
+    std::exception_ptr error;
+    for (auto& [image, encoded] : pending_images_) {
+      try {
+        image->set_data(encoded.get());
+      } catch (...) {
+        error = std::current_exception();
+      }
+    }
+    pending_images_.clear();
+    if (error) [[unlikely]] {
+      std::rethrow_exception(error);
+    }
+
+    FlushAllSlots();
+    DropUnchangedImages();
+    metrics_.Record(*data_);
+    if (validator_ && !validated_) {
+      validator_->Validate(*data_);
+      validated_ = true;
+    }
+    return *data_;
+  }
+
+  // Hands the data out as an owned frame and starts a new one, unlike
+  // moving out of GetData() the builder stays usable
+  Frame Finish() {
+    GetData();
+    auto images = ImageReferences();
+    Frame frame(std::move(data_), std::move(images), recycler_);
+    Reset();
+    return frame;
+  }
+
+ private:
+  template <typename T>
+  struct StreamSlot {
+    T data;
+    const std::string* name{nullptr};
+    // the slot holds data of the current frame if it equals generation_
+    uint64_t generation{0};
+  };
+
+  template <typename T>
+  struct StreamSlots {
+    // deque keeps the slots in place when more streams get registered
+    std::deque<StreamSlot<T>> slots;
+    std::vector<uint32_t> used;
+  };
+
+  const StreamRegistry& Registry() const {
+    if (!registry_) [[unlikely]] {
+      throw std::runtime_error(
+          "No StreamRegistry is given to the builder, see Builder::Streams()");
+    }
+    return *registry_;
+  }
+
+  template <typename T>
+  T& Slot(StreamSlots<T>& table, StreamId stream) {
+    const auto& registry = Registry();
+    if (!registry.Contains(stream)) [[unlikely]] {
+      throw std::runtime_error(
+          std::format("Stream id {} is not registered", stream.index));
+    }
+    return Slot(table, stream.index, registry.Name(stream));
+  }
+
+  template <typename T>
+  T& Slot(StreamSlots<T>& table, uint32_t index, const std::string& name) {
+    if (index >= table.slots.size()) {
+      table.slots.resize(index + 1);
+    }
+    auto& slot = table.slots[index];
+    if (slot.generation != generation_) {
+      slot.generation = generation_;
+      slot.name = &name;
+      table.used.push_back(index);
+    }
+    BeginStream(name);
+    return slot.data;
+  }
+
+  template <typename T>
+  void ClearSlots(StreamSlots<T>& table) {
+    for (auto index : table.used) {
+      table.slots[index].data.Clear();
+      table.slots[index].generation = 0;
+    }
+    table.used.clear();
+  }
+
+  void EndBuilders() {
     pose_builder_.End();
     primitive_builder_.End();
+    EndSchemaPrimitives();
     time_series_builder_.End();
+    std::apply([](auto&... builders) { (builders.End(), ...); },
+               schema_time_series_builders_);
     ui_primitive_builder_.End();
+  }
 
-    return data_;
+  // The slots hold data of the current StreamSet only
+  void FlushAllSlots() {
+    FlushSlots(pose_slots_, *update_->mutable_poses());
+    FlushSlots(primitive_slots_, *update_->mutable_primitives());
+    FlushSlots(ui_primitive_slots_, *update_->mutable_ui_primitives());
+    FlushSlots(schema_pose_slots_, *update_->mutable_poses());
+    FlushSlots(schema_primitive_slots_, *update_->mutable_primitives());
   }
 
- private:
-  StateUpdate data_;
+  template <typename T, typename MapT>
+  void FlushSlots(StreamSlots<T>& table, MapT& map) {
+    for (auto index : table.used) {
+      auto& slot = table.slots[index];
+      // the stream may be built again by id after this GetData()
+      slot.generation = 0;
+      auto insertion_res = map.insert({*slot.name, T()});
+      if (insertion_res.second) [[likely]] {
+        insertion_res.first->second.Swap(&slot.data);
+        continue;
+      }
+      // built by name as well, or after an earlier GetData()
+      auto& target = insertion_res.first->second;
+      if constexpr (std::is_same_v<T, PrimitiveState>) {
+        auto offset = target.images_size();
+        target.MergeFrom(slot.data);
+        RetargetImages(slot.data, target, offset);
+      } else {
+        target.MergeFrom(slot.data);
+      }
+      slot.data.Clear();
+    }
+    table.used.clear();
+  }
+
+  // Points the images held by reference at their copies after a merge
+  void RetargetImages(const PrimitiveState& from, const PrimitiveState& to,
+                      int offset) {
+    for (auto& [image, buffer] : image_buffers_) {
+      for (int index = 0; index < from.images_size(); index++) {
+        if (image == &from.images(index)) {
+          image = &to.images(offset + index);
+        }
+      }
+    }
+  }
+
+  void RecordImage(uint64_t fingerprint) {
+    image_fingerprints_.emplace_back(
+        primitive_stream_id_ ? *primitive_stream_id_ : "", fingerprint);
+  }
+
+  // Raw frames are fingerprinted instead of their encoded bytes, which are
+  // not there yet
+  static uint64_t Fingerprint(const RawImage& image,
+                              const ImageEncodeOption& option) {
+    uint64_t hash = util::HashCombine(image.width, image.height);
+    hash = util::HashCombine(hash, static_cast<uint64_t>(image.format));
+    hash = util::HashCombine(hash, static_cast<uint64_t>(option.quality));
+    hash = util::HashCombine(hash, util::HashCombine(option.width,
+                                                     option.height));
+    std::size_t row_size = image.width * BytesPerPixel(image.format);
+    for (uint32_t row = 0; row < image.height; row++) {
+      hash = util::Hash64(
+          image.pixels.subspan(row * image.RowStride(), row_size), hash);
+    }
+    return hash;
+  }
+
+  static bool OnlyImages(const PrimitiveState& primitive) {
+    return primitive.polygons_size() == 0 && primitive.polylines_size() == 0 &&
+           primitive.texts_size() == 0 && primitive.circles_size() == 0 &&
+           primitive.points_size() == 0 && primitive.stadiums_size() == 0;
+  }
+
+  // Erases the streams of the current StreamSet whose images were all sent
+  // last time, a complete state has to carry every stream though
+  void DropUnchangedImages() {
+    if (!dedup_images_ ||
+        data_->update_type() == StateUpdate::COMPLETE_STATE) {
+      image_fingerprints_.clear();
+      return;
+    }
+    // combined fingerprint and number of images of each stream
+    std::unordered_map<std::string_view, std::pair<uint64_t, int>> streams;
+    for (const auto& [stream_id, fingerprint] : image_fingerprints_) {
+      auto [itr, inserted] =
+          streams.try_emplace(stream_id, std::pair(fingerprint, 1));
+      if (!inserted) {
+        itr->second.first = util::HashCombine(itr->second.first, fingerprint);
+        itr->second.second++;
+      }
+    }
+
+    auto& primitives = *update_->mutable_primitives();
+    for (auto itr = primitives.begin(); itr != primitives.end();) {
+      const auto& [stream_id, primitive] = *itr;
+      auto stream = streams.find(stream_id);
+      if (stream == streams.end() || !OnlyImages(primitive) ||
+          stream->second.second != primitive.images_size()) {
+        // the viewer replaces what it showed, send the images next time
+        sent_images_.erase(stream_id);
+        ++itr;
+        continue;
+      }
+      auto fingerprint = stream->second.first;
+      auto [sent, inserted] = sent_images_.try_emplace(stream_id, fingerprint);
+      if (inserted || sent->second != fingerprint) {
+        sent->second = fingerprint;
+        ++itr;
+        continue;
+      }
+      ForgetImages(primitive);
+      itr = primitives.erase(itr);
+    }
+    image_fingerprints_.clear();
+  }
+
+  // Encoders may still read the raw frames, which the caller is free to
+  // release once the builder is reset or destroyed
+  void WaitForImages() {
+    for (auto& [image, encoded] : pending_images_) {
+      encoded.wait();
+    }
+    pending_images_.clear();
+  }
+
+  // Drops the references and pending encodings of a primitive's images
+  // before it is erased
+  void ForgetImages(const PrimitiveState& primitive) {
+    auto owned = [&primitive](const xviz::Image* image) {
+      return std::ranges::any_of(primitive.images(), [image](const auto& own) {
+        return &own == image;
+      });
+    };
+    std::erase_if(image_buffers_,
+                  [&owned](const auto& entry) { return owned(entry.first); });
+    std::erase_if(pending_images_, [&owned](auto& entry) {
+      if (!owned(entry.first)) {
+        return false;
+      }
+      entry.second.wait();
+      return true;
+    });
+  }
+
+  // Each stream's section lasts until the builder switches to another one
+  void BeginStream(std::string_view stream_id) {
+    metrics_.Begin(stream_id);
+    trace_.Begin(stream_id);
+  }
+
+  void EndSchemaPrimitives() {
+    std::apply([](auto&... builders) { (builders.End(), ...); },
+               schema_primitive_builders_);
+  }
+
+  std::unique_ptr<StateUpdate> data_;
+  // the StreamSet being built, the last one of data_
+  StreamSet* update_{nullptr};
   PoseBuilder<Builder> pose_builder_;
   PrimitiveBuilder<Builder> primitive_builder_;
   TimeSeriesBuilder<Builder> time_series_builder_;
   UIPrimitiveBuilder<Builder> ui_primitive_builder_;
+  std::tuple<PrimitiveBuilder<Builder, schema::Polygon>,
+             PrimitiveBuilder<Builder, schema::Polyline>,
+             PrimitiveBuilder<Builder, schema::Circle>,
+             PrimitiveBuilder<Builder, schema::Point>,
+             PrimitiveBuilder<Builder, schema::Image>,
+             PrimitiveBuilder<Builder, schema::Text>>
+      schema_primitive_builders_;
+  template <StreamMetadata::ScalarType T>
+  using SchemaTimeSeriesBuilder =
+      TimeSeriesBuilder<Builder, schema::TimeSeries<T>>;
+  std::tuple<SchemaTimeSeriesBuilder<StreamMetadata::FLOAT>,
+             SchemaTimeSeriesBuilder<StreamMetadata::INT32>,
+             SchemaTimeSeriesBuilder<StreamMetadata::STRING>,
+             SchemaTimeSeriesBuilder<StreamMetadata::BOOL>>
+      schema_time_series_builders_;
+
+  std::shared_ptr<StateUpdateRecycler> recycler_;
+  detail::BuilderMetrics metrics_;
+  trace::Sections trace_{"builder"};
+  ImageEncoderPool* image_encoder_pool_{nullptr};
+  Validator* validator_{nullptr};
+  bool validated_{false};
+  const std::string* primitive_stream_id_{nullptr};
+  std::vector<std::pair<xviz::Image*, std::future<std::string>>>
+      pending_images_;
+  std::vector<std::pair<const xviz::Image*, ImageBuffer>> image_buffers_;
+  bool dedup_images_{false};
+  // fingerprints of the images added to the current StreamSet by stream
+  std::vector<std::pair<std::string, uint64_t>> image_fingerprints_;
+  // combined fingerprint of the images last sent for each stream
+  std::unordered_map<std::string, uint64_t> sent_images_;
+
+  const StreamRegistry* registry_{nullptr};
+  uint64_t generation_{1};
+  StreamSlots<xviz::Pose> pose_slots_;
+  StreamSlots<PrimitiveState> primitive_slots_;
+  StreamSlots<UIPrimitiveState> ui_primitive_slots_;
+  // indexed by schema::Stream::Index()
+  StreamSlots<xviz::Pose> schema_pose_slots_;
+  StreamSlots<PrimitiveState> schema_primitive_slots_;
 };
 
 }  // namespace xviz
\ No newline at end of file
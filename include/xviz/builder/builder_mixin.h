@@ -38,6 +38,8 @@ class BuilderMixin {
 
   auto&& GetData() { return builder_.GetData(); }
 
+  auto&& NextUpdate() { return builder_.NextUpdate(); }
+
   template <typename... Args>
   auto&& Primitive(Args&&... args) {
     return builder_.Primitive(std::forward<Args>(args)...);
@@ -53,6 +55,16 @@ class BuilderMixin {
     return builder_.TimeSeries(std::forward<Args>(args)...);
   }
 
+  template <typename... Args>
+  auto&& PointLOD(Args&&... args) {
+    return builder_.PointLOD(std::forward<Args>(args)...);
+  }
+
+  template <typename... Args>
+  auto&& TimeSeriesBatch(Args&&... args) {
+    return builder_.TimeSeriesBatch(std::forward<Args>(args)...);
+  }
+
   template <typename... Args>
   auto&& UIPrimitive(Args&&... args) {
     return builder_.UIPrimitive(std::forward<Args>(args)...);
@@ -77,11 +89,12 @@ class BuilderMixin {
     if (!data_) {
       return;
     }
-    // TODO do some checks
+    // a single stream cannot be checked on its own, the whole frame is
+    // checked against the metadata in Builder::GetData(), see
+    // Builder::Validate()
     data_ = nullptr;
   }
 
- private:
   BaseBuilderT& builder_;
 };
 
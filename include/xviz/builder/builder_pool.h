@@ -0,0 +1,69 @@
+/*
+ * Project: libxviz
+ * Description: C++ Implementation of XVIZ Protocol
+ * Author: Minjun Xu (mjxu96@outlook.com)
+ * -----
+ * MIT License
+ * Copyright (c) 2023 Minjun Xu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <xviz/builder/builder.h>
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace xviz {
+
+// Thread-safe pool of builders. Builders and the StateUpdates of their
+// finished frames are recycled, so producing a frame constructs neither.
+class BuilderPool {
+  struct State {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<Builder>> idle;
+    std::size_t max_idle;
+    std::shared_ptr<StateUpdateRecycler> recycler;
+  };
+
+ public:
+  // Gives the builder back to the pool it came from, which may be gone
+  struct Releaser {
+    std::shared_ptr<State> state;
+    void operator()(Builder* builder) const;
+  };
+
+  using PooledBuilder = std::unique_ptr<Builder, Releaser>;
+
+  explicit BuilderPool(std::size_t max_idle = 16);
+
+  // The builder is reset and goes back to the pool when it is dropped
+  PooledBuilder Acquire();
+
+  std::size_t IdleBuilders() const;
+  StateUpdateRecycler& Recycler() const { return *state_->recycler; }
+
+ private:
+  std::shared_ptr<State> state_;
+};
+
+}  // namespace xviz
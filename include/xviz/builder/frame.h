@@ -0,0 +1,91 @@
+/*
+ * Project: libxviz
+ * Description: C++ Implementation of XVIZ Protocol
+ * Author: Minjun Xu (mjxu96@outlook.com)
+ * -----
+ * MIT License
+ * Copyright (c) 2023 Minjun Xu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <xviz/def.h>
+#include <xviz/utils/image_buffer.h>
+
+#include <memory>
+#include <mutex>
+#include <span>
+#include <vector>
+
+namespace xviz {
+
+// Thread-safe free list of cleared StateUpdates, the next frames reuse the
+// messages protobuf keeps in their repeated fields
+class StateUpdateRecycler {
+ public:
+  explicit StateUpdateRecycler(std::size_t max_idle = 16)
+      : max_idle_(max_idle) {}
+
+  StateUpdateRecycler(const StateUpdateRecycler&) = delete;
+  StateUpdateRecycler& operator=(const StateUpdateRecycler&) = delete;
+
+  std::unique_ptr<StateUpdate> Acquire();
+  // Clears the message on the calling thread, outside of the lock
+  void Release(std::unique_ptr<StateUpdate> data);
+
+  std::size_t IdleCount() const;
+
+ private:
+  std::size_t max_idle_;
+  mutable std::mutex mutex_;
+  std::vector<std::unique_ptr<StateUpdate>> idle_;
+};
+
+// Finished frame handed out by Builder::Finish(). It owns the StateUpdate
+// and the images held by reference, and gives the StateUpdate back to the
+// builder's recycler when it is destroyed.
+class Frame {
+ public:
+  Frame() = default;
+  Frame(std::unique_ptr<StateUpdate> data, std::vector<ImageReference> images,
+        std::shared_ptr<StateUpdateRecycler> recycler);
+  ~Frame();
+
+  Frame(Frame&&) noexcept = default;
+  Frame& operator=(Frame&& other) noexcept;
+
+  bool Empty() const { return !data_; }
+
+  const StateUpdate& Data() const;
+  StateUpdate& MutableData();
+
+  std::span<const ImageReference> ImageReferences() const { return images_; }
+  std::vector<ImageReference>& MutableImageReferences() { return images_; }
+
+ private:
+  void Recycle();
+
+  std::unique_ptr<StateUpdate> data_;
+  std::vector<ImageReference> images_;
+  std::shared_ptr<StateUpdateRecycler> recycler_;
+};
+
+}  // namespace xviz
@@ -30,6 +30,7 @@
 #include "stream_metadata.h"
 #include "ui_metadata.h"
 
+#include <xviz/builder/schema.h>
 #include <xviz/def.h>
 
 #include <concepts>
@@ -75,6 +76,21 @@ class MetadataBuilder {
     return stream_builder_.StartStream(stream_metadata_itr->second);
   }
 
+  // Declares the category and type of a schema stream, the rest of its
+  // metadata can be chained as usual
+  template <schema::FixedString Id, typename Kind>
+  StreamMetadataBuilder<MetadataBuilder>& Stream(
+      const schema::Stream<Id, Kind>&) {
+    auto& stream_builder = Stream(schema::Stream<Id, Kind>::Name());
+    stream_builder.Category(Kind::kCategory);
+    if constexpr (schema::PrimitiveStreamKind<Kind>) {
+      stream_builder.Type(Kind::kPrimitiveType);
+    } else if constexpr (schema::TimeSeriesStreamKind<Kind>) {
+      stream_builder.Type(Kind::kScalarType);
+    }
+    return stream_builder;
+  }
+
   template <typename... Args>
   requires(std::constructible_from<std::string, Args...>)
       UIMetadataBuilder<MetadataBuilder>
@@ -288,7 +288,8 @@ class StreamMetadataBuilder : public MetadataBuilderMixin<BaseBuilder> {
     if (!data_) {
       return;
     }
-    // TODO do some checks here
+    // the streams are checked by Validator once the whole metadata is
+    // built, a stream alone does not tell whether it is complete
     category_builder_.EndCategory();
     data_ = nullptr;
   }
@@ -28,6 +28,10 @@
 #pragma once
 #include "primitive_base.h"
 
+#include <xviz/utils/point_cloud.h>
+
+#include <span>
+
 namespace xviz {
 
 template <typename PrimitiveBuilderType, typename BuilderType>
@@ -42,19 +46,52 @@ class PrimitivePointBuilder
  public:
   using BaseType::BaseType;
   using BaseType::End;
-  using BaseType::Start;
+
+  PrimitivePointBuilder& Start(Point& data) {
+    kept_indices_.clear();
+    source_point_count_ = 0;
+    return BaseType::Start(data);
+  }
+
+  // Only keeps the points at the given indices of the source points, colors
+  // given afterwards for all the source points are filtered the same way.
+  PrimitivePointBuilder& Start(Point& data,
+                               std::span<const float> flatten_points,
+                               std::span<const uint32_t> indices) {
+    Start(data);
+    auto points = data.mutable_points();
+    points->Resize(static_cast<int>(indices.size() * 3), 0.0f);
+    util::GatherByIndices(flatten_points, indices, 3, points->mutable_data());
+    kept_indices_.assign(indices.begin(), indices.end());
+    source_point_count_ = flatten_points.size() / 3;
+    return *this;
+  }
 
   // must be R,G,B,A
   PrimitivePointBuilder& Color(const std::vector<uint8_t>& flatten_colors) {
     assert(flatten_colors.size() % 4 == 0);
-    assert(flatten_colors.size() / 4 == this->Data().points_size() / 3);
+    if (source_point_count_ &&
+        flatten_colors.size() / 4 == source_point_count_) {
+      // colors of the points before downsampling
+      std::string kept_colors(kept_indices_.size() * 4, '\0');
+      util::GatherByIndices<char>(
+          {reinterpret_cast<const char*>(flatten_colors.data()),
+           flatten_colors.size()},
+          kept_indices_, 4, kept_colors.data());
+      this->Data().set_colors(std::move(kept_colors));
+      return *this;
+    }
+    assert(flatten_colors.size() / 4 ==
+           static_cast<std::size_t>(this->Data().points_size() / 3));
     this->Data().set_colors(flatten_colors.data(), flatten_colors.size());
     return *this;
   }
 
   PrimitivePointBuilder& Color(
       const std::vector<std::array<uint8_t, 4>>& colors) {
-    assert(colors.size() == this->Data().points_size() / 3);
+    assert(colors.size() ==
+               static_cast<std::size_t>(this->Data().points_size() / 3) ||
+           colors.size() == source_point_count_);
     std::vector<uint8_t> flatten_colors;
     flatten_colors.reserve(4 * colors.size());
     for (const auto& color : colors) {
@@ -64,6 +101,43 @@ class PrimitivePointBuilder
     }
     return this->Color(flatten_colors);
   }
+
+  // Drops points according to the option. Colors already set or set later
+  // for the full set of points stay aligned with the kept points.
+  PrimitivePointBuilder& Downsample(const PointDownsampleOption& option) {
+    auto points = this->Data().mutable_points();
+    auto indices = util::DownsamplePoints(
+        std::span<const float>(points->data(), points->size()), option);
+
+    std::size_t point_count = points->size() / 3;
+    if (this->Data().colors().size() == point_count * 4) {
+      std::string kept_colors(indices.size() * 4, '\0');
+      util::GatherByIndices<char>(this->Data().colors(), indices, 4,
+                                  kept_colors.data());
+      this->Data().set_colors(std::move(kept_colors));
+    }
+    // indices are ascending so the points can be compacted in place
+    float* data = points->mutable_data();
+    for (std::size_t i = 0; i < indices.size(); i++) {
+      std::copy_n(data + std::size_t(indices[i]) * 3, 3, data + i * 3);
+    }
+    points->Truncate(static_cast<int>(indices.size() * 3));
+
+    if (source_point_count_) {
+      for (auto& index : indices) {
+        index = kept_indices_[index];
+      }
+    } else {
+      source_point_count_ = point_count;
+    }
+    kept_indices_ = std::move(indices);
+    return *this;
+  }
+
+ private:
+  // indices of the kept points among the points the caller passed in
+  std::vector<uint32_t> kept_indices_;
+  std::size_t source_point_count_{0};
 };
 
 }  // namespace xviz
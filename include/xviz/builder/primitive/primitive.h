@@ -35,15 +35,23 @@
 #include "text.h"
 
 #include <xviz/builder/builder_mixin.h>
+#include <xviz/builder/schema.h>
 #include <xviz/def.h>
+#include <xviz/utils/image_buffer.h>
+#include <xviz/utils/image_encoder.h>
 
 namespace xviz {
 
-template <typename BaseBuilder>
-class PrimitiveBuilder : public BuilderMixin<PrimitiveBuilder<BaseBuilder>,
-                                             BaseBuilder, PrimitiveState> {
-  using BaseT =
-      BuilderMixin<PrimitiveBuilder<BaseBuilder>, BaseBuilder, PrimitiveState>;
+// Builds the primitives of one stream. Streams declared with a schema kind
+// only accept the primitives of that kind, e.g. Circle() does not compile
+// for a schema::Polygon stream.
+template <typename BaseBuilder, typename Kind = schema::AnyPrimitive>
+class PrimitiveBuilder
+    : public BuilderMixin<PrimitiveBuilder<BaseBuilder, Kind>, BaseBuilder,
+                          PrimitiveState> {
+  using BaseT = BuilderMixin<PrimitiveBuilder<BaseBuilder, Kind>, BaseBuilder,
+                             PrimitiveState>;
+  using SelfT = PrimitiveBuilder<BaseBuilder, Kind>;
 
  public:
   PrimitiveBuilder(BaseBuilder& builder)
@@ -55,8 +63,9 @@ class PrimitiveBuilder : public BuilderMixin<PrimitiveBuilder<BaseBuilder>,
         point_builder_(*this, builder),
         image_builder_(*this, builder) {}
 
-  PrimitivePolygonBuilder<PrimitiveBuilder<BaseBuilder>, BaseBuilder>& Polygon(
-      const std::vector<std::array<float, 3>>& vertices) {
+  PrimitivePolygonBuilder<SelfT, BaseBuilder>& Polygon(
+      const std::vector<std::array<float, 3>>& vertices)
+  requires(schema::Allows<Kind, schema::Polygon>) {
     polygon_builder_.End();
     auto new_polygon = this->Data().add_polygons();
     for (const auto& points : vertices) {
@@ -67,8 +76,9 @@ class PrimitiveBuilder : public BuilderMixin<PrimitiveBuilder<BaseBuilder>,
     return polygon_builder_.Start(*new_polygon);
   }
 
-  PrimitivePolylineBuilder<PrimitiveBuilder<BaseBuilder>, BaseBuilder>&
-  Polyline(const std::vector<std::array<float, 3>>& vertices) {
+  PrimitivePolylineBuilder<SelfT, BaseBuilder>& Polyline(
+      const std::vector<std::array<float, 3>>& vertices)
+  requires(schema::Allows<Kind, schema::Polyline>) {
     polyline_builder_.End();
     auto new_polyline = this->Data().add_polylines();
     for (const auto& points : vertices) {
@@ -79,8 +89,9 @@ class PrimitiveBuilder : public BuilderMixin<PrimitiveBuilder<BaseBuilder>,
     return polyline_builder_.Start(*new_polyline);
   }
 
-  PrimitivePointBuilder<PrimitiveBuilder<BaseBuilder>, BaseBuilder>& Point(
-      const std::vector<std::array<float, 3>>& points) {
+  PrimitivePointBuilder<SelfT, BaseBuilder>& Point(
+      const std::vector<std::array<float, 3>>& points)
+  requires(schema::Allows<Kind, schema::Point>) {
     point_builder_.End();
     auto new_points = this->Data().add_points();
     for (const auto& point : points) {
@@ -91,8 +102,9 @@ class PrimitiveBuilder : public BuilderMixin<PrimitiveBuilder<BaseBuilder>,
     return point_builder_.Start(*new_points);
   }
 
-  PrimitivePointBuilder<PrimitiveBuilder<BaseBuilder>, BaseBuilder>& Point(
-      const std::vector<float>& flatten_points) {
+  PrimitivePointBuilder<SelfT, BaseBuilder>& Point(
+      const std::vector<float>& flatten_points)
+  requires(schema::Allows<Kind, schema::Point>) {
     point_builder_.End();
     auto new_points = this->Data().add_points();
     for (auto point : flatten_points) {
@@ -101,8 +113,19 @@ class PrimitiveBuilder : public BuilderMixin<PrimitiveBuilder<BaseBuilder>,
     return point_builder_.Start(*new_points);
   }
 
-  PrimitiveCircleBuilder<PrimitiveBuilder<BaseBuilder>, BaseBuilder>& Circle(
-      const std::array<float, 3>& center, float radius) {
+  // Adds only the points at `indices`, e.g. the output of
+  // util::DownsamplePoints()
+  PrimitivePointBuilder<SelfT, BaseBuilder>& Point(
+      std::span<const float> flatten_points, std::span<const uint32_t> indices)
+  requires(schema::Allows<Kind, schema::Point>) {
+    point_builder_.End();
+    auto new_points = this->Data().add_points();
+    return point_builder_.Start(*new_points, flatten_points, indices);
+  }
+
+  PrimitiveCircleBuilder<SelfT, BaseBuilder>& Circle(
+      const std::array<float, 3>& center, float radius)
+  requires(schema::Allows<Kind, schema::Circle>) {
     circle_builder_.End();
     auto new_circle = this->Data().add_circles();
     new_circle->add_center(center[0]);
@@ -113,18 +136,45 @@ class PrimitiveBuilder : public BuilderMixin<PrimitiveBuilder<BaseBuilder>,
   }
 
   template <typename... Args>
-  PrimitiveImageBuilder<PrimitiveBuilder<BaseBuilder>, BaseBuilder>& Image(
-      Args&&... args) {
+  requires(schema::Allows<Kind, schema::Image> &&
+           ((!std::same_as<std::remove_cvref_t<Args>, RawImage> &&
+             !std::same_as<std::remove_cvref_t<Args>, ImageBuffer>)&&...))
+  PrimitiveImageBuilder<SelfT, BaseBuilder>& Image(Args&&... args) {
     image_builder_.End();
     auto new_image = this->Data().add_images();
     new_image->set_data(std::forward<Args>(args)...);
+    this->builder_.FingerprintImage(new_image->data());
+    return image_builder_.Start(*new_image);
+  }
+
+  // Encodes the raw frame on the builder's image encoder pool, the data is
+  // filled in when the builder's data is retrieved
+  PrimitiveImageBuilder<SelfT, BaseBuilder>& Image(
+      const RawImage& image, const ImageEncodeOption& option = {})
+  requires(schema::Allows<Kind, schema::Image>) {
+    image_builder_.End();
+    auto new_image = this->Data().add_images();
+    auto [width, height] = option.OutputSize(image.width, image.height);
+    new_image->set_width_px(width);
+    new_image->set_height_px(height);
+    this->builder_.EncodeImage(*new_image, image, option);
+    return image_builder_.Start(*new_image);
+  }
+
+  // The image's data stays empty, the buffer is spliced in when the message
+  // is serialized, see Builder::ImageReferences()
+  PrimitiveImageBuilder<SelfT, BaseBuilder>& Image(ImageBuffer buffer)
+  requires(schema::Allows<Kind, schema::Image>) {
+    image_builder_.End();
+    auto new_image = this->Data().add_images();
+    this->builder_.ReferenceImage(*new_image, std::move(buffer));
     return image_builder_.Start(*new_image);
   }
 
   template <typename... Args>
-  requires(std::constructible_from<std::string, Args...>)
-      PrimitiveTextBuilder<PrimitiveBuilder<BaseBuilder>, BaseBuilder>
-  &Text(Args&&... args) {
+  requires(schema::Allows<Kind, schema::Text> &&
+           std::constructible_from<std::string, Args...>)
+  PrimitiveTextBuilder<SelfT, BaseBuilder>& Text(Args&&... args) {
     text_builder_.End();
     auto new_text = this->Data().add_texts();
     new_text->set_text(std::forward<Args>(args)...);
@@ -144,17 +194,17 @@ class PrimitiveBuilder : public BuilderMixin<PrimitiveBuilder<BaseBuilder>,
 
     BaseT::End();
   }
-  PrimitivePolygonBuilder<PrimitiveBuilder<BaseBuilder>, BaseBuilder>
+  PrimitivePolygonBuilder<SelfT, BaseBuilder>
       polygon_builder_;
-  PrimitivePolylineBuilder<PrimitiveBuilder<BaseBuilder>, BaseBuilder>
+  PrimitivePolylineBuilder<SelfT, BaseBuilder>
       polyline_builder_;
-  PrimitiveTextBuilder<PrimitiveBuilder<BaseBuilder>, BaseBuilder>
+  PrimitiveTextBuilder<SelfT, BaseBuilder>
       text_builder_;
-  PrimitiveCircleBuilder<PrimitiveBuilder<BaseBuilder>, BaseBuilder>
+  PrimitiveCircleBuilder<SelfT, BaseBuilder>
       circle_builder_;
-  PrimitivePointBuilder<PrimitiveBuilder<BaseBuilder>, BaseBuilder>
+  PrimitivePointBuilder<SelfT, BaseBuilder>
       point_builder_;
-  PrimitiveImageBuilder<PrimitiveBuilder<BaseBuilder>, BaseBuilder>
+  PrimitiveImageBuilder<SelfT, BaseBuilder>
       image_builder_;
 
   // TODO DELETE
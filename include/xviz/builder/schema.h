@@ -0,0 +1,135 @@
+/*
+ * Project: libxviz
+ * Description: C++ Implementation of XVIZ Protocol
+ * Author: Minjun Xu (mjxu96@outlook.com)
+ * -----
+ * MIT License
+ * Copyright (c) 2023 Minjun Xu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <xviz/def.h>
+
+#include <algorithm>
+#include <concepts>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace xviz::schema {
+
+// String literal usable as a template argument, e.g. Stream<"/pose", Pose>
+template <std::size_t N>
+struct FixedString {
+  constexpr FixedString(const char (&str)[N]) { std::copy_n(str, N, value); }
+
+  constexpr std::string_view View() const { return {value, N - 1}; }
+
+  char value[N]{};
+};
+
+// Kinds of streams, they decide the metadata and what the builder accepts
+
+struct Pose {
+  static constexpr auto kCategory = StreamMetadata::POSE;
+};
+
+template <StreamMetadata::PrimitiveType T>
+struct PrimitiveKind {
+  static constexpr auto kCategory = StreamMetadata::PRIMITIVE;
+  static constexpr auto kPrimitiveType = T;
+};
+
+using Polygon = PrimitiveKind<StreamMetadata::POLYGON>;
+using Polyline = PrimitiveKind<StreamMetadata::POLYLINE>;
+using Circle = PrimitiveKind<StreamMetadata::CIRCLE>;
+using Point = PrimitiveKind<StreamMetadata::POINT>;
+using Image = PrimitiveKind<StreamMetadata::IMAGE>;
+using Text = PrimitiveKind<StreamMetadata::TEXT>;
+
+// Primitive streams built by name may hold any primitive
+struct AnyPrimitive {};
+
+template <StreamMetadata::ScalarType T>
+struct TimeSeries {
+  static constexpr auto kCategory = StreamMetadata::TIME_SERIES;
+  static constexpr auto kScalarType = T;
+};
+
+// Time series streams built by name may hold any value
+struct AnyScalar {};
+
+template <typename Kind, typename Allowed>
+concept Allows =
+    std::same_as<Kind, AnyPrimitive> || std::same_as<Kind, Allowed>;
+
+template <typename Kind, typename... Args>
+concept AllowsValue =
+    std::same_as<Kind, AnyScalar> ||
+    (Kind::kScalarType == StreamMetadata::STRING &&
+     concepts::CanConstructString<Args...>) ||
+    (sizeof...(Args) == 1 &&
+     ((Kind::kScalarType == StreamMetadata::FLOAT &&
+       std::same_as<concepts::FirstArgType<Args...>, double>) ||
+      (Kind::kScalarType == StreamMetadata::INT32 &&
+       std::same_as<concepts::FirstArgType<Args...>, int32_t>) ||
+      (Kind::kScalarType == StreamMetadata::BOOL &&
+       std::same_as<concepts::FirstArgType<Args...>, bool>)));
+
+template <typename Kind>
+concept PrimitiveStreamKind = requires {
+  Kind::kPrimitiveType;
+};
+
+template <typename Kind>
+concept TimeSeriesStreamKind = requires {
+  Kind::kScalarType;
+};
+
+namespace detail {
+// Process wide index of a stream id, the same id always gets the same index
+uint32_t InternStream(std::string_view stream_id);
+}  // namespace detail
+
+// Stream declared at compile time, e.g.
+//   constexpr schema::Stream<"/object/shape", schema::Polygon> kShape;
+// MetadataBuilder::Stream(kShape) declares its category and type, and
+// Builder::Primitive(kShape) only accepts polygons. The builder keeps the
+// stream's data at Index() so no stream id is looked up while building.
+template <FixedString Id, typename Kind>
+struct Stream {
+  using KindType = Kind;
+  static constexpr std::string_view kId = Id.View();
+  static_assert(!kId.empty(), "The stream id is empty");
+
+  static const std::string& Name() {
+    static const std::string name(kId);
+    return name;
+  }
+
+  static uint32_t Index() {
+    static const uint32_t index = detail::InternStream(kId);
+    return index;
+  }
+};
+
+}  // namespace xviz::schema
@@ -0,0 +1,124 @@
+/*
+ * Project: libxviz
+ * Description: C++ Implementation of XVIZ Protocol
+ * Author: Minjun Xu (mjxu96@outlook.com)
+ * -----
+ * MIT License
+ * Copyright (c) 2023 Minjun Xu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <xviz/builder/frame.h>
+#include <xviz/def.h>
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace xviz {
+
+struct StateCacheOption {
+  // seconds a stream stays in the snapshot after its last update, 0 keeps
+  // it until it is cleared, streams of persistent updates never expire
+  double max_age{0};
+};
+
+// Latest state of every stream of the published frames, so a viewer that
+// connects mid-session starts from a complete state instead of waiting for
+// streams that are only sent incrementally or once. The cache shares the
+// published frames instead of copying them, so an entry keeps its whole
+// frame alive, images and all, until each of the frame's streams is updated
+// again or expires, and one Update() longer in the older of the two
+// versions of the index. A snapshot reads a fixed version and never holds
+// up Update(), which brings the older version up to date by replaying the
+// previous changes, so it only touches the streams that changed instead of
+// copying the index.
+class StateCache {
+ public:
+  explicit StateCache(StateCacheOption option = {});
+
+  StateCache(const StateCache&) = delete;
+  StateCache& operator=(const StateCache&) = delete;
+
+  // Records the streams of a published frame, the frame must not change
+  // afterwards. Concurrent calls are serialized among themselves only.
+  void Update(std::shared_ptr<const Frame> frame);
+
+  // COMPLETE_STATE frame with the latest value of every stream, stamped
+  // with the latest timestamp seen. Images held by reference stay so.
+  Frame Snapshot() const;
+
+  std::size_t StreamCount() const;
+
+ private:
+  enum class Field {
+    POSE,
+    PRIMITIVE,
+    UI_PRIMITIVE,
+    FUTURE_INSTANCES,
+    VARIABLE,
+    ANNOTATION,
+    LINK,
+    TIME_SERIES,
+  };
+
+  // where the latest value of a stream is
+  struct Entry {
+    std::shared_ptr<const Frame> frame;
+    int update_index{0};
+    int time_series_index{0};
+    double timestamp{0};
+    bool persistent{false};
+  };
+
+  // time series are keyed by their object id and streams
+  using Key = std::pair<Field, std::string>;
+
+  struct State {
+    std::map<Key, Entry> entries;
+    double timestamp{0};
+  };
+
+  // an entry is erased when there is none
+  struct Change {
+    Key key;
+    std::optional<Entry> entry;
+  };
+
+  std::shared_ptr<const State> Load() const;
+
+  StateCacheOption option_;
+  std::mutex update_mutex_;
+  // only guards the pointer swap
+  mutable std::mutex state_mutex_;
+  std::shared_ptr<State> state_;
+  // the version before state_ and the changes made to it since, owned by
+  // Update()
+  std::shared_ptr<State> spare_;
+  std::vector<Change> changes_;
+};
+
+}  // namespace xviz
@@ -0,0 +1,80 @@
+/*
+ * Project: libxviz
+ * Description: C++ Implementation of XVIZ Protocol
+ * Author: Minjun Xu (mjxu96@outlook.com)
+ * -----
+ * MIT License
+ * Copyright (c) 2023 Minjun Xu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <xviz/def.h>
+
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace xviz {
+
+// Handle of a stream interned in a StreamRegistry, cheap to copy and to
+// pass to Builder instead of the stream id string
+struct StreamId {
+  uint32_t index{0};
+
+  bool operator==(const StreamId&) const = default;
+};
+
+// Interns stream ids once so that builders can keep per stream state in a
+// table indexed by StreamId. Registering is not thread-safe, register every
+// stream before sharing the registry with builders on other threads.
+class StreamRegistry {
+ public:
+  StreamRegistry() = default;
+
+  StreamRegistry(const StreamRegistry&) = delete;
+  StreamRegistry& operator=(const StreamRegistry&) = delete;
+  StreamRegistry(StreamRegistry&&) = default;
+  StreamRegistry& operator=(StreamRegistry&&) = default;
+
+  // Every stream declared in the metadata, in stream id order so that the
+  // ids are the same for the same metadata
+  static StreamRegistry FromMetadata(const Metadata& metadata);
+
+  // Returns the existing handle if the stream is already registered
+  StreamId Register(std::string_view stream_id);
+  std::optional<StreamId> Find(std::string_view stream_id) const;
+
+  // The returned reference stays valid for the lifetime of the registry
+  const std::string& Name(StreamId stream) const;
+  bool Contains(StreamId stream) const { return stream.index < names_.size(); }
+  std::size_t Size() const { return names_.size(); }
+
+ private:
+  // deque keeps the names in place so the views below stay valid
+  std::deque<std::string> names_;
+  std::unordered_map<std::string_view, uint32_t> indices_;
+};
+
+}  // namespace xviz
@@ -0,0 +1,111 @@
+/*
+ * Project: libxviz
+ * Description: C++ Implementation of XVIZ Protocol
+ * Author: Minjun Xu (mjxu96@outlook.com)
+ * -----
+ * MIT License
+ * Copyright (c) 2023 Minjun Xu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <xviz/builder/builder.h>
+
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace xviz {
+
+struct ScheduleOption {
+  // builds per second
+  double rate{10.0};
+  // due producers with a higher priority are built first in a tick
+  int priority{0};
+};
+
+struct SchedulerOption {
+  // seconds of producer time per tick, the due producers left when it runs
+  // out are built in the next tick, 0 is no limit
+  double tick_budget{0};
+};
+
+struct ScheduledStreamStats {
+  std::string name;
+  uint64_t builds{0};
+  // deadlines that passed without a build because the ticks came too late
+  uint64_t misses{0};
+  // builds put off to the next tick by the tick budget
+  uint64_t deferrals{0};
+  // seconds between the last deadline passed and the tick that built it
+  double max_lateness{0};
+  double build_seconds{0};
+};
+
+// Builds each stream at its own rate instead of every stream in every
+// frame, e.g. the pose at 50 Hz and the map at 0.1 Hz. Producers are called
+// with the scheduler's builder only when they are due, and the streams they
+// build go out as incremental updates, so the viewer keeps the rest.
+class StreamScheduler {
+ public:
+  using Producer = std::function<void(Builder&)>;
+
+  explicit StreamScheduler(SchedulerOption option = {});
+
+  StreamScheduler(const StreamScheduler&) = delete;
+  StreamScheduler& operator=(const StreamScheduler&) = delete;
+
+  // A producer may build any number of streams, they share its rate. The
+  // name only identifies it in Stats().
+  StreamScheduler& Add(std::string name, Producer producer,
+                       ScheduleOption option = {});
+
+  // Builds the producers due at `now` seconds into one frame stamped with
+  // `now`, the frame is empty if none is due
+  Frame Tick(double now);
+
+  // Earliest deadline, -infinity while a producer has not been built yet
+  double NextDue() const;
+
+  // In the order the producers were added
+  std::vector<ScheduledStreamStats> Stats() const;
+
+  // e.g. to give it a StreamRegistry or image encoders
+  Builder& GetBuilder() { return builder_; }
+
+ private:
+  struct Entry {
+    Producer producer;
+    double period{0};
+    int priority{0};
+    std::optional<double> due;
+    ScheduledStreamStats stats;
+  };
+
+  SchedulerOption option_;
+  Builder builder_;
+  std::vector<Entry> entries_;
+  // indices into entries_ by descending priority
+  std::vector<std::size_t> order_;
+};
+
+}  // namespace xviz
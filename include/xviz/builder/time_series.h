@@ -27,6 +27,7 @@
 
 #pragma once
 
+#include <xviz/builder/schema.h>
 #include <xviz/def.h>
 
 #include "builder_mixin.h"
@@ -35,11 +36,15 @@
 
 namespace xviz {
 
-template <typename BaseBuilder>
-class TimeSeriesBuilder : public BuilderMixin<TimeSeriesBuilder<BaseBuilder>,
-                                              BaseBuilder, TimeSeriesState> {
-  using BaseT = BuilderMixin<TimeSeriesBuilder<BaseBuilder>, BaseBuilder,
-                             TimeSeriesState>;
+// Builds one time series. Streams declared with a schema kind only accept
+// values of its scalar type, e.g. Value("fast") does not compile for a
+// schema::TimeSeries<StreamMetadata::FLOAT> stream.
+template <typename BaseBuilder, typename Kind = schema::AnyScalar>
+class TimeSeriesBuilder
+    : public BuilderMixin<TimeSeriesBuilder<BaseBuilder, Kind>, BaseBuilder,
+                          TimeSeriesState> {
+  using BaseT = BuilderMixin<TimeSeriesBuilder<BaseBuilder, Kind>,
+                             BaseBuilder, TimeSeriesState>;
 
  public:
   TimeSeriesBuilder(BaseBuilder& builder) : BaseT(builder) {}
@@ -50,6 +55,7 @@ class TimeSeriesBuilder : public BuilderMixin<TimeSeriesBuilder<BaseBuilder>,
   }
 
   template <xviz::concepts::TimeSeriesAcceptableType... Args>
+  requires(schema::AllowsValue<Kind, Args...>)
   TimeSeriesBuilder& Value(Args&&... args) {
     auto value = this->Data().mutable_values();
     if (value->doubles_size() || value->int32s_size() || value->bools_size() ||
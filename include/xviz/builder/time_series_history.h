@@ -0,0 +1,106 @@
+/*
+ * Project: libxviz
+ * Description: C++ Implementation of XVIZ Protocol
+ * Author: Minjun Xu (mjxu96@outlook.com)
+ * -----
+ * MIT License
+ * Copyright (c) 2023 Minjun Xu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <xviz/builder/frame.h>
+#include <xviz/def.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace xviz {
+
+// Recent samples of numeric time series streams kept on the server, so a
+// viewer opening a plot mid-session gets the last seconds of it instead of
+// an empty chart. Every stream has a fixed size ring overwriting its oldest
+// samples. Pushing is lock-free and never allocates, and reading the
+// backfill does not stop the writers. Each stream takes one writer at a
+// time: pushes to the same stream, e.g. Record() of the same frames from
+// several threads, have to be serialized by the caller, see Push().
+class TimeSeriesHistory {
+ public:
+  struct StreamOption {
+    // samples kept, rounded up to a power of two
+    std::size_t capacity{1024};
+    // seconds before the newest sample of the stream that are backfilled
+    double window{60};
+  };
+
+  using Handle = uint32_t;
+
+  TimeSeriesHistory() = default;
+  TimeSeriesHistory(const TimeSeriesHistory&) = delete;
+  TimeSeriesHistory& operator=(const TimeSeriesHistory&) = delete;
+
+  // All the streams have to be registered before any sample is pushed
+  Handle Register(std::string stream_id, const StreamOption& option);
+
+  Handle Register(std::string stream_id) {
+    return Register(std::move(stream_id), StreamOption());
+  }
+
+  // Different streams may be pushed from different threads. Two threads
+  // pushing to the same stream could both write a slot when one laps the
+  // other, and the slot would then hold one's sample under the other's
+  // sequence.
+  void Push(Handle handle, double timestamp, double value);
+
+  // Pushes the double and int32 values of the registered streams in a
+  // published update, time series of an object are not kept
+  void Record(const StateUpdate& update);
+
+  // The kept samples of every stream in timestamp order, one StreamSet per
+  // timestamp and at most `max_updates` StreamSets per frame
+  std::vector<Frame> Backfill(std::size_t max_updates = 256) const;
+
+ private:
+  struct Slot {
+    // index + 1 of the sample once it is fully written, 0 while it is
+    // being overwritten
+    std::atomic<uint64_t> sequence{0};
+    std::atomic<double> timestamp{0};
+    std::atomic<double> value{0};
+  };
+
+  struct Stream {
+    std::string stream_id;
+    StreamOption option;
+    std::unique_ptr<Slot[]> slots;
+    uint64_t mask{0};
+    alignas(64) std::atomic<uint64_t> write_index{0};
+  };
+
+  std::vector<std::unique_ptr<Stream>> streams_;
+  std::unordered_map<std::string, Handle> handles_;
+};
+
+}  // namespace xviz
@@ -28,14 +28,64 @@
 #pragma once
 
 #include <xviz/def.h>
+#include <xviz/utils/tree_table.h>
 #include <xviz/utils/utils.h>
 
 #include "builder_mixin.h"
 
 #include <string>
+#include <vector>
 
 namespace xviz {
 
+// A tree table kept across frames. Rows are formatted once and later frames
+// only format the rows that changed.
+class ColumnarTreeTable {
+ public:
+  ColumnarTreeTable& Column(const std::string& display_text,
+                            xviz::TreeTableColumn::ColumnType column_type,
+                            const std::string& unit = "") {
+    auto new_column = data_.add_columns();
+    new_column->set_display_text(display_text);
+    new_column->set_type(column_type);
+    new_column->set_unit(unit);
+    return *this;
+  }
+
+  // Replaces all the rows
+  ColumnarTreeTable& Rows(
+      std::span<const int> ids, std::span<const int> parents,
+      const std::vector<xviz::util::TreeTableColumnView>& columns) {
+    data_.mutable_nodes()->Clear();
+    xviz::util::AppendTreeTableRows(data_, ids, parents, columns);
+    return *this;
+  }
+
+  ColumnarTreeTable& Rows(
+      std::span<const int> ids,
+      const std::vector<xviz::util::TreeTableColumnView>& columns) {
+    return Rows(ids, {}, columns);
+  }
+
+  // Only formats the rows at `positions` again, the columns still hold the
+  // values of every row
+  ColumnarTreeTable& UpdateRows(
+      std::span<const uint32_t> positions,
+      const std::vector<xviz::util::TreeTableColumnView>& columns) {
+    xviz::util::UpdateTreeTableRows(data_, positions, columns);
+    return *this;
+  }
+
+  void Clear() { data_.Clear(); }
+
+  void Swap(xviz::TreeTable& other) { data_.Swap(&other); }
+
+  const xviz::TreeTable& Data() const { return data_; }
+
+ private:
+  xviz::TreeTable data_;
+};
+
 template <typename BaseBuilder>
 class UIPrimitiveBuilder : public BuilderMixin<UIPrimitiveBuilder<BaseBuilder>,
                                                BaseBuilder, UIPrimitiveState> {
@@ -91,6 +141,36 @@ class UIPrimitiveBuilder : public BuilderMixin<UIPrimitiveBuilder<BaseBuilder>,
       int id, const std::vector<xviz::util::TreeTableValueVariant>& values) {
     return Row(id, 0, values);
   }
+
+  // Adds one row per id from typed columns, which is much cheaper than Row()
+  // for large tables
+  UIPrimitiveBuilder& Rows(
+      std::span<const int> ids, std::span<const int> parents,
+      const std::vector<xviz::util::TreeTableColumnView>& columns) {
+    xviz::util::AppendTreeTableRows(*this->Data().mutable_treetable(), ids,
+                                    parents, columns);
+    return *this;
+  }
+
+  UIPrimitiveBuilder& Rows(
+      std::span<const int> ids,
+      const std::vector<xviz::util::TreeTableColumnView>& columns) {
+    return Rows(ids, {}, columns);
+  }
+
+  // Copies every row of the table, the table can be updated and sent again
+  UIPrimitiveBuilder& TreeTable(const ColumnarTreeTable& table) {
+    *this->Data().mutable_treetable() = table.Data();
+    return *this;
+  }
+
+  // Swaps the rows of the table into the primitive without copying or
+  // formatting them again, the table is left empty
+  UIPrimitiveBuilder& TreeTable(ColumnarTreeTable&& table) {
+    table.Swap(*this->Data().mutable_treetable());
+    table.Clear();
+    return *this;
+  }
 };
 
 }  // namespace xviz
\ No newline at end of file
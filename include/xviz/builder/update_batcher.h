@@ -0,0 +1,80 @@
+/*
+ * Project: libxviz
+ * Description: C++ Implementation of XVIZ Protocol
+ * Author: Minjun Xu (mjxu96@outlook.com)
+ * -----
+ * MIT License
+ * Copyright (c) 2023 Minjun Xu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <xviz/builder/frame.h>
+#include <xviz/def.h>
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace xviz {
+
+struct BatchOption {
+  // a batch is sent as soon as it reaches one of the limits
+  std::size_t max_updates{32};
+  std::size_t max_bytes{1 << 20};
+  // seconds between the first and the last StreamSet timestamp of a batch
+  double max_window{0.5};
+};
+
+// Packs the StreamSets of consecutive frames into one StateUpdate, so that
+// playback and catch-up send a few large messages instead of many small
+// ones. The StreamSets are moved, not copied, and the images held by
+// reference follow them. Frames of different update types are not mixed.
+class UpdateBatcher {
+ public:
+  using Sink = std::function<void(Frame&&)>;
+
+  explicit UpdateBatcher(Sink sink, BatchOption option = {});
+
+  UpdateBatcher(const UpdateBatcher&) = delete;
+  UpdateBatcher& operator=(const UpdateBatcher&) = delete;
+
+  // May send the pending batch before and after adding the frame
+  void Add(Frame&& frame);
+  // Sends the pending batch if there is one, e.g. at the end of a playback
+  void Flush();
+
+  std::size_t PendingUpdates() const;
+  std::size_t PendingBytes() const { return bytes_; }
+
+ private:
+  Sink sink_;
+  BatchOption option_;
+  std::shared_ptr<StateUpdateRecycler> recycler_;
+
+  std::unique_ptr<StateUpdate> batch_;
+  std::vector<ImageReference> images_;
+  std::vector<StreamSet*> extracted_;
+  std::size_t bytes_{0};
+  double first_timestamp_{0};
+};
+
+}  // namespace xviz
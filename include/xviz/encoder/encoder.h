@@ -0,0 +1,104 @@
+/*
+ * Project: libxviz
+ * Description: C++ Implementation of XVIZ Protocol
+ * Author: Minjun Xu (mjxu96@outlook.com)
+ * -----
+ * MIT License
+ * Copyright (c) 2023 Minjun Xu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <xviz/builder/frame.h>
+#include <xviz/def.h>
+#include <xviz/encoder/output_chain.h>
+#include <xviz/encoder/protobuf_writer.h>
+#include <xviz/utils/image_buffer.h>
+
+#include <google/protobuf/util/json_util.h>
+
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace xviz {
+
+// Long-lived encoder of state updates. Unlike Message it does not copy the
+// message, and it keeps its buffers across frames, so encoding the binary
+// output does not allocate once the buffers have grown to the frame size.
+class Encoder {
+ public:
+  Encoder();
+  // Serializes the large parts of the binary output and converts the large
+  // parts of the JSON text on the shared thread pool, see ProtobufWriter and
+  // ConvertEnvelopeToJson(). Only the string outputs are written this way.
+  explicit Encoder(ParallelWriteOption option);
+
+  Encoder(const Encoder&) = delete;
+  Encoder& operator=(const Encoder&) = delete;
+
+  // See ProtobufWriter::SetDeterministic(), applies to the JSON text too
+  void SetDeterministic(bool deterministic) {
+    writer_.SetDeterministic(deterministic);
+  }
+
+  // Per stream hashes of the last deterministic output into a string
+  std::span<const StreamHash> StreamHashes() const {
+    return writer_.StreamHashes();
+  }
+
+  // The returned bytes are valid until the next call
+  std::string_view ToProtobufBinary(
+      const StateUpdate& message,
+      std::span<const ImageReference> images = {});
+
+  void ToProtobufBinary(const StateUpdate& message,
+                        std::span<const ImageReference> images,
+                        OutputChain& output);
+
+  std::string_view ToProtobufBinary(const Frame& frame) {
+    return ToProtobufBinary(frame.Data(), frame.ImageReferences());
+  }
+
+  void ToProtobufBinary(const Frame& frame, OutputChain& output) {
+    ToProtobufBinary(frame.Data(), frame.ImageReferences(), output);
+  }
+
+  // The returned text is valid until the next call. Only the buffers are
+  // reused here, protobuf's JSON conversion allocates on its own.
+  std::string_view ToJsonString(const StateUpdate& message,
+                                std::span<const ImageReference> images = {});
+
+  std::string_view ToJsonString(const Frame& frame) {
+    return ToJsonString(frame.Data(), frame.ImageReferences());
+  }
+
+ private:
+  ProtobufWriter writer_;
+  std::optional<ParallelWriteOption> parallel_;
+  std::string binary_;
+  std::string json_binary_;
+  std::string json_;
+  google::protobuf::util::JsonPrintOptions json_print_option_;
+};
+
+}  // namespace xviz
@@ -0,0 +1,92 @@
+/*
+ * Project: libxviz
+ * Description: C++ Implementation of XVIZ Protocol
+ * Author: Minjun Xu (mjxu96@outlook.com)
+ * -----
+ * MIT License
+ * Copyright (c) 2023 Minjun Xu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <xviz/builder/frame.h>
+#include <xviz/def.h>
+#include <xviz/utils/image_buffer.h>
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace xviz {
+
+struct PackOption {
+  // higher is kept first, streams not listed get default_priority
+  std::unordered_map<std::string, int> priorities;
+  int default_priority{0};
+  // streams of the same content at decreasing levels of detail, finest
+  // first, e.g. the streams of Builder::PointLOD()
+  std::vector<std::vector<std::string>> lod_groups;
+};
+
+struct PackedStream {
+  int update_index{0};
+  std::string stream_id;
+  // serialized size, including the images held by reference
+  std::size_t bytes{0};
+};
+
+struct PackReport {
+  // serialized size of the packed StateUpdate and its referenced images,
+  // a few bytes over when the length of a StreamSet gets shorter
+  std::size_t bytes{0};
+  // streams left out, the viewer keeps showing what it had for them
+  std::vector<PackedStream> dropped;
+  // levels of detail other than the one kept, they are sent empty so the
+  // viewer stops showing them
+  std::vector<PackedStream> cleared;
+};
+
+// Fits a frame into a byte budget, e.g. per client on a cellular uplink.
+// Streams are kept by descending priority and the smaller one first on a
+// tie, so time series are kept ahead of images. A level of detail group
+// always keeps exactly one level, the finest that fits, and the others are
+// sent empty. The sizes come from one ByteSizeLong() of the whole message,
+// nothing is serialized.
+class FramePacker {
+ public:
+  explicit FramePacker(PackOption option = {});
+
+  PackReport Pack(StateUpdate& data, std::vector<ImageReference>& images,
+                  std::size_t budget) const;
+  PackReport Pack(Frame& frame, std::size_t budget) const;
+
+ private:
+  int Priority(std::string_view stream_id) const;
+
+  PackOption option_;
+  // group and level of every stream in option_.lod_groups
+  std::unordered_map<std::string, std::pair<std::size_t, std::size_t>>
+      lod_levels_;
+};
+
+}  // namespace xviz
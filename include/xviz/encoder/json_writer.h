@@ -0,0 +1,68 @@
+/*
+ * Project: libxviz
+ * Description: C++ Implementation of XVIZ Protocol
+ * Author: Minjun Xu (mjxu96@outlook.com)
+ * -----
+ * MIT License
+ * Copyright (c) 2023 Minjun Xu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <xviz/def.h>
+#include <xviz/encoder/output_chain.h>
+#include <xviz/encoder/protobuf_writer.h>
+#include <xviz/utils/image_buffer.h>
+
+#include <google/protobuf/util/json_util.h>
+
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace xviz {
+
+// Writes the JSON envelope of `message` into `output`, the text is the same
+// as the one of Message<StateUpdate>::ToJsonString() after the images are
+// copied into the message
+void WriteJsonEnvelope(
+    const StateUpdate& message, std::span<const ImageReference> images,
+    OutputChain& output,
+    const google::protobuf::util::JsonPrintOptions& options);
+
+// Converts a "PBE1" prefixed binary envelope of a StateUpdate, appending the
+// text to `output`
+void ConvertEnvelopeToJson(
+    std::string_view binary, std::string& output,
+    const google::protobuf::util::JsonPrintOptions& options);
+
+// Same text as above. The streams, primitives and float arrays of at least
+// `parallel.min_slice_bytes` are converted on their own on the shared
+// thread pool. The envelope, the members and the map keys around them are
+// written here: members in field number order, map entries and repeated
+// values in the order of the binary. Pretty printing and
+// always_print_primitive_fields use the sequential conversion.
+void ConvertEnvelopeToJson(
+    std::string_view binary, std::string& output,
+    const google::protobuf::util::JsonPrintOptions& options,
+    const ParallelWriteOption& parallel);
+
+}  // namespace xviz
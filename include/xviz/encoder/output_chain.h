@@ -0,0 +1,144 @@
+/*
+ * Project: libxviz
+ * Description: C++ Implementation of XVIZ Protocol
+ * Author: Minjun Xu (mjxu96@outlook.com)
+ * -----
+ * MIT License
+ * Copyright (c) 2023 Minjun Xu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <xviz/utils/image_buffer.h>
+
+#include <google/protobuf/io/zero_copy_stream.h>
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/uio.h>
+#endif
+
+namespace xviz {
+
+#ifdef _WIN32
+// same layout as the POSIX one, convert to WSABUF or copy out on Windows
+struct iovec {
+  void* iov_base;
+  std::size_t iov_len;
+};
+#else
+using ::iovec;
+#endif
+
+// Thread-safe pool of fixed-size slices shared by output chains
+class SlicePool {
+ public:
+  explicit SlicePool(std::size_t slice_size = 64 * 1024,
+                     std::size_t max_idle_slices = 1024);
+
+  SlicePool(const SlicePool&) = delete;
+  SlicePool& operator=(const SlicePool&) = delete;
+
+  static SlicePool& Shared();
+
+  std::size_t SliceSize() const { return slice_size_; }
+  std::size_t IdleSlices() const;
+
+  std::unique_ptr<uint8_t[]> Acquire();
+  // Slices above max_idle_slices are freed
+  void Release(std::vector<std::unique_ptr<uint8_t[]>>& slices);
+
+ private:
+  std::size_t slice_size_;
+  std::size_t max_idle_slices_;
+  mutable std::mutex mutex_;
+  std::vector<std::unique_ptr<uint8_t[]>> idle_;
+  std::size_t created_{0};
+};
+
+// Output made of pooled slices and spliced external buffers, exposed as an
+// iovec array so it can be sent with writev()/sendmsg() without flattening
+class OutputChain : public google::protobuf::io::ZeroCopyOutputStream {
+ public:
+  explicit OutputChain(SlicePool& pool = SlicePool::Shared());
+  ~OutputChain() override;
+
+  OutputChain(const OutputChain&) = delete;
+  OutputChain& operator=(const OutputChain&) = delete;
+
+  bool Next(void** data, int* size) override;
+  void BackUp(int count) override;
+  int64_t ByteCount() const override { return byte_count_; }
+
+  // Appends the buffer without copying it, the chain keeps it alive
+  void Splice(ImageBuffer buffer);
+
+  SlicePool& Pool() const { return *pool_; }
+
+  // Valid until the chain is written to or cleared
+  std::span<const iovec> IoVecs() const { return iovecs_; }
+  std::size_t Size() const { return static_cast<std::size_t>(byte_count_); }
+
+  void AppendTo(std::string& output) const;
+  std::string ToString() const;
+
+  // Returns the slices to the pool once the content is sent
+  void Clear();
+
+ private:
+  SlicePool* pool_;
+  std::vector<std::unique_ptr<uint8_t[]>> slices_;
+  // unused part of the last slice
+  uint8_t* cursor_{nullptr};
+  std::size_t available_{0};
+  bool last_iovec_owned_{false};
+
+  std::vector<iovec> iovecs_;
+  std::vector<ImageBuffer> spliced_;
+  int64_t byte_count_{0};
+};
+
+// Reads the content of a chain, e.g. to convert it without flattening it
+class OutputChainInputStream
+    : public google::protobuf::io::ZeroCopyInputStream {
+ public:
+  explicit OutputChainInputStream(const OutputChain& chain)
+      : iovecs_(chain.IoVecs()) {}
+
+  bool Next(const void** data, int* size) override;
+  void BackUp(int count) override;
+  bool Skip(int count) override;
+  int64_t ByteCount() const override { return byte_count_; }
+
+ private:
+  std::span<const iovec> iovecs_;
+  std::size_t index_{0};
+  std::size_t offset_{0};
+  int64_t byte_count_{0};
+};
+
+}  // namespace xviz
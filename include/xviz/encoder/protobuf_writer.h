@@ -0,0 +1,213 @@
+/*
+ * Project: libxviz
+ * Description: C++ Implementation of XVIZ Protocol
+ * Author: Minjun Xu (mjxu96@outlook.com)
+ * -----
+ * MIT License
+ * Copyright (c) 2023 Minjun Xu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <xviz/def.h>
+#include <xviz/encoder/output_chain.h>
+#include <xviz/utils/image_buffer.h>
+
+#include <google/protobuf/message_lite.h>
+
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace xviz {
+
+// Hash of the serialized value of one stream in one StreamSet
+struct StreamHash {
+  int update_index;
+  // points into the StateUpdate that was written
+  std::string_view stream_id;
+  uint64_t hash;
+
+  bool operator==(const StreamHash&) const = default;
+};
+
+struct ParallelWriteOption {
+  // 0 means one per thread of the shared pool
+  uint32_t thread_count{0};
+  // smaller messages and images are written by the calling thread while
+  // the output is laid out
+  std::size_t min_slice_bytes{64 * 1024};
+};
+
+// Serializes the envelope of a StateUpdate field by field the way the
+// generated code does, except that referenced images are spliced into the
+// output instead of being copied into the message first. The scratch
+// buffers are kept across messages.
+class ProtobufWriter {
+ public:
+  ProtobufWriter() = default;
+  // Makes Write() into a string serialize the large poses, primitives and
+  // images on the shared thread pool. The calling thread writes the tags
+  // and lengths around them and leaves a slice of the exact size for each,
+  // the output does not change.
+  explicit ProtobufWriter(ParallelWriteOption option);
+
+  // Writes the "PBE1" prefixed envelope. The bytes are the same as the ones
+  // of Message<StateUpdate>::ToProtobufBinary() after the images are copied
+  // into the message.
+  void Write(const StateUpdate& message,
+             std::span<const ImageReference> images, OutputChain& output);
+
+  // Same as above but appends to `output` with the images copied once
+  void Write(const StateUpdate& message,
+             std::span<const ImageReference> images, std::string& output);
+
+  // Orders the map entries by key, nested ones included, the way protobuf's
+  // deterministic serialization does, so that equal messages give equal
+  // bytes whatever the order the maps were filled in. Writing into a
+  // string then also hashes the bytes of each stream, see StreamHashes().
+  void SetDeterministic(bool deterministic) { deterministic_ = deterministic; }
+
+  // Per stream hashes of the last deterministic Write() into a string, in
+  // the order the streams were written. The time series of a stream are
+  // combined. A StreamSet with unknown fields is written whole, its streams
+  // are only hashed if it holds referenced images. Valid until the next
+  // Write().
+  std::span<const StreamHash> StreamHashes() const { return hashes_; }
+
+  // Number of fields of the messages written field by field. A field added
+  // to the protocol has to be written by ProtobufWriter too, the tests
+  // compare these with the descriptors.
+  static constexpr int kStateUpdateFieldCount = 2;
+  static constexpr int kStreamSetFieldCount = 10;
+  static constexpr int kPrimitiveStateFieldCount = 7;
+  static constexpr int kImageFieldCount = 5;
+
+  // a message or an image left to the pool, `size` bytes at `target`
+  struct Slice {
+    const google::protobuf::MessageLite* message;
+    std::span<const uint8_t> bytes;
+    uint8_t* target;
+    std::size_t size;
+  };
+
+ private:
+  struct ResolvedImage {
+    const StreamSet* update;
+    const PrimitiveState* primitive;
+    const Image* image;
+    const ImageBuffer* buffer;
+  };
+
+  // resolves the images and computes the sizes, returns the envelope size
+  std::size_t Prepare(const StateUpdate& message,
+                      std::span<const ImageReference> images);
+  template <typename SinkT>
+  void WriteEnvelope(SinkT& sink);
+  void WriteSlices();
+
+  // Calls func(key, value) for every entry, ordered by key when the output
+  // is deterministic. Not reentrant, the order is kept in a member.
+  template <typename MapT, typename FuncT>
+  void ForEachEntry(const MapT& map, FuncT&& func);
+  template <typename MapT, typename SinkT>
+  void WriteEntries(int field, const MapT& map, SinkT& sink);
+  // the stream's value is at [begin, end) of the output
+  void RecordHash(int field, const std::string& stream_id, std::size_t begin,
+                  std::size_t end);
+  void ComputeHashes(std::string_view output);
+
+  bool HasImages(const StreamSet& update) const;
+  bool HasImages(const PrimitiveState& primitive) const;
+  const ImageBuffer* FindBuffer(const Image& image) const;
+
+  // Whether a message is written field by field instead of as a whole, the
+  // case when its parts are sliced or hashed. Messages with unknown fields
+  // are written whole unless images have to be spliced into them, then the
+  // unknown fields are written last like the generated code does.
+  bool Expand(const StreamSet& update) const;
+  bool Expand(const PrimitiveState& primitive) const;
+
+  // Sizes of the messages containing referenced images are computed
+  // children first and used parents first, so they are stored in slots
+  // reserved in the order the messages are written
+  std::size_t ReserveSize() {
+    sizes_.push_back(0);
+    return sizes_.size() - 1;
+  }
+  std::size_t NextSize() { return sizes_[next_size_++]; }
+
+  std::size_t StreamSetSize(const StreamSet& update);
+  template <typename SinkT>
+  void WriteStreamSet(const StreamSet& update, SinkT& sink);
+  std::size_t PrimitiveStateSize(const PrimitiveState& primitive);
+  // returns the position of the value
+  template <typename SinkT>
+  std::size_t WritePrimitiveState(const std::string& stream_id,
+                                  const PrimitiveState& primitive,
+                                  SinkT& sink);
+  std::size_t ImageSize(const Image& image, const ImageBuffer& buffer);
+  template <typename SinkT>
+  void WriteImage(const Image& image, const ImageBuffer& buffer, SinkT& sink);
+
+  const StateUpdate* message_{nullptr};
+  std::size_t message_size_{0};
+  std::vector<ResolvedImage> images_;
+  std::vector<std::size_t> sizes_;
+  std::size_t next_size_{0};
+
+  std::optional<ParallelWriteOption> parallel_;
+  bool split_{false};
+  std::vector<Slice> slices_;
+  // one past the last slice of each chunk of the pool
+  std::vector<std::size_t> chunk_ends_;
+
+  struct PendingHash {
+    int update_index;
+    int field;
+    const std::string* stream_id;
+    std::size_t begin;
+    std::size_t end;
+  };
+
+  bool deterministic_{false};
+  bool hashing_{false};
+  int update_index_{0};
+  std::vector<const void*> order_;
+  std::vector<PendingHash> pending_hashes_;
+  std::vector<StreamHash> hashes_;
+  // index into hashes_ of the time series streams of the current StreamSet
+  std::unordered_map<std::string_view, std::size_t> time_series_hashes_;
+};
+
+// One-off versions of ProtobufWriter::Write()
+void WriteProtobufEnvelope(const StateUpdate& message,
+                           std::span<const ImageReference> images,
+                           OutputChain& output);
+
+void WriteProtobufEnvelope(const StateUpdate& message,
+                           std::span<const ImageReference> images,
+                           std::string& output);
+
+}  // namespace xviz
@@ -28,6 +28,11 @@
 #pragma once
 
 #include <xviz/builder/builder.h>
+#include <xviz/encoder/json_writer.h>
+#include <xviz/encoder/protobuf_writer.h>
+#include <xviz/utils/image_buffer.h>
+#include <xviz/utils/metrics.h>
+#include <xviz/utils/trace.h>
 
 #include <google/protobuf/struct.pb.h>
 #include <google/protobuf/stubs/common.h>
@@ -57,21 +62,76 @@ class Message {
     json_print_option_.preserve_proto_field_names = true;
   }
 
+  // The images held by reference are spliced in when serializing
+  template <typename MessageT>
+  requires(std::same_as<MessageType, StateUpdate>)
+  Message(MessageT&& message, std::vector<ImageReference> images)
+      : message_(std::forward<MessageT>(message)), images_(std::move(images)) {
+    json_print_option_.preserve_proto_field_names = true;
+  }
+
+  // Moves the data out of a finished frame. The move swaps, so the frame is
+  // left with an emptied update that it still hands back to its recycler
+  explicit Message(Frame&& frame) requires(
+      std::same_as<MessageType, StateUpdate>)
+      : message_(std::move(frame.MutableData())),
+        images_(frame.ImageReferences().begin(),
+                frame.ImageReferences().end()) {
+    json_print_option_.preserve_proto_field_names = true;
+  }
+
   Message(const Message&) = default;
   Message& operator=(const Message&) = default;
   Message(Message&&) = default;
   Message& operator=(Message&&) = default;
 
   std::string ToJsonString() {
+    trace::Span span("Message::ToJsonString", "encode");
+    detail::EncodeMetrics metrics(MessageFormat::JSON);
     std::string ret;
     Envelope evenlope;
     evenlope.set_type(type_.data());
-    evenlope.mutable_data()->PackFrom(message_);
+    if constexpr (std::same_as<MessageType, StateUpdate>) {
+      if (!images_.empty()) {
+        StateUpdate materialized = message_;
+        util::MaterializeImages(materialized, images_);
+        evenlope.mutable_data()->PackFrom(materialized);
+      } else {
+        evenlope.mutable_data()->PackFrom(message_);
+      }
+    } else {
+      evenlope.mutable_data()->PackFrom(message_);
+    }
     google::protobuf::util::MessageToJsonString(
         util::PatchMessage<MessageType>(evenlope), &ret, json_print_option_);
+    metrics.Record(message_, ret.size());
+    return ret;
+  }
+
+  // Same text as ToJsonString(), the large streams and point arrays being
+  // serialized and converted on the shared thread pool
+  std::string ToJsonString(const ParallelWriteOption& parallel) requires(
+      std::same_as<MessageType, StateUpdate>) {
+    trace::Span span("Message::ToJsonString", "encode");
+    detail::EncodeMetrics metrics(MessageFormat::JSON);
+    std::string binary;
+    ProtobufWriter(parallel).Write(message_, images_, binary);
+    std::string ret;
+    ConvertEnvelopeToJson(binary, ret, json_print_option_, parallel);
+    metrics.Record(message_, ret.size());
     return ret;
   }
 
+  // Same text as ToJsonString(), written into pooled slices
+  void ToJsonString(OutputChain& output) requires(
+      std::same_as<MessageType, StateUpdate>) {
+    trace::Span span("Message::ToJsonString", "encode");
+    detail::EncodeMetrics metrics(MessageFormat::JSON);
+    auto size = output.Size();
+    WriteJsonEnvelope(message_, images_, output, json_print_option_);
+    metrics.Record(message_, output.Size() - size);
+  }
+
   google::protobuf::Struct ToProtobufStruct() requires(
       std::same_as<MessageType, xviz::Metadata>) {
     Envelope evenlope;
@@ -81,16 +141,58 @@ class Message {
   }
 
   std::string ToProtobufBinary() {
+    trace::Span span("Message::ToProtobufBinary", "encode");
+    detail::EncodeMetrics metrics(MessageFormat::PROTOBUF);
+    if constexpr (std::same_as<MessageType, StateUpdate>) {
+      if (!images_.empty()) {
+        std::string ret;
+        WriteProtobufEnvelope(message_, images_, ret);
+        metrics.Record(message_, ret.size(), images_);
+        return ret;
+      }
+    }
     std::string ret = "\x50\x42\x45\x31";
     Envelope evenlope;
     evenlope.set_type(type_.data());
     evenlope.mutable_data()->PackFrom(message_);
     evenlope.AppendToString(&ret);
+    metrics.Record(message_, ret.size());
+    return ret;
+  }
+
+  // Same as ToProtobufBinary() with the map entries ordered by key, equal
+  // messages give equal bytes. `hashes` receives a hash of the bytes of
+  // each stream, which points into this message.
+  std::string ToDeterministicProtobufBinary(
+      std::vector<StreamHash>* hashes = nullptr) requires(
+      std::same_as<MessageType, StateUpdate>) {
+    trace::Span span("Message::ToProtobufBinary", "encode");
+    detail::EncodeMetrics metrics(MessageFormat::PROTOBUF);
+    ProtobufWriter writer;
+    writer.SetDeterministic(true);
+    std::string ret;
+    writer.Write(message_, images_, ret);
+    if (hashes) {
+      hashes->assign(writer.StreamHashes().begin(),
+                     writer.StreamHashes().end());
+    }
+    metrics.Record(message_, ret.size(), images_);
     return ret;
   }
 
+  // Same bytes as ToProtobufBinary(), the images are not copied
+  void ToProtobufBinary(OutputChain& output) requires(
+      std::same_as<MessageType, StateUpdate>) {
+    trace::Span span("Message::ToProtobufBinary", "encode");
+    detail::EncodeMetrics metrics(MessageFormat::PROTOBUF);
+    auto size = output.Size();
+    WriteProtobufEnvelope(message_, images_, output);
+    metrics.Record(message_, output.Size() - size, images_);
+  }
+
  private:
   MessageType message_;
+  std::vector<ImageReference> images_;
   constexpr static std::string_view type_ = MessageTypeStr<MessageType>::value;
   google::protobuf::util::JsonPrintOptions json_print_option_;
 };
@@ -0,0 +1,51 @@
+/*
+ * Project: libxviz
+ * Description: C++ Implementation of XVIZ Protocol
+ * Author: Minjun Xu (mjxu96@outlook.com)
+ * -----
+ * MIT License
+ * Copyright (c) 2023 Minjun Xu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+namespace xviz::util {
+
+// 64-bit MurmurHash64A of `bytes`, 8 bytes per step. Not meant for
+// anything adversarial, only for cache keys and change detection.
+uint64_t Hash64(std::span<const uint8_t> bytes, uint64_t seed = 0);
+
+inline uint64_t Hash64(std::string_view bytes, uint64_t seed = 0) {
+  return Hash64(std::span(reinterpret_cast<const uint8_t*>(bytes.data()),
+                          bytes.size()),
+                seed);
+}
+
+// Order dependent combination of two hashes
+inline uint64_t HashCombine(uint64_t hash, uint64_t other) {
+  return hash ^ (other + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2));
+}
+
+}  // namespace xviz::util
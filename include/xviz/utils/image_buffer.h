@@ -0,0 +1,95 @@
+/*
+ * Project: libxviz
+ * Description: C++ Implementation of XVIZ Protocol
+ * Author: Minjun Xu (mjxu96@outlook.com)
+ * -----
+ * MIT License
+ * Copyright (c) 2023 Minjun Xu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <xviz/def.h>
+
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace xviz {
+
+// Encoded image held by reference instead of being copied into the message
+class ImageBuffer {
+ public:
+  ImageBuffer() = default;
+
+  explicit ImageBuffer(std::shared_ptr<const std::string> data)
+      : bytes_(reinterpret_cast<const uint8_t*>(data->data()), data->size()),
+        owner_(std::move(data)) {}
+
+  explicit ImageBuffer(std::shared_ptr<const std::vector<uint8_t>> data)
+      : bytes_(data->data(), data->size()), owner_(std::move(data)) {}
+
+  // The bytes stay owned by the caller and have to outlive every message
+  // encoded with them
+  static ImageBuffer Borrow(std::span<const uint8_t> bytes) {
+    ImageBuffer ret;
+    ret.bytes_ = bytes;
+    return ret;
+  }
+
+  std::span<const uint8_t> Bytes() const { return bytes_; }
+  std::size_t Size() const { return bytes_.size(); }
+  bool Empty() const { return bytes_.empty(); }
+
+  std::string_view View() const {
+    return {reinterpret_cast<const char*>(bytes_.data()), bytes_.size()};
+  }
+
+ private:
+  std::span<const uint8_t> bytes_{};
+  std::shared_ptr<const void> owner_{};
+};
+
+// Where a referenced image belongs in a StateUpdate, it is the data of
+// updates(update_index).primitives().at(stream_id).images(image_index)
+struct ImageReference {
+  int update_index{0};
+  std::string stream_id;
+  int image_index{0};
+  ImageBuffer buffer;
+};
+
+namespace util {
+
+// Returns the image `reference` points to, throws if it does not exist
+const Image& FindReferencedImage(const StateUpdate& message,
+                                 const ImageReference& reference);
+
+// Copies the referenced images into the message, e.g. before converting it
+// to JSON
+void MaterializeImages(StateUpdate& message,
+                       std::span<const ImageReference> images);
+
+}  // namespace util
+}  // namespace xviz
@@ -0,0 +1,151 @@
+/*
+ * Project: libxviz
+ * Description: C++ Implementation of XVIZ Protocol
+ * Author: Minjun Xu (mjxu96@outlook.com)
+ * -----
+ * MIT License
+ * Copyright (c) 2023 Minjun Xu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <xviz/utils/thread_pool.h>
+
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace xviz {
+
+enum class PixelFormat {
+  GRAY8,
+  RGB8,
+  BGR8,
+  RGBA8,
+  BGRA8,
+};
+
+std::size_t BytesPerPixel(PixelFormat format);
+
+// Raw camera frame. The pixels are not copied, they have to stay valid until
+// the encoding is joined unless `owner` keeps them alive.
+struct RawImage {
+  std::span<const uint8_t> pixels;
+  uint32_t width{0};
+  uint32_t height{0};
+  PixelFormat format{PixelFormat::RGB8};
+  // bytes per row, 0 means tightly packed
+  std::size_t stride{0};
+  std::shared_ptr<const void> owner{};
+
+  std::size_t RowStride() const {
+    return stride ? stride : width * BytesPerPixel(format);
+  }
+};
+
+struct ImageEncodeOption {
+  // 0 - 100, its meaning is up to the encoder given to ImageEncoderPool.
+  // The built-in PngStoreEncoder ignores it and never compresses.
+  int quality{90};
+  // resize before encoding, 0 keeps the aspect ratio of the other side and
+  // both 0 keep the original size
+  uint32_t width{0};
+  uint32_t height{0};
+
+  std::pair<uint32_t, uint32_t> OutputSize(uint32_t width_px,
+                                           uint32_t height_px) const;
+};
+
+// Encoder context, one is created per camera and reused across frames, so it
+// can keep its compressor state and scratch buffers around. It is never used
+// by two threads at the same time.
+class ImageEncoder {
+ public:
+  virtual ~ImageEncoder() = default;
+  virtual void Encode(const RawImage& image, const ImageEncodeOption& option,
+                      std::string& output) = 0;
+};
+
+// PNG with stored (uncompressed) deflate blocks, for when no codec library
+// is plugged in. The output is about as large as the raw pixels, pass a
+// factory to ImageEncoderPool to get compressed images.
+class PngStoreEncoder : public ImageEncoder {
+ public:
+  void Encode(const RawImage& image, const ImageEncodeOption& option,
+              std::string& output) override;
+
+ private:
+  std::vector<uint8_t> scanlines_;
+};
+
+using ImageEncoderFactory = std::function<std::unique_ptr<ImageEncoder>()>;
+
+// Encodes raw frames off the calling thread
+class ImageEncoderPool {
+ public:
+  // thread_count == 0 means one worker per hardware thread
+  explicit ImageEncoderPool(std::size_t thread_count = 0,
+                            ImageEncoderFactory factory = nullptr);
+
+  ImageEncoderPool(const ImageEncoderPool&) = delete;
+  ImageEncoderPool& operator=(const ImageEncoderPool&) = delete;
+
+  // pool used by builders which are not given one, encodes uncompressed PNG
+  // with PngStoreEncoder
+  static ImageEncoderPool& Shared();
+
+  // Images of the same context, e.g. the camera's stream id, are encoded one
+  // after another with the same encoder
+  std::future<std::string> Encode(std::string_view context,
+                                  const RawImage& image,
+                                  const ImageEncodeOption& option = {});
+
+ private:
+  struct Context {
+    std::mutex mutex;
+    std::unique_ptr<ImageEncoder> encoder;
+    std::vector<uint8_t> resized;
+  };
+
+  Context& GetContext(std::string_view context);
+
+  ImageEncoderFactory factory_;
+  std::mutex contexts_mutex_;
+  std::unordered_map<std::string, std::unique_ptr<Context>> contexts_;
+  // declared last so workers are joined before the contexts go away
+  util::ThreadPool workers_;
+};
+
+namespace util {
+
+// Box filter resize into `output`, returns the image pointing at it
+RawImage ResizeImage(const RawImage& image, uint32_t width, uint32_t height,
+                     std::vector<uint8_t>& output);
+
+}  // namespace util
+}  // namespace xviz
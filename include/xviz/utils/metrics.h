@@ -0,0 +1,223 @@
+/*
+ * Project: libxviz
+ * Description: C++ Implementation of XVIZ Protocol
+ * Author: Minjun Xu (mjxu96@outlook.com)
+ * -----
+ * MIT License
+ * Copyright (c) 2023 Minjun Xu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <xviz/def.h>
+#include <xviz/utils/image_buffer.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace xviz {
+
+// Recording is compiled in with the XVIZ_ENABLE_METRICS CMake option, the
+// hooks in Builder, Message and Encoder are no-ops otherwise
+#ifdef XVIZ_ENABLE_METRICS
+inline constexpr bool kMetricsEnabled = true;
+#else
+inline constexpr bool kMetricsEnabled = false;
+#endif
+
+enum class MessageFormat { PROTOBUF = 0, JSON, MESSAGE_FORMAT_COUNT };
+
+struct StreamMetrics {
+  uint64_t primitives{0};
+  // protobuf bytes of the stream's values, images held by reference
+  // included, tags and lengths excluded
+  uint64_t bytes{0};
+  uint64_t build_ns{0};
+};
+
+// Live counters of one stream, updated without locking
+struct StreamCounters {
+  std::atomic<uint64_t> primitives{0};
+  std::atomic<uint64_t> bytes{0};
+  std::atomic<uint64_t> build_ns{0};
+};
+
+struct MessageMetrics {
+  uint64_t messages{0};
+  uint64_t bytes{0};
+  uint64_t encode_ns{0};
+};
+
+struct MetricsSnapshot {
+  std::map<std::string, StreamMetrics, std::less<>> streams;
+  MessageMetrics protobuf;
+  MessageMetrics json;
+
+  // Prometheus text exposition format, or OpenMetrics with `open_metrics`
+  std::string ToPrometheus(bool open_metrics = false) const;
+};
+
+// Process wide counters, thread-safe. Only adding a stream locks, the
+// counters themselves are atomic.
+class Metrics {
+ public:
+  static Metrics& Global();
+
+  // The counters of a stream, added on first use. The reference stays valid
+  // as long as the Metrics, Reset() only zeroes the counters.
+  StreamCounters& Stream(std::string_view stream_id);
+
+  void RecordStreamBuild(std::string_view stream_id, uint64_t primitives,
+                         uint64_t build_ns);
+  void RecordStreamEncode(std::string_view stream_id, uint64_t bytes);
+  void RecordMessage(MessageFormat format, uint64_t bytes, uint64_t encode_ns);
+
+  // Streams with nothing recorded since the last Reset() are left out
+  MetricsSnapshot Snapshot() const;
+  void Reset();
+
+ private:
+  struct MessageCounters {
+    std::atomic<uint64_t> messages{0};
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<uint64_t> encode_ns{0};
+  };
+
+  mutable std::mutex mutex_;
+  // node based, so the counters stay in place
+  std::map<std::string, StreamCounters, std::less<>> streams_;
+  MessageCounters
+      messages_[static_cast<int>(MessageFormat::MESSAGE_FORMAT_COUNT)];
+};
+
+namespace detail {
+
+inline uint64_t MetricsNow() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// The counters of a stream of Metrics::Global(), the lookups are cached
+// per thread so that recording a known stream neither locks nor allocates
+StreamCounters& GlobalStream(std::string_view stream_id);
+
+// Adds the bytes of every stream of a message that was just serialized to
+// protobuf, from the sizes the serialization cached in the message
+void RecordStreamEncode(const StateUpdate& update,
+                        std::span<const ImageReference> images);
+
+// Counts one serialization, from construction to Record()
+class EncodeMetrics {
+ public:
+  explicit EncodeMetrics([[maybe_unused]] MessageFormat format) {
+#ifdef XVIZ_ENABLE_METRICS
+    format_ = format;
+    start_ns_ = MetricsNow();
+#endif
+  }
+
+  template <typename MessageT>
+  void Record([[maybe_unused]] const MessageT& message,
+              [[maybe_unused]] std::size_t bytes,
+              [[maybe_unused]] std::span<const ImageReference> images = {}) {
+#ifdef XVIZ_ENABLE_METRICS
+    auto encode_ns = MetricsNow() - start_ns_;
+    Metrics::Global().RecordMessage(format_, bytes, encode_ns);
+    if constexpr (std::is_same_v<MessageT, StateUpdate>) {
+      if (format_ == MessageFormat::PROTOBUF) {
+        RecordStreamEncode(message, images);
+      }
+    }
+#endif
+  }
+
+#ifdef XVIZ_ENABLE_METRICS
+ private:
+  MessageFormat format_;
+  uint64_t start_ns_;
+#endif
+};
+
+// Times the builder between switching streams, and records the per stream
+// totals once per frame
+class BuilderMetrics {
+ public:
+  // `stream_id` must stay valid until the frame is reset
+  void Begin([[maybe_unused]] std::string_view stream_id) {
+#ifdef XVIZ_ENABLE_METRICS
+    auto now = MetricsNow();
+    End(now);
+    stream_id_ = stream_id;
+    start_ns_ = now;
+#endif
+  }
+
+  // Only the first call of a frame is recorded
+  void Record([[maybe_unused]] const StateUpdate& update) {
+#ifdef XVIZ_ENABLE_METRICS
+    End(MetricsNow());
+    if (!recorded_) {
+      RecordFrame(update);
+      recorded_ = true;
+    }
+#endif
+  }
+
+  void Reset() {
+#ifdef XVIZ_ENABLE_METRICS
+    build_ns_.clear();
+    stream_id_ = {};
+    recorded_ = false;
+#endif
+  }
+
+#ifdef XVIZ_ENABLE_METRICS
+ private:
+  void End(uint64_t now) {
+    if (!stream_id_.empty()) {
+      build_ns_[stream_id_] += now - start_ns_;
+      stream_id_ = {};
+    }
+  }
+
+  void RecordFrame(const StateUpdate& update);
+
+  std::unordered_map<std::string_view, uint64_t> build_ns_;
+  std::string_view stream_id_;
+  uint64_t start_ns_{0};
+  bool recorded_{false};
+#endif
+};
+
+}  // namespace detail
+
+}  // namespace xviz
@@ -0,0 +1,90 @@
+/*
+ * Project: libxviz
+ * Description: C++ Implementation of XVIZ Protocol
+ * Author: Minjun Xu (mjxu96@outlook.com)
+ * -----
+ * MIT License
+ * Copyright (c) 2023 Minjun Xu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <xviz/def.h>
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace xviz {
+
+// Frames first to last, both included
+struct FrameRange {
+  uint64_t first{0};
+  uint64_t last{0};
+
+  bool operator==(const FrameRange&) const = default;
+};
+
+// Inverted index from object id to the frames and streams it appears in,
+// built while a recording is written so that an object's lifetime is found
+// without decoding every frame. Object ids are taken from primitives,
+// future instances, time series, variables and annotations. The frames of
+// an object are kept as ranges of consecutive frames, delta and varint
+// encoded, since tracks mostly last for many frames in a row.
+class ObjectIndex {
+ public:
+  // Frames are recorded in increasing order, a frame may be recorded in
+  // several calls
+  void Record(uint64_t frame, const StateUpdate& update);
+
+  std::vector<FrameRange> Frames(std::string_view object_id) const;
+  // In the order the index first saw the streams
+  std::vector<std::string_view> Streams(std::string_view object_id) const;
+
+  std::size_t ObjectCount() const { return postings_.size(); }
+  // size of the encoded frame ranges
+  std::size_t PostingBytes() const;
+
+ private:
+  struct Posting {
+    // varint pairs of the gap to the previous range and the length - 1 of
+    // each closed range
+    std::string ranges;
+    uint64_t closed_last{0};
+    // the range still growing
+    uint64_t first{0};
+    uint64_t last{0};
+    // sorted indices into stream_ids_
+    std::vector<uint32_t> streams;
+  };
+
+  void Add(const std::string& object_id, uint32_t stream, uint64_t frame);
+  uint32_t StreamIndex(const std::string& stream_id);
+
+  std::unordered_map<std::string, Posting> postings_;
+  std::vector<std::string> stream_ids_;
+  std::unordered_map<std::string, uint32_t> stream_indices_;
+  uint64_t last_frame_{0};
+};
+
+}  // namespace xviz
@@ -0,0 +1,122 @@
+/*
+ * Project: libxviz
+ * Description: C++ Implementation of XVIZ Protocol
+ * Author: Minjun Xu (mjxu96@outlook.com)
+ * -----
+ * MIT License
+ * Copyright (c) 2023 Minjun Xu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace xviz {
+
+struct PointDownsampleOption {
+  enum Method {
+    // keep the first point falling into every voxel_size sized cell
+    VOXEL_GRID,
+    // keep every stride-th point
+    UNIFORM,
+    // keep each point with probability keep_ratio
+    RANDOM,
+    // keep each point with probability (distance / reference_distance)^2,
+    // but never below keep_ratio, which evens out the near-field density of
+    // spinning LiDARs
+    DISTANCE_WEIGHTED,
+  };
+
+  Method method{VOXEL_GRID};
+  float voxel_size{0.1f};
+  uint32_t stride{1};
+  float keep_ratio{1.0f};
+  float reference_distance{10.0f};
+  // RANDOM and DISTANCE_WEIGHTED are deterministic for a given seed
+  uint64_t seed{0};
+
+  static PointDownsampleOption VoxelGrid(float voxel_size) {
+    PointDownsampleOption option;
+    option.method = VOXEL_GRID;
+    option.voxel_size = voxel_size;
+    return option;
+  }
+
+  static PointDownsampleOption Uniform(uint32_t stride) {
+    PointDownsampleOption option;
+    option.method = UNIFORM;
+    option.stride = stride;
+    return option;
+  }
+
+  static PointDownsampleOption Random(float keep_ratio, uint64_t seed = 0) {
+    PointDownsampleOption option;
+    option.method = RANDOM;
+    option.keep_ratio = keep_ratio;
+    option.seed = seed;
+    return option;
+  }
+
+  static PointDownsampleOption DistanceWeighted(float reference_distance,
+                                                float min_keep_ratio,
+                                                uint64_t seed = 0) {
+    PointDownsampleOption option;
+    option.method = DISTANCE_WEIGHTED;
+    option.reference_distance = reference_distance;
+    option.keep_ratio = min_keep_ratio;
+    option.seed = seed;
+    return option;
+  }
+};
+
+namespace util {
+
+// Both functions take x,y,z flatten points and return the indices of the
+// kept points in ascending order. Points with a NaN or infinite coordinate
+// are never kept, whatever the method. Large inputs are split across the
+// shared thread pool.
+std::vector<uint32_t> DownsamplePoints(std::span<const float> flatten_points,
+                                       const PointDownsampleOption& option,
+                                       uint32_t thread_count = 0);
+
+// Computes every level of detail in a single pass over the input.
+std::vector<std::vector<uint32_t>> DownsamplePoints(
+    std::span<const float> flatten_points,
+    std::span<const PointDownsampleOption> levels, uint32_t thread_count = 0);
+
+// Copies the elements of every kept point, each point being `stride` wide
+// (3 for points, 4 for colors).
+template <typename T>
+void GatherByIndices(std::span<const T> flatten_values,
+                     std::span<const uint32_t> indices, std::size_t stride,
+                     T* output) {
+  for (uint32_t index : indices) {
+    const T* src = flatten_values.data() + std::size_t(index) * stride;
+    for (std::size_t i = 0; i < stride; i++) {
+      *output++ = src[i];
+    }
+  }
+}
+
+}  // namespace util
+}  // namespace xviz
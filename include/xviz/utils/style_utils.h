@@ -29,6 +29,7 @@
 
 #include <xviz/def.h>
 
+#include <xviz/utils/trace.h>
 #include <xviz/utils/utils.h>
 
 #include <cstdint>
@@ -87,6 +88,7 @@ namespace detail {
 
 template <typename Ret>
 Ret ConvertInternalTypeToProtobufType(const xviz::StyleType& style) {
+  trace::Span span("ConvertInternalTypeToProtobufType", "style");
   Ret ret;
   auto refl = ret.GetReflection();
 
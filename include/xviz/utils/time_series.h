@@ -0,0 +1,62 @@
+/*
+ * Project: libxviz
+ * Description: C++ Implementation of XVIZ Protocol
+ * Author: Minjun Xu (mjxu96@outlook.com)
+ * -----
+ * MIT License
+ * Copyright (c) 2023 Minjun Xu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <xviz/def.h>
+
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+namespace xviz {
+
+struct TimeSeriesSample {
+  std::string_view stream_id;
+  std::variant<double, int32_t, bool, std::string_view> value;
+  double timestamp{0};
+  std::string_view object_id{};
+};
+
+namespace util {
+
+// Groups the samples by timestamp, object id and value type and appends one
+// TimeSeriesState per group, keeping the samples' order inside a group.
+void AppendTimeSeriesSamples(
+    google::protobuf::RepeatedPtrField<TimeSeriesState>& time_series,
+    std::span<const TimeSeriesSample> samples);
+
+// Largest triangle three buckets downsampling. Returns the ascending indices
+// of at most `threshold` points, the first and last points are always kept.
+std::vector<std::size_t> LargestTriangleThreeBuckets(std::span<const double> x,
+                                                     std::span<const double> y,
+                                                     std::size_t threshold);
+
+}  // namespace util
+}  // namespace xviz
@@ -0,0 +1,129 @@
+/*
+ * Project: libxviz
+ * Description: C++ Implementation of XVIZ Protocol
+ * Author: Minjun Xu (mjxu96@outlook.com)
+ * -----
+ * MIT License
+ * Copyright (c) 2023 Minjun Xu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <xviz/utils/time_series.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace xviz {
+
+// Collects high rate samples of numeric time series streams between two
+// frames and reduces them when the frame is built. Pushing is lock-free and
+// never allocates so producers can push from any thread.
+class TimeSeriesAccumulator {
+ public:
+  enum Reduction {
+    LAST,
+    MIN,
+    MAX,
+    MEAN,
+    // largest triangle three buckets, keeps the shape of the signal
+    LTTB,
+  };
+
+  struct StreamOption {
+    Reduction reduction{LAST};
+    // samples buffered between two flushes, rounded up to a power of two
+    std::size_t capacity{1024};
+    // samples emitted per flush by LTTB
+    std::size_t lttb_threshold{10};
+  };
+
+  using Handle = uint32_t;
+
+  TimeSeriesAccumulator() = default;
+  TimeSeriesAccumulator(const TimeSeriesAccumulator&) = delete;
+  TimeSeriesAccumulator& operator=(const TimeSeriesAccumulator&) = delete;
+
+  // All the streams have to be registered before any sample is pushed
+  Handle Register(std::string stream_id, const StreamOption& option);
+
+  Handle Register(std::string stream_id) {
+    return Register(std::move(stream_id), StreamOption());
+  }
+
+  Handle Register(std::string stream_id, Reduction reduction) {
+    StreamOption option;
+    option.reduction = reduction;
+    return Register(std::move(stream_id), option);
+  }
+
+  // Returns false if the stream's buffer is full, the sample is then dropped
+  bool Push(Handle handle, double timestamp, double value);
+
+  // Reduces what was pushed since the last call. The returned samples are
+  // valid until the next call, only one thread may collect at a time.
+  std::span<const TimeSeriesSample> Collect();
+
+  template <typename BuilderT>
+  void Flush(BuilderT& builder) {
+    auto samples = Collect();
+    if (!samples.empty()) {
+      builder.TimeSeriesBatch(samples);
+    }
+  }
+
+  uint64_t Dropped(Handle handle) const {
+    return streams_.at(handle)->dropped.load(std::memory_order_relaxed);
+  }
+
+ private:
+  struct Slot {
+    // index + 1 of the sample once it is fully written
+    std::atomic<uint64_t> sequence{0};
+    double timestamp{0};
+    double value{0};
+  };
+
+  struct Stream {
+    std::string stream_id;
+    StreamOption option;
+    std::unique_ptr<Slot[]> slots;
+    uint64_t mask{0};
+    alignas(64) std::atomic<uint64_t> write_index{0};
+    alignas(64) std::atomic<uint64_t> read_index{0};
+    std::atomic<uint64_t> dropped{0};
+  };
+
+  void Reduce(const Stream& stream);
+
+  std::vector<std::unique_ptr<Stream>> streams_;
+
+  // scratch buffers reused across flushes
+  std::vector<double> timestamps_;
+  std::vector<double> values_;
+  std::vector<TimeSeriesSample> samples_;
+};
+
+}  // namespace xviz
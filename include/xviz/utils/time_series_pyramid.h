@@ -0,0 +1,94 @@
+/*
+ * Project: libxviz
+ * Description: C++ Implementation of XVIZ Protocol
+ * Author: Minjun Xu (mjxu96@outlook.com)
+ * -----
+ * MIT License
+ * Copyright (c) 2023 Minjun Xu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <xviz/def.h>
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace xviz {
+
+struct PlotBucket {
+  double begin{0};
+  double end{0};
+  // min, max and mean are 0 when no sample falls into the bucket
+  uint64_t count{0};
+  double min{0};
+  double max{0};
+  double mean{0};
+};
+
+// Min/max/mean pyramid over the numeric time series of a recording, built
+// while the frames are written. Level k sums up runs of 2^k samples, so a
+// plot of N buckets over any time range is answered in O(N log T) without
+// going back to the frames.
+class TimeSeriesPyramid {
+ public:
+  // The timestamps of a stream must not decrease
+  void Add(std::string_view stream_id, double timestamp, double value);
+
+  // Adds the double and int32 values of every stream in the update, time
+  // series of an object are left out
+  void Record(const StateUpdate& update);
+
+  // `count` buckets of equal length between `begin` and `end`, a bucket
+  // holds the samples in [begin, end), the last one includes `end` too
+  std::vector<PlotBucket> Buckets(std::string_view stream_id, double begin,
+                                  double end, std::size_t count) const;
+
+  std::size_t SampleCount(std::string_view stream_id) const;
+
+ private:
+  struct Node {
+    double min{0};
+    double max{0};
+    double sum{0};
+    uint64_t count{0};
+
+    void Merge(const Node& other);
+  };
+
+  struct Stream {
+    std::vector<double> timestamps;
+    // levels[0] holds the samples themselves
+    std::vector<std::vector<Node>> levels;
+  };
+
+  // Sums up the samples [first, last) from the largest nodes that fit
+  static Node Aggregate(const Stream& stream, std::size_t first,
+                        std::size_t last);
+
+  std::map<std::string, Stream, std::less<>> streams_;
+};
+
+}  // namespace xviz
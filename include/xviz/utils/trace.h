@@ -0,0 +1,152 @@
+/*
+ * Project: libxviz
+ * Description: C++ Implementation of XVIZ Protocol
+ * Author: Minjun Xu (mjxu96@outlook.com)
+ * -----
+ * MIT License
+ * Copyright (c) 2023 Minjun Xu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace xviz::trace {
+
+// Spans are only recorded while tracing is enabled, otherwise a span costs
+// one relaxed load and a branch
+namespace detail {
+extern std::atomic<bool> enabled;
+}  // namespace detail
+
+// Events recorded by a thread go to its own ring of `events_per_thread`
+// events, the oldest ones are overwritten. The capacity applies to the rings
+// of threads that record their first event after this call.
+void Enable(std::size_t events_per_thread = 8192);
+void Disable();
+
+inline bool Enabled() {
+  return detail::enabled.load(std::memory_order_relaxed);
+}
+
+struct Event {
+  std::string_view name;
+  std::string_view category;
+  // nanoseconds on the steady clock
+  uint64_t start_ns;
+  uint64_t duration_ns;
+  uint32_t thread_id;
+};
+
+// Copies the events of every thread, oldest first per thread. Events being
+// written at the same time are skipped.
+std::vector<Event> Collect();
+
+// Chrome trace event format, loadable in chrome://tracing and Perfetto
+std::string DumpChromeTrace();
+
+namespace detail {
+uint64_t Now();
+void Record(const char* name, const char* category, uint64_t start_ns,
+            uint64_t end_ns);
+// The name is copied once per thread, so it may be e.g. a stream id
+void Record(std::string_view name, const char* category, uint64_t start_ns,
+            uint64_t end_ns);
+}  // namespace detail
+
+// Records the time from construction to destruction, e.g.
+//   trace::Span span("Message::ToProtobufBinary", "encode");
+// `name` and `category` must be string literals.
+class Span {
+ public:
+  explicit Span(const char* name, const char* category = "xviz") {
+    if (Enabled()) [[unlikely]] {
+      name_ = name;
+      category_ = category;
+      start_ns_ = detail::Now();
+    }
+  }
+
+  ~Span() {
+    if (name_) [[unlikely]] {
+      detail::Record(name_, category_, start_ns_, detail::Now());
+    }
+  }
+
+  Span(const Span&) = delete;
+  Span& operator=(const Span&) = delete;
+
+ private:
+  const char* name_{nullptr};
+  const char* category_{nullptr};
+  uint64_t start_ns_{0};
+};
+
+// Back to back spans named at runtime, e.g. the streams of a builder. Each
+// Begin() ends the previous span.
+class Sections {
+ public:
+  explicit Sections(const char* category) : category_(category) {}
+
+  ~Sections() { End(); }
+
+  Sections(const Sections&) = delete;
+  Sections& operator=(const Sections&) = delete;
+
+  // `name` must stay valid until the next Begin() or End(), an empty name
+  // only ends the previous span
+  void Begin(std::string_view name) {
+    if (active_ || Enabled()) [[unlikely]] {
+      auto now = detail::Now();
+      End(now);
+      if (Enabled() && !name.empty()) {
+        name_ = name;
+        start_ns_ = now;
+        active_ = true;
+      }
+    }
+  }
+
+  void End() {
+    if (active_) [[unlikely]] {
+      End(detail::Now());
+    }
+  }
+
+ private:
+  void End(uint64_t now) {
+    if (active_) {
+      detail::Record(name_, category_, start_ns_, now);
+      active_ = false;
+    }
+  }
+
+  const char* category_;
+  std::string_view name_;
+  uint64_t start_ns_{0};
+  bool active_{false};
+};
+
+}  // namespace xviz::trace
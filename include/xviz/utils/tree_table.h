@@ -0,0 +1,108 @@
+/*
+ * Project: libxviz
+ * Description: C++ Implementation of XVIZ Protocol
+ * Author: Minjun Xu (mjxu96@outlook.com)
+ * -----
+ * MIT License
+ * Copyright (c) 2023 Minjun Xu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <xviz/def.h>
+
+#include <cstdint>
+#include <ranges>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <variant>
+
+namespace xviz::util {
+
+template <typename T>
+concept TreeTableColumnValueType =
+    std::same_as<T, int> || std::same_as<T, double> || std::same_as<T, bool> ||
+    std::same_as<T, std::string> || std::same_as<T, std::string_view>;
+
+// A non-owning typed view of all the values of one tree table column
+class TreeTableColumnView {
+ public:
+  TreeTableColumnView(std::span<const int> v) : storage_(v) {}
+  TreeTableColumnView(std::span<const double> v) : storage_(v) {}
+  TreeTableColumnView(std::span<const bool> v) : storage_(v) {}
+  TreeTableColumnView(std::span<const std::string> v) : storage_(v) {}
+  TreeTableColumnView(std::span<const std::string_view> v) : storage_(v) {}
+
+  template <std::ranges::contiguous_range R>
+  requires(TreeTableColumnValueType<std::ranges::range_value_t<R>>)
+      TreeTableColumnView(const R& values)
+      : TreeTableColumnView(
+            std::span<const std::ranges::range_value_t<R>>(values)) {}
+
+  std::size_t Size() const {
+    return std::visit([](const auto& values) { return values.size(); },
+                      storage_);
+  }
+
+  xviz::TreeTableColumn::ColumnType GetHoldType() const {
+    switch (storage_.index()) {
+      case 0:
+        return xviz::TreeTableColumn::INT32;
+      case 1:
+        return xviz::TreeTableColumn::DOUBLE;
+      case 2:
+        return xviz::TreeTableColumn::BOOLEAN;
+      case 3:
+      case 4:
+        return xviz::TreeTableColumn::STRING;
+      default:
+        return xviz::TreeTableColumn::TREE_TABLE_COLUMN_COLUMN_TYPE_INVALID;
+    }
+  }
+
+  template <typename Visitor>
+  decltype(auto) Visit(Visitor&& visitor) const {
+    return std::visit(std::forward<Visitor>(visitor), storage_);
+  }
+
+ private:
+  std::variant<std::span<const int>, std::span<const double>,
+               std::span<const bool>, std::span<const std::string>,
+               std::span<const std::string_view>>
+      storage_;
+};
+
+// Appends one node per id, the columns are type checked once against the
+// table's columns and numbers are formatted the same way as
+// TreeTableValueVariant::ToString() without temporary strings.
+void AppendTreeTableRows(xviz::TreeTable& table, std::span<const int> ids,
+                         std::span<const int> parents,
+                         std::span<const TreeTableColumnView> columns);
+
+// Formats again the values of the nodes at `positions`, the columns still
+// hold the values of every node of the table.
+void UpdateTreeTableRows(xviz::TreeTable& table,
+                         std::span<const uint32_t> positions,
+                         std::span<const TreeTableColumnView> columns);
+
+}  // namespace xviz::util
@@ -0,0 +1,117 @@
+/*
+ * Project: libxviz
+ * Description: C++ Implementation of XVIZ Protocol
+ * Author: Minjun Xu (mjxu96@outlook.com)
+ * -----
+ * MIT License
+ * Copyright (c) 2023 Minjun Xu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <xviz/def.h>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace xviz {
+
+enum class ViolationType {
+  // the stream is not declared in the metadata
+  UNKNOWN_STREAM = 0,
+  // e.g. a pose sent on a primitive stream
+  WRONG_CATEGORY,
+  // e.g. a circle sent on a polygon stream
+  WRONG_PRIMITIVE_TYPE,
+  // e.g. a string sent on a float time series
+  WRONG_SCALAR_TYPE,
+  // a vehicle relative stream is sent in a complete state without any pose
+  MISSING_POSE,
+  VIOLATION_TYPE_COUNT,
+};
+
+std::string_view ToString(ViolationType type);
+
+struct Violation {
+  ViolationType type;
+  // index into StateUpdate::updates()
+  int update_index;
+  // valid during the callback only
+  std::string_view stream_id;
+};
+
+struct ValidatorOption {
+  // checks one out of every `sample_every` updates, 1 checks all of them
+  uint32_t sample_every{1};
+  // called for every violation found, on the validating thread
+  std::function<void(const Violation&)> callback;
+};
+
+// Checks that state updates match the metadata they are sent with. The
+// metadata is compiled once into per stream rules, and every update is then
+// checked in a single pass over its streams. Validate() is thread-safe.
+class Validator {
+ public:
+  explicit Validator(const Metadata& metadata, ValidatorOption option = {});
+
+  Validator(const Validator&) = delete;
+  Validator& operator=(const Validator&) = delete;
+
+  // Returns the number of violations found, 0 if the update is not sampled
+  std::size_t Validate(const StateUpdate& update);
+
+  uint64_t UpdatesSeen() const;
+  uint64_t UpdatesChecked() const;
+  uint64_t Violations(ViolationType type) const;
+  uint64_t TotalViolations() const;
+
+ private:
+  struct Rule {
+    StreamMetadata::Category category;
+    StreamMetadata::PrimitiveType primitive_type;
+    StreamMetadata::ScalarType scalar_type;
+    bool needs_pose;
+  };
+
+  std::size_t ValidateStreamSet(const StreamSet& stream_set, int update_index,
+                                bool complete);
+  void Report(ViolationType type, int update_index,
+              std::string_view stream_id);
+
+  static bool MatchPrimitiveType(const Rule& rule, const PrimitiveState& state);
+  static bool MatchScalarType(const Rule& rule, const Values& values);
+
+  std::unordered_map<std::string, Rule> rules_;
+  ValidatorOption option_;
+
+  std::atomic<uint64_t> updates_seen_{0};
+  std::atomic<uint64_t> updates_checked_{0};
+  std::array<std::atomic<uint64_t>,
+             static_cast<std::size_t>(ViolationType::VIOLATION_TYPE_COUNT)>
+      violations_{};
+};
+
+}  // namespace xviz
@@ -28,8 +28,16 @@
 #pragma once
 
 #include <xviz/builder/builder.h>
+#include <xviz/builder/builder_pool.h>
+#include <xviz/builder/state_cache.h>
+#include <xviz/builder/stream_scheduler.h>
+#include <xviz/builder/time_series_history.h>
+#include <xviz/builder/update_batcher.h>
 #include <xviz/def.h>
+#include <xviz/encoder/encoder.h>
+#include <xviz/encoder/frame_packer.h>
 #include <xviz/message.h>
+#include <xviz/validator/validator.h>
 
 #include <string>
 
@@ -0,0 +1,67 @@
+/*
+ * Project: libxviz
+ * Description: C++ Implementation of XVIZ Protocol
+ * Author: Minjun Xu (mjxu96@outlook.com)
+ * -----
+ * MIT License
+ * Copyright (c) 2023 Minjun Xu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <xviz/builder/builder_pool.h>
+
+namespace xviz {
+
+BuilderPool::BuilderPool(std::size_t max_idle)
+    : state_(std::make_shared<State>()) {
+  state_->max_idle = max_idle;
+  state_->recycler = std::make_shared<StateUpdateRecycler>(max_idle);
+}
+
+BuilderPool::PooledBuilder BuilderPool::Acquire() {
+  std::unique_ptr<Builder> builder;
+  {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    if (!state_->idle.empty()) {
+      builder = std::move(state_->idle.back());
+      state_->idle.pop_back();
+    }
+  }
+  if (!builder) {
+    builder = std::make_unique<Builder>(state_->recycler);
+  }
+  return PooledBuilder(builder.release(), Releaser{state_});
+}
+
+std::size_t BuilderPool::IdleBuilders() const {
+  std::lock_guard<std::mutex> lock(state_->mutex);
+  return state_->idle.size();
+}
+
+void BuilderPool::Releaser::operator()(Builder* builder) const {
+  std::unique_ptr<Builder> owned(builder);
+  owned->Reset();
+  std::lock_guard<std::mutex> lock(state->mutex);
+  if (state->idle.size() < state->max_idle) {
+    state->idle.push_back(std::move(owned));
+  }
+}
+
+}  // namespace xviz
@@ -0,0 +1,102 @@
+/*
+ * Project: libxviz
+ * Description: C++ Implementation of XVIZ Protocol
+ * Author: Minjun Xu (mjxu96@outlook.com)
+ * -----
+ * MIT License
+ * Copyright (c) 2023 Minjun Xu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <xviz/builder/frame.h>
+
+#include <stdexcept>
+
+namespace xviz {
+
+std::unique_ptr<StateUpdate> StateUpdateRecycler::Acquire() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!idle_.empty()) {
+      auto ret = std::move(idle_.back());
+      idle_.pop_back();
+      return ret;
+    }
+  }
+  return std::make_unique<StateUpdate>();
+}
+
+void StateUpdateRecycler::Release(std::unique_ptr<StateUpdate> data) {
+  if (!data) {
+    return;
+  }
+  data->Clear();
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (idle_.size() < max_idle_) {
+    idle_.push_back(std::move(data));
+  }
+}
+
+std::size_t StateUpdateRecycler::IdleCount() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return idle_.size();
+}
+
+Frame::Frame(std::unique_ptr<StateUpdate> data,
+             std::vector<ImageReference> images,
+             std::shared_ptr<StateUpdateRecycler> recycler)
+    : data_(std::move(data)),
+      images_(std::move(images)),
+      recycler_(std::move(recycler)) {}
+
+Frame::~Frame() { Recycle(); }
+
+Frame& Frame::operator=(Frame&& other) noexcept {
+  if (this != &other) {
+    Recycle();
+    data_ = std::move(other.data_);
+    images_ = std::move(other.images_);
+    recycler_ = std::move(other.recycler_);
+  }
+  return *this;
+}
+
+const StateUpdate& Frame::Data() const {
+  if (!data_) [[unlikely]] {
+    throw std::runtime_error("The frame is empty");
+  }
+  return *data_;
+}
+
+StateUpdate& Frame::MutableData() {
+  if (!data_) [[unlikely]] {
+    throw std::runtime_error("The frame is empty");
+  }
+  return *data_;
+}
+
+void Frame::Recycle() {
+  if (recycler_ && data_) {
+    recycler_->Release(std::move(data_));
+  }
+  data_.reset();
+}
+
+}  // namespace xviz
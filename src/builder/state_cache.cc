@@ -0,0 +1,212 @@
+/*
+ * Project: libxviz
+ * Description: C++ Implementation of XVIZ Protocol
+ * Author: Minjun Xu (mjxu96@outlook.com)
+ * -----
+ * MIT License
+ * Copyright (c) 2023 Minjun Xu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <xviz/builder/state_cache.h>
+
+#include <algorithm>
+#include <atomic>
+#include <utility>
+#include <vector>
+
+namespace xviz {
+
+namespace {
+
+std::string TimeSeriesKey(const TimeSeriesState& time_series) {
+  std::string ret = time_series.object_id();
+  for (const auto& stream_id : time_series.streams()) {
+    ret += '\n';
+    ret += stream_id;
+  }
+  return ret;
+}
+
+template <typename MapT>
+void CopyEntry(const MapT& from, MapT& to, const std::string& stream_id) {
+  auto itr = from.find(stream_id);
+  if (itr != from.end()) {
+    to[stream_id] = itr->second;
+  }
+}
+
+}  // namespace
+
+StateCache::StateCache(StateCacheOption option)
+    : option_(option), state_(std::make_shared<State>()) {}
+
+std::shared_ptr<const StateCache::State> StateCache::Load() const {
+  std::lock_guard<std::mutex> lock(state_mutex_);
+  return state_;
+}
+
+void StateCache::Update(std::shared_ptr<const Frame> frame) {
+  if (!frame || frame->Empty()) {
+    return;
+  }
+  std::lock_guard<std::mutex> update_lock(update_mutex_);
+  auto current = Load();
+  std::shared_ptr<State> next;
+  // once unpublished the spare version is only released by snapshots, the
+  // fence pairs with their release of it
+  if (spare_ && spare_.use_count() == 1) {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    next = std::move(spare_);
+    for (auto& change : changes_) {
+      if (change.entry) {
+        next->entries.insert_or_assign(std::move(change.key),
+                                       std::move(*change.entry));
+      } else {
+        next->entries.erase(change.key);
+      }
+    }
+  } else {
+    // a snapshot still reads it
+    next = std::make_shared<State>(*current);
+  }
+  changes_.clear();
+  next->timestamp = current->timestamp;
+
+  auto& entries = next->entries;
+  auto set = [this, &entries](Key key, const Entry& entry) {
+    entries.insert_or_assign(key, entry);
+    changes_.push_back({std::move(key), entry});
+  };
+  auto erase_if = [this, &entries](auto predicate) {
+    for (auto itr = entries.begin(); itr != entries.end();) {
+      if (predicate(*itr)) {
+        changes_.push_back({itr->first, std::nullopt});
+        itr = entries.erase(itr);
+      } else {
+        ++itr;
+      }
+    }
+  };
+
+  const auto& data = frame->Data();
+  bool persistent = data.update_type() == StateUpdate::PERSISTENT;
+  if (data.update_type() == StateUpdate::COMPLETE_STATE) {
+    erase_if([](const auto& entry) { return !entry.second.persistent; });
+  }
+
+  for (int index = 0; index < data.updates_size(); index++) {
+    const auto& update = data.updates(index);
+    next->timestamp = std::max(next->timestamp, update.timestamp());
+    for (const auto& stream_id : update.no_data_streams()) {
+      erase_if([&stream_id](const auto& entry) {
+        return entry.first.first != Field::TIME_SERIES &&
+               entry.first.second == stream_id;
+      });
+    }
+
+    Entry entry{frame, index, 0, update.timestamp(), persistent};
+    auto record = [&set, &entry](Field field, const auto& map) {
+      for (const auto& [stream_id, value] : map) {
+        set({field, stream_id}, entry);
+      }
+    };
+    record(Field::POSE, update.poses());
+    record(Field::PRIMITIVE, update.primitives());
+    record(Field::UI_PRIMITIVE, update.ui_primitives());
+    record(Field::FUTURE_INSTANCES, update.future_instances());
+    record(Field::VARIABLE, update.variables());
+    record(Field::ANNOTATION, update.annotations());
+    record(Field::LINK, update.links());
+    for (int series = 0; series < update.time_series_size(); series++) {
+      entry.time_series_index = series;
+      set({Field::TIME_SERIES, TimeSeriesKey(update.time_series(series))},
+          entry);
+    }
+  }
+
+  if (option_.max_age > 0) {
+    double oldest = next->timestamp - option_.max_age;
+    erase_if([oldest](const auto& entry) {
+      return !entry.second.persistent && entry.second.timestamp < oldest;
+    });
+  }
+
+  current.reset();
+  std::lock_guard<std::mutex> lock(state_mutex_);
+  spare_ = std::exchange(state_, std::move(next));
+}
+
+Frame StateCache::Snapshot() const {
+  auto state = Load();
+  auto data = std::make_unique<StateUpdate>();
+  data->set_update_type(StateUpdate::COMPLETE_STATE);
+  auto& update = *data->add_updates();
+  update.set_timestamp(state->timestamp);
+  std::vector<ImageReference> images;
+
+  for (const auto& [key, entry] : state->entries) {
+    const auto& [field, stream_id] = key;
+    const auto& source = entry.frame->Data().updates(entry.update_index);
+    switch (field) {
+      case Field::POSE:
+        CopyEntry(source.poses(), *update.mutable_poses(), stream_id);
+        break;
+      case Field::PRIMITIVE:
+        CopyEntry(source.primitives(), *update.mutable_primitives(),
+                  stream_id);
+        for (const auto& image : entry.frame->ImageReferences()) {
+          if (image.update_index == entry.update_index &&
+              image.stream_id == stream_id) {
+            images.push_back(image);
+            images.back().update_index = 0;
+          }
+        }
+        break;
+      case Field::UI_PRIMITIVE:
+        CopyEntry(source.ui_primitives(), *update.mutable_ui_primitives(),
+                  stream_id);
+        break;
+      case Field::FUTURE_INSTANCES:
+        CopyEntry(source.future_instances(),
+                  *update.mutable_future_instances(), stream_id);
+        break;
+      case Field::VARIABLE:
+        CopyEntry(source.variables(), *update.mutable_variables(), stream_id);
+        break;
+      case Field::ANNOTATION:
+        CopyEntry(source.annotations(), *update.mutable_annotations(),
+                  stream_id);
+        break;
+      case Field::LINK:
+        CopyEntry(source.links(), *update.mutable_links(), stream_id);
+        break;
+      case Field::TIME_SERIES:
+        *update.add_time_series() =
+            source.time_series(entry.time_series_index);
+        break;
+    }
+  }
+  return Frame(std::move(data), std::move(images), nullptr);
+}
+
+std::size_t StateCache::StreamCount() const { return Load()->entries.size(); }
+
+}  // namespace xviz
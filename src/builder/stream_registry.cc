@@ -0,0 +1,79 @@
+/*
+ * Project: libxviz
+ * Description: C++ Implementation of XVIZ Protocol
+ * Author: Minjun Xu (mjxu96@outlook.com)
+ * -----
+ * MIT License
+ * Copyright (c) 2023 Minjun Xu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <xviz/builder/stream_registry.h>
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+namespace xviz {
+
+StreamRegistry StreamRegistry::FromMetadata(const Metadata& metadata) {
+  std::vector<std::string_view> stream_ids;
+  stream_ids.reserve(metadata.streams_size());
+  for (const auto& [stream_id, stream] : metadata.streams()) {
+    stream_ids.push_back(stream_id);
+  }
+  std::sort(stream_ids.begin(), stream_ids.end());
+
+  StreamRegistry registry;
+  for (auto stream_id : stream_ids) {
+    registry.Register(stream_id);
+  }
+  return registry;
+}
+
+StreamId StreamRegistry::Register(std::string_view stream_id) {
+  auto itr = indices_.find(stream_id);
+  if (itr != indices_.end()) {
+    return {itr->second};
+  }
+  auto index = static_cast<uint32_t>(names_.size());
+  const auto& name = names_.emplace_back(stream_id);
+  indices_.emplace(name, index);
+  return {index};
+}
+
+std::optional<StreamId> StreamRegistry::Find(std::string_view stream_id) const {
+  auto itr = indices_.find(stream_id);
+  if (itr == indices_.end()) {
+    return std::nullopt;
+  }
+  return StreamId{itr->second};
+}
+
+const std::string& StreamRegistry::Name(StreamId stream) const {
+  if (!Contains(stream)) [[unlikely]] {
+    throw std::runtime_error(std::format(
+        "Stream id {} is not registered, {} streams are registered",
+        stream.index, names_.size()));
+  }
+  return names_[stream.index];
+}
+
+}  // namespace xviz
@@ -0,0 +1,128 @@
+/*
+ * Project: libxviz
+ * Description: C++ Implementation of XVIZ Protocol
+ * Author: Minjun Xu (mjxu96@outlook.com)
+ * -----
+ * MIT License
+ * Copyright (c) 2023 Minjun Xu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <xviz/builder/stream_scheduler.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace xviz {
+
+StreamScheduler::StreamScheduler(SchedulerOption option) : option_(option) {}
+
+StreamScheduler& StreamScheduler::Add(std::string name, Producer producer,
+                                      ScheduleOption option) {
+  if (!(option.rate > 0)) [[unlikely]] {
+    throw std::runtime_error(
+        std::format("Rate of {} has to be positive, got {}", name,
+                    option.rate));
+  }
+  for (const auto& entry : entries_) {
+    if (entry.stats.name == name) [[unlikely]] {
+      throw std::runtime_error(std::format("{} is already scheduled", name));
+    }
+  }
+  Entry entry;
+  entry.producer = std::move(producer);
+  entry.period = 1.0 / option.rate;
+  entry.priority = option.priority;
+  entry.stats.name = std::move(name);
+  entries_.push_back(std::move(entry));
+
+  order_.push_back(entries_.size() - 1);
+  std::ranges::stable_sort(order_, [this](std::size_t lhs, std::size_t rhs) {
+    return entries_[lhs].priority > entries_[rhs].priority;
+  });
+  return *this;
+}
+
+Frame StreamScheduler::Tick(double now) {
+  using Clock = std::chrono::steady_clock;
+  auto start = Clock::now();
+  bool built = false;
+  for (auto index : order_) {
+    auto& entry = entries_[index];
+    if (entry.due && now < *entry.due) {
+      continue;
+    }
+    // at least one producer is built, so a slow one cannot starve a tick
+    if (built && option_.tick_budget > 0 &&
+        std::chrono::duration<double>(Clock::now() - start).count() >=
+            option_.tick_budget) {
+      entry.stats.deferrals++;
+      continue;
+    }
+
+    // keeps the phase of the deadlines, the ones already passed are misses
+    double due = entry.due.value_or(now);
+    auto missed = static_cast<uint64_t>(std::floor((now - due) / entry.period));
+    due += entry.period * missed;
+    entry.stats.misses += missed;
+    entry.stats.max_lateness = std::max(entry.stats.max_lateness, now - due);
+    entry.due = due + entry.period;
+
+    if (!built) {
+      builder_.Timestamp(now);
+      built = true;
+    }
+    auto build_start = Clock::now();
+    entry.producer(builder_);
+    entry.stats.build_seconds +=
+        std::chrono::duration<double>(Clock::now() - build_start).count();
+    entry.stats.builds++;
+  }
+
+  if (!built) {
+    return {};
+  }
+  auto frame = builder_.Finish();
+  frame.MutableData().set_update_type(StateUpdate::INCREMENTAL);
+  return frame;
+}
+
+double StreamScheduler::NextDue() const {
+  double ret = std::numeric_limits<double>::infinity();
+  for (const auto& entry : entries_) {
+    ret = std::min(ret, entry.due.value_or(
+                            -std::numeric_limits<double>::infinity()));
+  }
+  return ret;
+}
+
+std::vector<ScheduledStreamStats> StreamScheduler::Stats() const {
+  std::vector<ScheduledStreamStats> ret;
+  ret.reserve(entries_.size());
+  for (const auto& entry : entries_) {
+    ret.push_back(entry.stats);
+  }
+  return ret;
+}
+
+}  // namespace xviz
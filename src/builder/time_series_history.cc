@@ -0,0 +1,152 @@
+/*
+ * Project: libxviz
+ * Description: C++ Implementation of XVIZ Protocol
+ * Author: Minjun Xu (mjxu96@outlook.com)
+ * -----
+ * MIT License
+ * Copyright (c) 2023 Minjun Xu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <xviz/builder/time_series_history.h>
+#include <xviz/utils/time_series.h>
+
+#include <algorithm>
+#include <bit>
+#include <limits>
+
+namespace xviz {
+
+TimeSeriesHistory::Handle TimeSeriesHistory::Register(
+    std::string stream_id, const StreamOption& option) {
+  auto stream = std::make_unique<Stream>();
+  stream->stream_id = stream_id;
+  stream->option = option;
+  std::size_t capacity =
+      std::bit_ceil(std::max<std::size_t>(option.capacity, 2));
+  stream->slots = std::make_unique<Slot[]>(capacity);
+  stream->mask = capacity - 1;
+  streams_.push_back(std::move(stream));
+  auto handle = static_cast<Handle>(streams_.size() - 1);
+  handles_[std::move(stream_id)] = handle;
+  return handle;
+}
+
+void TimeSeriesHistory::Push(Handle handle, double timestamp, double value) {
+  auto& stream = *streams_[handle];
+  uint64_t index = stream.write_index.fetch_add(1, std::memory_order_relaxed);
+  // a seqlock per slot with the stream's only writer, readers drop what
+  // changed while they read it
+  auto& slot = stream.slots[index & stream.mask];
+  slot.sequence.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.timestamp.store(timestamp, std::memory_order_relaxed);
+  slot.value.store(value, std::memory_order_relaxed);
+  slot.sequence.store(index + 1, std::memory_order_release);
+}
+
+void TimeSeriesHistory::Record(const StateUpdate& update) {
+  for (const auto& stream_set : update.updates()) {
+    for (const auto& time_series : stream_set.time_series()) {
+      if (!time_series.object_id().empty()) {
+        continue;
+      }
+      const auto& values = time_series.values();
+      for (int index = 0; index < time_series.streams_size(); index++) {
+        auto handle = handles_.find(time_series.streams(index));
+        if (handle == handles_.end()) {
+          continue;
+        }
+        if (index < values.doubles_size()) {
+          Push(handle->second, time_series.timestamp(), values.doubles(index));
+        } else if (index < values.int32s_size()) {
+          Push(handle->second, time_series.timestamp(), values.int32s(index));
+        }
+      }
+    }
+  }
+}
+
+std::vector<Frame> TimeSeriesHistory::Backfill(std::size_t max_updates) const {
+  std::vector<TimeSeriesSample> samples;
+  for (const auto& stream : streams_) {
+    uint64_t end = stream->write_index.load(std::memory_order_acquire);
+    uint64_t capacity = stream->mask + 1;
+    uint64_t begin = end > capacity ? end - capacity : 0;
+    auto first = samples.size();
+    double newest = -std::numeric_limits<double>::infinity();
+    for (uint64_t index = begin; index < end; index++) {
+      const auto& slot = stream->slots[index & stream->mask];
+      if (slot.sequence.load(std::memory_order_acquire) != index + 1) {
+        // still being written, or already overwritten
+        continue;
+      }
+      double timestamp = slot.timestamp.load(std::memory_order_relaxed);
+      double value = slot.value.load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (slot.sequence.load(std::memory_order_relaxed) != index + 1) {
+        continue;
+      }
+      samples.push_back({stream->stream_id, value, timestamp});
+      newest = std::max(newest, timestamp);
+    }
+    double oldest = newest - stream->option.window;
+    samples.erase(std::remove_if(samples.begin() + first, samples.end(),
+                                 [oldest](const TimeSeriesSample& sample) {
+                                   return sample.timestamp < oldest;
+                                 }),
+                  samples.end());
+  }
+  std::stable_sort(samples.begin(), samples.end(),
+                   [](const auto& lhs, const auto& rhs) {
+                     return lhs.timestamp < rhs.timestamp;
+                   });
+
+  std::vector<Frame> frames;
+  std::unique_ptr<StateUpdate> data;
+  max_updates = std::max<std::size_t>(max_updates, 1);
+  auto sample = samples.begin();
+  while (sample != samples.end()) {
+    auto next = std::find_if(sample, samples.end(), [sample](const auto& s) {
+      return s.timestamp != sample->timestamp;
+    });
+    if (!data) {
+      data = std::make_unique<StateUpdate>();
+      data->set_update_type(StateUpdate::INCREMENTAL);
+    }
+    auto update = data->add_updates();
+    update->set_timestamp(sample->timestamp);
+    util::AppendTimeSeriesSamples(
+        *update->mutable_time_series(),
+        std::span<const TimeSeriesSample>(&*sample, next - sample));
+    if (static_cast<std::size_t>(data->updates_size()) == max_updates) {
+      frames.emplace_back(std::move(data), std::vector<ImageReference>(),
+                          nullptr);
+    }
+    sample = next;
+  }
+  if (data) {
+    frames.emplace_back(std::move(data), std::vector<ImageReference>(),
+                        nullptr);
+  }
+  return frames;
+}
+
+}  // namespace xviz
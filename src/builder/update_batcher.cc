@@ -0,0 +1,97 @@
+/*
+ * Project: libxviz
+ * Description: C++ Implementation of XVIZ Protocol
+ * Author: Minjun Xu (mjxu96@outlook.com)
+ * -----
+ * MIT License
+ * Copyright (c) 2023 Minjun Xu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <xviz/builder/update_batcher.h>
+
+#include <algorithm>
+
+namespace xviz {
+
+UpdateBatcher::UpdateBatcher(Sink sink, BatchOption option)
+    : sink_(std::move(sink)),
+      option_(option),
+      recycler_(std::make_shared<StateUpdateRecycler>()) {
+  option_.max_updates = std::max<std::size_t>(option_.max_updates, 1);
+}
+
+void UpdateBatcher::Add(Frame&& frame) {
+  if (frame.Empty() || frame.Data().updates_size() == 0) {
+    return;
+  }
+  auto& data = frame.MutableData();
+  std::size_t bytes = data.ByteSizeLong();
+  for (const auto& image : frame.ImageReferences()) {
+    bytes += image.buffer.Size();
+  }
+  double timestamp = data.updates(0).timestamp();
+
+  if (batch_ && (batch_->update_type() != data.update_type() ||
+                 PendingUpdates() + data.updates_size() > option_.max_updates ||
+                 bytes_ + bytes > option_.max_bytes ||
+                 timestamp - first_timestamp_ > option_.max_window)) {
+    Flush();
+  }
+
+  if (!batch_) {
+    batch_ = recycler_->Acquire();
+    batch_->set_update_type(data.update_type());
+    first_timestamp_ = timestamp;
+  }
+  int offset = batch_->updates_size();
+  for (auto image : frame.ImageReferences()) {
+    image.update_index += offset;
+    images_.push_back(std::move(image));
+  }
+  auto count = data.updates_size();
+  extracted_.resize(count);
+  data.mutable_updates()->ExtractSubrange(0, count, extracted_.data());
+  for (auto update : extracted_) {
+    batch_->mutable_updates()->AddAllocated(update);
+  }
+  bytes_ += bytes;
+
+  if (PendingUpdates() >= option_.max_updates || bytes_ >= option_.max_bytes) {
+    Flush();
+  }
+}
+
+void UpdateBatcher::Flush() {
+  if (!batch_) {
+    return;
+  }
+  Frame frame(std::move(batch_), std::move(images_), recycler_);
+  batch_.reset();
+  images_.clear();
+  bytes_ = 0;
+  sink_(std::move(frame));
+}
+
+std::size_t UpdateBatcher::PendingUpdates() const {
+  return batch_ ? batch_->updates_size() : 0;
+}
+
+}  // namespace xviz
@@ -0,0 +1,79 @@
+/*
+ * Project: libxviz
+ * Description: C++ Implementation of XVIZ Protocol
+ * Author: Minjun Xu (mjxu96@outlook.com)
+ * -----
+ * MIT License
+ * Copyright (c) 2023 Minjun Xu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <xviz/encoder/encoder.h>
+
+#include <xviz/encoder/json_writer.h>
+#include <xviz/utils/metrics.h>
+#include <xviz/utils/trace.h>
+
+namespace xviz {
+
+Encoder::Encoder() { json_print_option_.preserve_proto_field_names = true; }
+
+Encoder::Encoder(ParallelWriteOption option)
+    : writer_(option), parallel_(option) {
+  json_print_option_.preserve_proto_field_names = true;
+}
+
+std::string_view Encoder::ToProtobufBinary(
+    const StateUpdate& message, std::span<const ImageReference> images) {
+  trace::Span span("Encoder::ToProtobufBinary", "encode");
+  detail::EncodeMetrics metrics(MessageFormat::PROTOBUF);
+  binary_.clear();
+  writer_.Write(message, images, binary_);
+  metrics.Record(message, binary_.size(), images);
+  return binary_;
+}
+
+void Encoder::ToProtobufBinary(const StateUpdate& message,
+                               std::span<const ImageReference> images,
+                               OutputChain& output) {
+  trace::Span span("Encoder::ToProtobufBinary", "encode");
+  detail::EncodeMetrics metrics(MessageFormat::PROTOBUF);
+  auto size = output.Size();
+  writer_.Write(message, images, output);
+  metrics.Record(message, output.Size() - size, images);
+}
+
+std::string_view Encoder::ToJsonString(
+    const StateUpdate& message, std::span<const ImageReference> images) {
+  trace::Span span("Encoder::ToJsonString", "encode");
+  detail::EncodeMetrics metrics(MessageFormat::JSON);
+  json_binary_.clear();
+  writer_.Write(message, images, json_binary_);
+  json_.clear();
+  if (parallel_) {
+    ConvertEnvelopeToJson(json_binary_, json_, json_print_option_, *parallel_);
+  } else {
+    ConvertEnvelopeToJson(json_binary_, json_, json_print_option_);
+  }
+  metrics.Record(message, json_.size());
+  return json_;
+}
+
+}  // namespace xviz
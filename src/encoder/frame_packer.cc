@@ -0,0 +1,250 @@
+/*
+ * Project: libxviz
+ * Description: C++ Implementation of XVIZ Protocol
+ * Author: Minjun Xu (mjxu96@outlook.com)
+ * -----
+ * MIT License
+ * Copyright (c) 2023 Minjun Xu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <xviz/encoder/frame_packer.h>
+
+#include <google/protobuf/io/coded_stream.h>
+
+#include <algorithm>
+#include <map>
+#include <set>
+
+namespace xviz {
+
+namespace {
+
+using google::protobuf::io::CodedOutputStream;
+
+enum class StreamKind { POSE, PRIMITIVE, UI_PRIMITIVE, TIME_SERIES };
+enum class PackAction { KEEP, DROP, CLEAR };
+
+// One map entry or time series of a StreamSet
+struct PackUnit {
+  int update_index{0};
+  StreamKind kind{StreamKind::POSE};
+  std::string stream_id;
+  int time_series_index{-1};
+  std::size_t bytes{0};
+  int priority{0};
+  PackAction action{PackAction::DROP};
+};
+
+// StreamSet fields are all below 16, so their tags take one byte
+std::size_t LengthDelimitedSize(std::size_t size) {
+  return 1 + CodedOutputStream::VarintSize64(size) + size;
+}
+
+std::size_t MapEntrySize(const std::string& key, std::size_t value_size) {
+  return LengthDelimitedSize(LengthDelimitedSize(key.size()) +
+                             LengthDelimitedSize(value_size));
+}
+
+}  // namespace
+
+FramePacker::FramePacker(PackOption option) : option_(std::move(option)) {
+  for (std::size_t group = 0; group < option_.lod_groups.size(); group++) {
+    const auto& streams = option_.lod_groups[group];
+    for (std::size_t level = 0; level < streams.size(); level++) {
+      lod_levels_[streams[level]] = {group, level};
+    }
+  }
+}
+
+int FramePacker::Priority(std::string_view stream_id) const {
+  auto itr = option_.priorities.find(std::string(stream_id));
+  return itr == option_.priorities.end() ? option_.default_priority
+                                         : itr->second;
+}
+
+PackReport FramePacker::Pack(Frame& frame, std::size_t budget) const {
+  return Pack(frame.MutableData(), frame.MutableImageReferences(), budget);
+}
+
+PackReport FramePacker::Pack(StateUpdate& data,
+                             std::vector<ImageReference>& images,
+                             std::size_t budget) const {
+  // caches the size of every nested message, read back below
+  std::size_t total = data.ByteSizeLong();
+
+  std::vector<PackUnit> units;
+  auto add_entries = [this, &units](int update_index, StreamKind kind,
+                                    const auto& map) {
+    for (const auto& [stream_id, value] : map) {
+      units.push_back({update_index, kind, stream_id, -1,
+                       MapEntrySize(stream_id, value.GetCachedSize()),
+                       Priority(stream_id)});
+    }
+  };
+  for (int index = 0; index < data.updates_size(); index++) {
+    const auto& update = data.updates(index);
+    add_entries(index, StreamKind::POSE, update.poses());
+    add_entries(index, StreamKind::PRIMITIVE, update.primitives());
+    add_entries(index, StreamKind::UI_PRIMITIVE, update.ui_primitives());
+    for (int series = 0; series < update.time_series_size(); series++) {
+      const auto& time_series = update.time_series(series);
+      PackUnit unit{index, StreamKind::TIME_SERIES,
+                    time_series.streams_size() ? time_series.streams(0) : "",
+                    series,
+                    LengthDelimitedSize(time_series.GetCachedSize()),
+                    option_.default_priority};
+      for (int stream = 0; stream < time_series.streams_size(); stream++) {
+        unit.priority = std::max(unit.priority,
+                                 Priority(time_series.streams(stream)));
+      }
+      units.push_back(std::move(unit));
+    }
+  }
+
+  // the images held by reference count for their primitive streams
+  for (const auto& image : images) {
+    total += image.buffer.Size();
+    for (auto& unit : units) {
+      if (unit.kind == StreamKind::PRIMITIVE &&
+          unit.update_index == image.update_index &&
+          unit.stream_id == image.stream_id) {
+        unit.bytes += image.buffer.Size();
+        break;
+      }
+    }
+  }
+  std::size_t used = total;
+  for (const auto& unit : units) {
+    used -= unit.bytes;
+  }
+
+  // the levels of a group in one StreamSet are a single choice, finest first
+  std::vector<std::vector<std::size_t>> choices;
+  std::map<std::pair<int, std::size_t>, std::size_t> group_choices;
+  for (std::size_t index = 0; index < units.size(); index++) {
+    const auto& unit = units[index];
+    auto level = lod_levels_.find(unit.stream_id);
+    if (unit.kind != StreamKind::PRIMITIVE || level == lod_levels_.end()) {
+      choices.push_back({index});
+      continue;
+    }
+    auto [itr, inserted] = group_choices.try_emplace(
+        {unit.update_index, level->second.first}, choices.size());
+    if (inserted) {
+      choices.emplace_back();
+    }
+    choices[itr->second].push_back(index);
+  }
+  auto lod_level = [this, &units](std::size_t index) {
+    auto itr = lod_levels_.find(units[index].stream_id);
+    return itr == lod_levels_.end() ? 0 : itr->second.second;
+  };
+  auto priority = [&units](const std::vector<std::size_t>& choice) {
+    int ret = units[choice.front()].priority;
+    for (auto index : choice) {
+      ret = std::max(ret, units[index].priority);
+    }
+    return ret;
+  };
+  for (auto& choice : choices) {
+    std::ranges::sort(choice, {}, lod_level);
+  }
+  std::ranges::stable_sort(choices, [&](const auto& lhs, const auto& rhs) {
+    auto lhs_priority = priority(lhs);
+    auto rhs_priority = priority(rhs);
+    if (lhs_priority != rhs_priority) {
+      return lhs_priority > rhs_priority;
+    }
+    return units[lhs.front()].bytes < units[rhs.front()].bytes;
+  });
+
+  // a level of detail group keeps only its finest level that fits and sends
+  // the others empty, the viewer would otherwise draw every level
+  for (const auto& choice : choices) {
+    for (auto kept : choice) {
+      std::size_t bytes = units[kept].bytes;
+      for (auto other : choice) {
+        if (other != kept) {
+          bytes += MapEntrySize(units[other].stream_id, 0);
+        }
+      }
+      if (used + bytes > budget) {
+        continue;
+      }
+      used += bytes;
+      for (auto other : choice) {
+        units[other].action =
+            other == kept ? PackAction::KEEP : PackAction::CLEAR;
+      }
+      break;
+    }
+  }
+
+  PackReport report;
+  report.bytes = used;
+  std::set<std::pair<int, std::string>> removed_images;
+  std::map<int, std::vector<int>> removed_time_series;
+  for (auto& unit : units) {
+    if (unit.action == PackAction::KEEP) {
+      continue;
+    }
+    auto& update = *data.mutable_updates(unit.update_index);
+    if (unit.kind == StreamKind::PRIMITIVE) {
+      removed_images.emplace(unit.update_index, unit.stream_id);
+    }
+    if (unit.action == PackAction::CLEAR) {
+      update.mutable_primitives()->at(unit.stream_id).Clear();
+      report.cleared.push_back({unit.update_index, unit.stream_id, unit.bytes});
+      continue;
+    }
+    switch (unit.kind) {
+      case StreamKind::POSE:
+        update.mutable_poses()->erase(unit.stream_id);
+        break;
+      case StreamKind::PRIMITIVE:
+        update.mutable_primitives()->erase(unit.stream_id);
+        break;
+      case StreamKind::UI_PRIMITIVE:
+        update.mutable_ui_primitives()->erase(unit.stream_id);
+        break;
+      case StreamKind::TIME_SERIES:
+        removed_time_series[unit.update_index].push_back(
+            unit.time_series_index);
+        break;
+    }
+    report.dropped.push_back(
+        {unit.update_index, std::move(unit.stream_id), unit.bytes});
+  }
+  for (auto& [update_index, indices] : removed_time_series) {
+    auto& time_series =
+        *data.mutable_updates(update_index)->mutable_time_series();
+    // from the back, so the indices left stay valid
+    for (auto itr = indices.rbegin(); itr != indices.rend(); itr++) {
+      time_series.erase(time_series.begin() + *itr);
+    }
+  }
+  std::erase_if(images, [&removed_images](const ImageReference& image) {
+    return removed_images.contains({image.update_index, image.stream_id});
+  });
+  return report;
+}
+
+}  // namespace xviz
@@ -0,0 +1,696 @@
+/*
+ * Project: libxviz
+ * Description: C++ Implementation of XVIZ Protocol
+ * Author: Minjun Xu (mjxu96@outlook.com)
+ * -----
+ * MIT License
+ * Copyright (c) 2023 Minjun Xu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <xviz/encoder/json_writer.h>
+
+#include <xviz/encoder/protobuf_writer.h>
+
+#include <xviz/utils/thread_pool.h>
+
+#include <google/protobuf/descriptor.h>
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/io/zero_copy_stream_impl_lite.h>
+#include <google/protobuf/util/type_resolver_util.h>
+#include <google/protobuf/wire_format_lite.h>
+
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <memory>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+namespace xviz {
+
+namespace {
+
+using google::protobuf::io::CodedInputStream;
+using google::protobuf::io::CodedOutputStream;
+using google::protobuf::internal::WireFormatLite;
+
+constexpr std::size_t kBinaryMagicSize = 4;
+
+google::protobuf::util::TypeResolver* GeneratedTypeResolver() {
+  static std::unique_ptr<google::protobuf::util::TypeResolver> resolver(
+      google::protobuf::util::NewTypeResolverForDescriptorPool(
+          "type.googleapis.com",
+          google::protobuf::DescriptorPool::generated_pool()));
+  return resolver.get();
+}
+
+void ConvertMessage(const std::string& type_url,
+                    google::protobuf::io::ZeroCopyInputStream& binary,
+                    google::protobuf::io::ZeroCopyOutputStream& output,
+                    const google::protobuf::util::JsonPrintOptions& options) {
+  auto status = google::protobuf::util::BinaryToJsonStream(
+      GeneratedTypeResolver(), type_url, &binary, &output, options);
+  if (!status.ok()) [[unlikely]] {
+    throw std::runtime_error(
+        std::format("Cannot convert to JSON: {}", status.ToString()));
+  }
+}
+
+// `binary` is past the magic
+void ConvertEnvelope(google::protobuf::io::ZeroCopyInputStream& binary,
+                     google::protobuf::io::ZeroCopyOutputStream& output,
+                     const google::protobuf::util::JsonPrintOptions& options) {
+  static const std::string type_url =
+      "type.googleapis.com/" + Envelope::descriptor()->full_name();
+  ConvertMessage(type_url, binary, output, options);
+}
+
+// The parallel conversion does not depend on the order in which the
+// converter writes the members of a message. Every job is a message with a
+// single field set, or a run of the map entries or repeated values of a
+// single field, so its JSON has exactly one member. The members are joined
+// here in field number order, the order protobuf serializes them in, and
+// the map entries and repeated values in the order of the binary.
+
+struct JsonJob {
+  const std::string* type_url;
+  std::string_view binary;
+  std::string json;
+};
+
+struct JsonNode;
+
+struct JsonPart {
+  // a run of values or map entries, for a split map entry only its key
+  std::optional<std::size_t> job;
+  // a split message
+  std::unique_ptr<JsonNode> node;
+};
+
+struct JsonMember {
+  enum Kind { FIELD, MESSAGE, MESSAGES, MAP, FLOATS };
+  Kind kind{FIELD};
+  // written here for all but FIELD, whose job has the whole member
+  std::string_view name;
+  std::vector<JsonPart> parts;
+};
+
+struct JsonNode {
+  std::vector<JsonMember> members;
+};
+
+// One occurrence of a field in the binary
+struct WireField {
+  // the tag and the value
+  std::string_view wire;
+  // the payload of a length delimited value
+  std::string_view value;
+  bool delimited{false};
+};
+
+// the well known types have their own JSON mapping and stay whole
+bool Splittable(const google::protobuf::Descriptor* type) {
+  return type && !type->file()->name().starts_with("google/protobuf/");
+}
+
+// Reads a length delimited field, `input` reads from `binary`
+bool ReadDelimited(CodedInputStream& input, std::string_view binary,
+                   std::string_view& value) {
+  uint32_t length = 0;
+  if (!input.ReadVarint32(&length)) {
+    return false;
+  }
+  auto position = static_cast<std::size_t>(input.CurrentPosition());
+  if (position + length > binary.size()) {
+    return false;
+  }
+  value = binary.substr(position, length);
+  return input.Skip(static_cast<int>(length));
+}
+
+CodedInputStream MakeInput(std::string_view binary) {
+  return CodedInputStream(reinterpret_cast<const uint8_t*>(binary.data()),
+                          static_cast<int>(binary.size()));
+}
+
+// Splits a map entry into its key, and any other field, and its value
+bool ReadMapEntry(std::string_view entry, std::string& key,
+                  std::string_view& value) {
+  google::protobuf::io::StringOutputStream stream(&key);
+  CodedOutputStream key_output(&stream);
+  auto input = MakeInput(entry);
+  while (uint32_t tag = input.ReadTag()) {
+    if (WireFormatLite::GetTagFieldNumber(tag) == 2) {
+      if (WireFormatLite::GetTagWireType(tag) !=
+              WireFormatLite::WIRETYPE_LENGTH_DELIMITED ||
+          !ReadDelimited(input, entry, value)) {
+        return false;
+      }
+    } else if (!WireFormatLite::SkipField(&input, tag, &key_output)) {
+      return false;
+    }
+  }
+  return input.ConsumedEntireMessage();
+}
+
+class JsonPlanner {
+ public:
+  JsonPlanner(std::size_t min_slice_bytes, bool proto_field_names)
+      : min_slice_bytes_(std::max<std::size_t>(min_slice_bytes, 1)),
+        proto_field_names_(proto_field_names) {}
+
+  std::vector<JsonJob>& Jobs() { return jobs_; }
+
+  // nullptr if the binary cannot be read, the message is then converted as
+  // a whole
+  std::unique_ptr<JsonNode> Split(const google::protobuf::Descriptor* type,
+                                  std::string_view binary);
+
+  std::size_t AddJob(const google::protobuf::Descriptor* type,
+                     std::string_view binary) {
+    auto [itr, inserted] = type_urls_.try_emplace(type);
+    if (inserted) {
+      itr->second = "type.googleapis.com/" + type->full_name();
+    }
+    jobs_.push_back({&itr->second, binary, {}});
+    return jobs_.size() - 1;
+  }
+
+  // Keeps a binary made up for a job
+  std::string_view Store(std::string binary) {
+    return binaries_.emplace_back(std::move(binary));
+  }
+
+  std::string_view FieldName(const google::protobuf::FieldDescriptor* field) {
+    return proto_field_names_ ? field->name() : field->json_name();
+  }
+
+ private:
+  // The occurrences as one binary, they are usually next to each other
+  std::string_view Join(std::span<const WireField> fields) {
+    std::size_t size = fields.front().wire.size();
+    bool contiguous = true;
+    for (std::size_t index = 1; index < fields.size(); index++) {
+      contiguous = contiguous && fields[index].wire.data() ==
+                                     fields[index - 1].wire.data() +
+                                         fields[index - 1].wire.size();
+      size += fields[index].wire.size();
+    }
+    if (contiguous) {
+      return {fields.front().wire.data(), size};
+    }
+    std::string joined;
+    joined.reserve(size);
+    for (const auto& field : fields) {
+      joined += field.wire;
+    }
+    return Store(std::move(joined));
+  }
+
+  bool SplitValues(const google::protobuf::Descriptor* type,
+                   const google::protobuf::FieldDescriptor* field,
+                   const google::protobuf::Descriptor* value_type,
+                   std::span<const WireField> fields, JsonMember& member);
+  void SplitFloats(const google::protobuf::Descriptor* type,
+                   const google::protobuf::FieldDescriptor* field,
+                   std::string_view values, JsonMember& member);
+
+  std::size_t min_slice_bytes_;
+  bool proto_field_names_;
+  std::vector<JsonJob> jobs_;
+  std::deque<std::string> binaries_;
+  std::unordered_map<const google::protobuf::Descriptor*, std::string>
+      type_urls_;
+};
+
+std::unique_ptr<JsonNode> JsonPlanner::Split(
+    const google::protobuf::Descriptor* type, std::string_view binary) {
+  // the occurrences of every known field, by field number
+  std::map<int, std::vector<WireField>> fields;
+  auto input = MakeInput(binary);
+  while (true) {
+    auto begin = static_cast<std::size_t>(input.CurrentPosition());
+    uint32_t tag = input.ReadTag();
+    if (!tag) {
+      break;
+    }
+    WireField wire;
+    wire.delimited = WireFormatLite::GetTagWireType(tag) ==
+                     WireFormatLite::WIRETYPE_LENGTH_DELIMITED;
+    if (wire.delimited ? !ReadDelimited(input, binary, wire.value)
+                       : !WireFormatLite::SkipField(&input, tag)) {
+      return nullptr;
+    }
+    auto number = static_cast<int>(WireFormatLite::GetTagFieldNumber(tag));
+    // unknown fields are skipped by the converter as well
+    if (type->FindFieldByNumber(number)) {
+      auto end = static_cast<std::size_t>(input.CurrentPosition());
+      wire.wire = binary.substr(begin, end - begin);
+      fields[number].push_back(wire);
+    }
+  }
+  if (!input.ConsumedEntireMessage() ||
+      input.CurrentPosition() != static_cast<int>(binary.size())) {
+    return nullptr;
+  }
+
+  auto node = std::make_unique<JsonNode>();
+  for (const auto& [number, wires] : fields) {
+    const auto* field = type->FindFieldByNumber(number);
+    auto& member = node->members.emplace_back();
+    member.name = FieldName(field);
+    std::size_t size = 0;
+    bool delimited = true;
+    for (const auto& wire : wires) {
+      size += wire.wire.size();
+      delimited = delimited && wire.delimited;
+    }
+
+    const auto* value_type = field->message_type();
+    if (field->is_map()) {
+      value_type = value_type->map_value()->message_type();
+    }
+    bool split = size >= min_slice_bytes_ && delimited &&
+                 Splittable(value_type) &&
+                 (field->is_repeated() || wires.size() == 1);
+    bool floating =
+        field->type() == google::protobuf::FieldDescriptor::TYPE_FLOAT ||
+        field->type() == google::protobuf::FieldDescriptor::TYPE_DOUBLE;
+    std::size_t width =
+        field->type() == google::protobuf::FieldDescriptor::TYPE_FLOAT
+            ? sizeof(float)
+            : sizeof(double);
+    bool floats = floating && field->is_repeated() && wires.size() == 1 &&
+                  delimited && wires[0].value.size() >= min_slice_bytes_ &&
+                  wires[0].value.size() % width == 0;
+    if (split && field->is_repeated()) {
+      if (!SplitValues(type, field, value_type, wires, member)) {
+        return nullptr;
+      }
+    } else if (split) {
+      member.kind = JsonMember::MESSAGE;
+      auto& part = member.parts.emplace_back();
+      part.node = Split(value_type, wires[0].value);
+      if (!part.node) {
+        return nullptr;
+      }
+    } else if (floats) {
+      SplitFloats(type, field, wires[0].value, member);
+    } else {
+      member.parts.push_back({AddJob(type, Join(wires)), nullptr});
+    }
+  }
+  return node;
+}
+
+bool JsonPlanner::SplitValues(const google::protobuf::Descriptor* type,
+                              const google::protobuf::FieldDescriptor* field,
+                              const google::protobuf::Descriptor* value_type,
+                              std::span<const WireField> fields,
+                              JsonMember& member) {
+  member.kind = field->is_map() ? JsonMember::MAP : JsonMember::MESSAGES;
+  // runs of small values share a job
+  std::size_t begin = 0;
+  std::size_t bytes = 0;
+  auto flush = [&](std::size_t end) {
+    if (end > begin) {
+      member.parts.push_back(
+          {AddJob(type, Join(fields.subspan(begin, end - begin))), nullptr});
+    }
+    begin = end;
+    bytes = 0;
+  };
+  for (std::size_t index = 0; index < fields.size(); index++) {
+    std::string key;
+    std::string_view value = fields[index].value;
+    if (field->is_map() && !ReadMapEntry(fields[index].value, key, value)) {
+      return false;
+    }
+    if (value.size() < min_slice_bytes_) {
+      bytes += fields[index].wire.size();
+      if (bytes >= min_slice_bytes_) {
+        flush(index + 1);
+      }
+      continue;
+    }
+    flush(index);
+    begin = index + 1;
+    auto& part = member.parts.emplace_back();
+    part.node = Split(value_type, value);
+    if (!part.node) {
+      return false;
+    }
+    if (field->is_map()) {
+      // the entry with an empty value gives the JSON of the key
+      auto value_tag =
+          WireFormatLite::MakeTag(2, WireFormatLite::WIRETYPE_LENGTH_DELIMITED);
+      std::string entry;
+      {
+        google::protobuf::io::StringOutputStream stream(&entry);
+        CodedOutputStream output(&stream);
+        output.WriteTag(WireFormatLite::MakeTag(
+            field->number(), WireFormatLite::WIRETYPE_LENGTH_DELIMITED));
+        output.WriteVarint32(static_cast<uint32_t>(
+            key.size() + CodedOutputStream::VarintSize32(value_tag) + 1));
+        output.WriteRaw(key.data(), static_cast<int>(key.size()));
+        output.WriteTag(value_tag);
+        output.WriteVarint32(0);
+      }
+      part.job = AddJob(type, Store(std::move(entry)));
+    }
+  }
+  flush(fields.size());
+  return true;
+}
+
+void JsonPlanner::SplitFloats(const google::protobuf::Descriptor* type,
+                              const google::protobuf::FieldDescriptor* field,
+                              std::string_view values, JsonMember& member) {
+  member.kind = JsonMember::FLOATS;
+  std::size_t width = field->type() ==
+                              google::protobuf::FieldDescriptor::TYPE_FLOAT
+                          ? sizeof(float)
+                          : sizeof(double);
+  std::size_t chunk_size =
+      std::max<std::size_t>(1, min_slice_bytes_ / width) * width;
+  auto tag = WireFormatLite::MakeTag(
+      field->number(), WireFormatLite::WIRETYPE_LENGTH_DELIMITED);
+  for (std::size_t offset = 0; offset < values.size(); offset += chunk_size) {
+    auto chunk = values.substr(offset, chunk_size);
+    // a message of the same type with only this part of the array
+    std::string binary;
+    {
+      google::protobuf::io::StringOutputStream stream(&binary);
+      CodedOutputStream output(&stream);
+      output.WriteTag(tag);
+      output.WriteVarint32(static_cast<uint32_t>(chunk.size()));
+      output.WriteRaw(chunk.data(), static_cast<int>(chunk.size()));
+    }
+    member.parts.push_back({AddJob(type, Store(std::move(binary))), nullptr});
+  }
+}
+
+// Skips a JSON string starting at `pos`, returns the position after it
+std::size_t SkipString(std::string_view json, std::size_t pos) {
+  for (pos++; pos < json.size(); pos++) {
+    if (json[pos] == '\\') {
+      pos++;
+    } else if (json[pos] == '"') {
+      return pos + 1;
+    }
+  }
+  return json.size();
+}
+
+// The value of the single member of `{"name":value}`
+std::optional<std::string_view> MemberValue(std::string_view json) {
+  if (json.size() < 2 || json.front() != '{' || json.back() != '}' ||
+      json[1] != '"') {
+    return std::nullopt;
+  }
+  auto end = SkipString(json, 1);
+  if (end + 1 >= json.size() || json[end] != ':') {
+    return std::nullopt;
+  }
+  return json.substr(end + 1, json.size() - end - 2);
+}
+
+// The elements of a JSON array or the members of a JSON object
+std::optional<std::string_view> Inside(std::optional<std::string_view> json,
+                                       char open, char close) {
+  if (!json || json->size() < 2 || json->front() != open ||
+      json->back() != close) {
+    return std::nullopt;
+  }
+  return json->substr(1, json->size() - 2);
+}
+
+class JsonAssembler {
+ public:
+  explicit JsonAssembler(const std::vector<JsonJob>& jobs) : jobs_(jobs) {}
+
+  // Appends the members of `node`, separated by commas
+  bool Members(const JsonNode& node, std::string& out);
+
+ private:
+  const std::string& Json(const JsonPart& part) const {
+    return jobs_[*part.job].json;
+  }
+
+  bool Object(const JsonNode& node, std::string& out) {
+    out += '{';
+    if (!Members(node, out)) [[unlikely]] {
+      return false;
+    }
+    out += '}';
+    return true;
+  }
+
+  bool Member(const JsonMember& member, std::string& out);
+
+  const std::vector<JsonJob>& jobs_;
+};
+
+bool JsonAssembler::Members(const JsonNode& node, std::string& out) {
+  bool first = true;
+  for (const auto& member : node.members) {
+    // a field the converter leaves out
+    if (member.kind == JsonMember::FIELD &&
+        Json(member.parts[0]) == "{}") {
+      continue;
+    }
+    if (!first) {
+      out += ',';
+    }
+    first = false;
+    if (!Member(member, out)) [[unlikely]] {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool JsonAssembler::Member(const JsonMember& member, std::string& out) {
+  if (member.kind == JsonMember::FIELD) {
+    auto json = Inside(Json(member.parts[0]), '{', '}');
+    if (!json) [[unlikely]] {
+      return false;
+    }
+    out += *json;
+    return true;
+  }
+  out += '"';
+  out += member.name;
+  out += "\":";
+  if (member.kind == JsonMember::MESSAGE) {
+    return Object(*member.parts[0].node, out);
+  }
+  bool map = member.kind == JsonMember::MAP;
+  out += map ? '{' : '[';
+  for (std::size_t index = 0; index < member.parts.size(); index++) {
+    if (index > 0) {
+      out += ',';
+    }
+    const auto& part = member.parts[index];
+    if (part.job) {
+      // {"name":{"key":value,...}} or {"name":[value,...]}
+      auto values = map ? Inside(MemberValue(Json(part)), '{', '}')
+                        : Inside(MemberValue(Json(part)), '[', ']');
+      if (!values) [[unlikely]] {
+        return false;
+      }
+      if (!part.node) {
+        out += *values;
+        continue;
+      }
+      // "key":{}
+      if (!values->ends_with("{}")) [[unlikely]] {
+        return false;
+      }
+      out += values->substr(0, values->size() - 2);
+    }
+    if (part.node && !Object(*part.node, out)) [[unlikely]] {
+      return false;
+    }
+  }
+  out += map ? '}' : ']';
+  return true;
+}
+
+void ConvertJobs(std::vector<JsonJob>& jobs, uint32_t thread_count,
+                 const google::protobuf::util::JsonPrintOptions& options) {
+  auto convert = [&](JsonJob& job) {
+    google::protobuf::io::ArrayInputStream input(
+        job.binary.data(), static_cast<int>(job.binary.size()));
+    google::protobuf::io::StringOutputStream stream(&job.json);
+    ConvertMessage(*job.type_url, input, stream, options);
+  };
+  auto& pool = util::ThreadPool::Shared();
+  std::size_t max_chunks = thread_count ? thread_count : pool.Size();
+
+  // contiguous runs of jobs of about the same number of bytes
+  std::size_t total = 0;
+  for (const auto& job : jobs) {
+    total += job.binary.size();
+  }
+  std::size_t chunk_bytes = std::max<std::size_t>(1, total / max_chunks);
+  std::vector<std::size_t> chunk_ends;
+  std::size_t bytes = 0;
+  for (std::size_t index = 0; index < jobs.size(); index++) {
+    bytes += jobs[index].binary.size();
+    if (bytes >= chunk_bytes || index + 1 == jobs.size()) {
+      chunk_ends.push_back(index + 1);
+      bytes = 0;
+    }
+  }
+  pool.ParallelFor(chunk_ends.size(), chunk_ends.size(),
+                   [&](std::size_t, std::size_t begin, std::size_t end) {
+                     for (auto chunk = begin; chunk < end; chunk++) {
+                       for (auto index = chunk ? chunk_ends[chunk - 1] : 0;
+                            index < chunk_ends[chunk]; index++) {
+                         convert(jobs[index]);
+                       }
+                     }
+                   });
+}
+
+// Converts the envelope with the StateUpdate in its Any split, appends the
+// text to `output` and returns true if it could be assembled
+bool ConvertEnvelopeSplit(
+    std::string_view binary, std::string& output,
+    const google::protobuf::util::JsonPrintOptions& options,
+    const ParallelWriteOption& parallel) {
+  // Envelope.data is an Any, whose value holds the StateUpdate
+  std::string_view type;
+  std::string_view any;
+  std::string_view type_url;
+  std::string_view value;
+  auto read_fields = [](std::string_view message, std::string_view& first,
+                        std::string_view& second) {
+    auto input = MakeInput(message);
+    while (uint32_t tag = input.ReadTag()) {
+      auto number = WireFormatLite::GetTagFieldNumber(tag);
+      if ((number != 1 && number != 2) ||
+          WireFormatLite::GetTagWireType(tag) !=
+              WireFormatLite::WIRETYPE_LENGTH_DELIMITED ||
+          !ReadDelimited(input, message, number == 1 ? first : second)) {
+        return false;
+      }
+    }
+    return true;
+  };
+  static const std::string state_update_url =
+      "type.googleapis.com/" + StateUpdate::descriptor()->full_name();
+  if (!read_fields(binary, type, any) || !read_fields(any, type_url, value) ||
+      type_url != state_update_url) {
+    return false;
+  }
+
+  JsonPlanner planner(parallel.min_slice_bytes,
+                      options.preserve_proto_field_names);
+  auto root = planner.Split(StateUpdate::descriptor(), value);
+  if (!root) {
+    return false;
+  }
+  // the type is converted along with the parts
+  Envelope header;
+  header.set_type(std::string(type));
+  auto type_job = planner.AddJob(Envelope::descriptor(),
+                                 planner.Store(header.SerializeAsString()));
+  auto& jobs = planner.Jobs();
+  ConvertJobs(jobs, parallel.thread_count, options);
+
+  // {"type":"...","data":{"@type":"...",<StateUpdate members>}}
+  auto type_member = Inside(jobs[type_job].json, '{', '}');
+  if (!type_member) {
+    return false;
+  }
+  auto size = output.size();
+  output += '{';
+  if (!type_member->empty()) {
+    output += *type_member;
+    output += ',';
+  }
+  output += '"';
+  output += planner.FieldName(Envelope::descriptor()->FindFieldByNumber(2));
+  output += "\":{\"@type\":\"";
+  output += state_update_url;
+  output += "\",";
+  auto members = output.size();
+  if (!JsonAssembler(jobs).Members(*root, output)) {
+    output.resize(size);
+    return false;
+  }
+  if (output.size() == members) {
+    // no member after the type
+    output.pop_back();
+  }
+  output += "}}";
+  return true;
+}
+
+}  // namespace
+
+void WriteJsonEnvelope(
+    const StateUpdate& message, std::span<const ImageReference> images,
+    OutputChain& output,
+    const google::protobuf::util::JsonPrintOptions& options) {
+  // this is what MessageToJsonString() does as well, but neither the binary
+  // nor the JSON text is flattened here
+  OutputChain binary(output.Pool());
+  WriteProtobufEnvelope(message, images, binary);
+  OutputChainInputStream input(binary);
+  input.Skip(kBinaryMagicSize);
+  ConvertEnvelope(input, output, options);
+}
+
+void ConvertEnvelopeToJson(
+    std::string_view binary, std::string& output,
+    const google::protobuf::util::JsonPrintOptions& options) {
+  binary.remove_prefix(std::min(binary.size(), kBinaryMagicSize));
+  google::protobuf::io::ArrayInputStream input(binary.data(),
+                                               static_cast<int>(binary.size()));
+  google::protobuf::io::StringOutputStream stream(&output);
+  ConvertEnvelope(input, stream, options);
+}
+
+void ConvertEnvelopeToJson(
+    std::string_view binary, std::string& output,
+    const google::protobuf::util::JsonPrintOptions& options,
+    const ParallelWriteOption& parallel) {
+  // indentation depends on the depth, and the default values are added in
+  // the order of the declarations instead of the binary
+  bool splittable = !options.add_whitespace &&
+                    !options.always_print_primitive_fields &&
+                    binary.size() >= parallel.min_slice_bytes;
+  if (splittable &&
+      ConvertEnvelopeSplit(
+          binary.substr(std::min(binary.size(), kBinaryMagicSize)), output,
+          options, parallel)) {
+    return;
+  }
+  ConvertEnvelopeToJson(binary, output, options);
+}
+
+}  // namespace xviz
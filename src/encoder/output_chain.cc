@@ -0,0 +1,196 @@
+/*
+ * Project: libxviz
+ * Description: C++ Implementation of XVIZ Protocol
+ * Author: Minjun Xu (mjxu96@outlook.com)
+ * -----
+ * MIT License
+ * Copyright (c) 2023 Minjun Xu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <xviz/encoder/output_chain.h>
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+namespace xviz {
+
+SlicePool::SlicePool(std::size_t slice_size, std::size_t max_idle_slices)
+    : slice_size_(std::clamp<std::size_t>(slice_size, 16, INT_MAX)),
+      max_idle_slices_(max_idle_slices) {}
+
+SlicePool& SlicePool::Shared() {
+  static SlicePool pool;
+  return pool;
+}
+
+std::size_t SlicePool::IdleSlices() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return idle_.size();
+}
+
+std::unique_ptr<uint8_t[]> SlicePool::Acquire() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!idle_.empty()) {
+      auto ret = std::move(idle_.back());
+      idle_.pop_back();
+      return ret;
+    }
+    // makes room for the new slice now so releasing never allocates
+    created_++;
+    idle_.reserve(std::min(created_, max_idle_slices_));
+  }
+  // left uninitialized, it is always written before being read
+  return std::unique_ptr<uint8_t[]>(new uint8_t[slice_size_]);
+}
+
+void SlicePool::Release(std::vector<std::unique_ptr<uint8_t[]>>& slices) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& slice : slices) {
+      if (idle_.size() >= max_idle_slices_) {
+        break;
+      }
+      idle_.push_back(std::move(slice));
+    }
+  }
+  // frees what did not fit outside of the lock
+  slices.clear();
+}
+
+OutputChain::OutputChain(SlicePool& pool) : pool_(&pool) {}
+
+OutputChain::~OutputChain() { pool_->Release(slices_); }
+
+bool OutputChain::Next(void** data, int* size) {
+  if (available_ == 0) {
+    slices_.push_back(pool_->Acquire());
+    cursor_ = slices_.back().get();
+    available_ = pool_->SliceSize();
+  }
+
+  if (last_iovec_owned_ &&
+      static_cast<uint8_t*>(iovecs_.back().iov_base) +
+              iovecs_.back().iov_len ==
+          cursor_) {
+    iovecs_.back().iov_len += available_;
+  } else {
+    iovecs_.push_back({cursor_, available_});
+  }
+  last_iovec_owned_ = true;
+
+  *data = cursor_;
+  *size = static_cast<int>(available_);
+  cursor_ += available_;
+  byte_count_ += static_cast<int64_t>(available_);
+  available_ = 0;
+  return true;
+}
+
+void OutputChain::BackUp(int count) {
+  auto backed_up = static_cast<std::size_t>(count);
+  iovecs_.back().iov_len -= backed_up;
+  if (iovecs_.back().iov_len == 0) {
+    iovecs_.pop_back();
+    last_iovec_owned_ = false;
+  }
+  cursor_ -= backed_up;
+  available_ += backed_up;
+  byte_count_ -= count;
+}
+
+void OutputChain::Splice(ImageBuffer buffer) {
+  if (buffer.Empty()) {
+    return;
+  }
+  // iovec is not const correct, the bytes are never written through it
+  iovecs_.push_back({const_cast<uint8_t*>(buffer.Bytes().data()),
+                     buffer.Size()});
+  byte_count_ += static_cast<int64_t>(buffer.Size());
+  spliced_.push_back(std::move(buffer));
+  last_iovec_owned_ = false;
+}
+
+void OutputChain::AppendTo(std::string& output) const {
+  std::size_t offset = output.size();
+  output.resize(offset + Size());
+  for (const auto& vec : iovecs_) {
+    std::memcpy(output.data() + offset, vec.iov_base, vec.iov_len);
+    offset += vec.iov_len;
+  }
+}
+
+std::string OutputChain::ToString() const {
+  std::string ret;
+  AppendTo(ret);
+  return ret;
+}
+
+void OutputChain::Clear() {
+  pool_->Release(slices_);
+  cursor_ = nullptr;
+  available_ = 0;
+  last_iovec_owned_ = false;
+  iovecs_.clear();
+  spliced_.clear();
+  byte_count_ = 0;
+}
+
+bool OutputChainInputStream::Next(const void** data, int* size) {
+  while (index_ < iovecs_.size() && offset_ == iovecs_[index_].iov_len) {
+    index_++;
+    offset_ = 0;
+  }
+  if (index_ == iovecs_.size()) {
+    return false;
+  }
+  const auto& vec = iovecs_[index_];
+  auto length = std::min<std::size_t>(vec.iov_len - offset_, INT_MAX);
+  *data = static_cast<const uint8_t*>(vec.iov_base) + offset_;
+  *size = static_cast<int>(length);
+  offset_ += length;
+  byte_count_ += static_cast<int64_t>(length);
+  return true;
+}
+
+void OutputChainInputStream::BackUp(int count) {
+  // only called right after Next(), so it stays inside the current iovec
+  offset_ -= static_cast<std::size_t>(count);
+  byte_count_ -= count;
+}
+
+bool OutputChainInputStream::Skip(int count) {
+  auto remaining = static_cast<std::size_t>(count);
+  while (remaining > 0 && index_ < iovecs_.size()) {
+    auto length = std::min(remaining, iovecs_[index_].iov_len - offset_);
+    offset_ += length;
+    remaining -= length;
+    byte_count_ += static_cast<int64_t>(length);
+    if (offset_ == iovecs_[index_].iov_len) {
+      index_++;
+      offset_ = 0;
+    }
+  }
+  return remaining == 0;
+}
+
+}  // namespace xviz
@@ -0,0 +1,769 @@
+/*
+ * Project: libxviz
+ * Description: C++ Implementation of XVIZ Protocol
+ * Author: Minjun Xu (mjxu96@outlook.com)
+ * -----
+ * MIT License
+ * Copyright (c) 2023 Minjun Xu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <xviz/encoder/protobuf_writer.h>
+
+#include <xviz/message.h>
+#include <xviz/utils/hash.h>
+#include <xviz/utils/thread_pool.h>
+
+#include <google/protobuf/any.pb.h>
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/io/zero_copy_stream_impl_lite.h>
+#include <google/protobuf/unknown_field_set.h>
+#include <google/protobuf/wire_format.h>
+#include <google/protobuf/wire_format_lite.h>
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstring>
+#include <vector>
+
+namespace xviz {
+
+namespace {
+
+using google::protobuf::Any;
+using google::protobuf::io::CodedOutputStream;
+using google::protobuf::internal::WireFormat;
+using google::protobuf::internal::WireFormatLite;
+
+constexpr std::string_view kBinaryMagic = "\x50\x42\x45\x31";
+constexpr std::string_view kStateUpdateType =
+    MessageTypeStr<StateUpdate>::value;
+
+// what Any::PackFrom() writes as type url
+const std::string& StateUpdateTypeUrl() {
+  static const std::string type_url =
+      "type.googleapis.com/" + StateUpdate::descriptor()->full_name();
+  return type_url;
+}
+
+uint32_t Tag(int field, WireFormatLite::WireType type) {
+  return WireFormatLite::MakeTag(field, type);
+}
+
+std::size_t TagSize(int field, WireFormatLite::WireType type) {
+  return CodedOutputStream::VarintSize32(Tag(field, type));
+}
+
+// the nested maps are ordered by key when `deterministic` is set
+uint8_t* SerializeToArray(const google::protobuf::MessageLite& message,
+                          uint8_t* target, bool deterministic) {
+  if (!deterministic) {
+    return message.SerializeWithCachedSizesToArray(target);
+  }
+  int size = message.GetCachedSize();
+  google::protobuf::io::ArrayOutputStream stream(target, size);
+  CodedOutputStream coded(&stream);
+  coded.SetSerializationDeterministic(true);
+  message.SerializeWithCachedSizes(&coded);
+  return target + size;
+}
+
+// Writes through a CodedOutputStream, the images are spliced into the chain
+// when there is one
+class StreamSink {
+ public:
+  StreamSink(CodedOutputStream& coded, OutputChain* chain)
+      : coded_(coded), chain_(chain) {}
+
+  // bytes written so far, spliced images excluded
+  std::size_t Position() const { return coded_.ByteCount(); }
+
+  void WriteTag(uint32_t tag) { coded_.WriteTag(tag); }
+  void WriteVarint32(uint32_t value) { coded_.WriteVarint32(value); }
+  void WriteVarint64(uint64_t value) { coded_.WriteVarint64(value); }
+  void WriteVarint32SignExtended(int32_t value) {
+    coded_.WriteVarint32SignExtended(value);
+  }
+  void WriteLittleEndian32(uint32_t value) {
+    coded_.WriteLittleEndian32(value);
+  }
+  void WriteLittleEndian64(uint64_t value) {
+    coded_.WriteLittleEndian64(value);
+  }
+  void WriteRaw(std::string_view bytes) {
+    coded_.WriteRaw(bytes.data(), static_cast<int>(bytes.size()));
+  }
+
+  void WriteMessage(const google::protobuf::MessageLite& message) {
+    message.SerializeWithCachedSizes(&coded_);
+  }
+
+  void WriteImage(const ImageBuffer& buffer) {
+    if (chain_) {
+      // hands the buffered bytes back to the chain before splicing
+      coded_.Trim();
+      chain_->Splice(buffer);
+    } else {
+      coded_.WriteRaw(buffer.Bytes().data(), static_cast<int>(buffer.Size()));
+    }
+  }
+
+ private:
+  CodedOutputStream& coded_;
+  OutputChain* chain_;
+};
+
+// Writes into a buffer sized beforehand. The messages and images of at
+// least `min_slice_bytes` are skipped and left to ProtobufWriter::Slice,
+// everything else is written right away.
+class SliceSink {
+ public:
+  using Slice = ProtobufWriter::Slice;
+
+  SliceSink(uint8_t* target, std::size_t min_slice_bytes, bool deterministic,
+            std::vector<Slice>& slices)
+      : begin_(target),
+        target_(target),
+        min_slice_bytes_(min_slice_bytes),
+        deterministic_(deterministic),
+        slices_(slices) {}
+
+  uint8_t* Target() const { return target_; }
+  std::size_t Position() const { return target_ - begin_; }
+
+  void WriteTag(uint32_t tag) {
+    target_ = CodedOutputStream::WriteTagToArray(tag, target_);
+  }
+  void WriteVarint32(uint32_t value) {
+    target_ = CodedOutputStream::WriteVarint32ToArray(value, target_);
+  }
+  void WriteVarint64(uint64_t value) {
+    target_ = CodedOutputStream::WriteVarint64ToArray(value, target_);
+  }
+  void WriteVarint32SignExtended(int32_t value) {
+    target_ =
+        CodedOutputStream::WriteVarint32SignExtendedToArray(value, target_);
+  }
+  void WriteLittleEndian32(uint32_t value) {
+    target_ = CodedOutputStream::WriteLittleEndian32ToArray(value, target_);
+  }
+  void WriteLittleEndian64(uint64_t value) {
+    target_ = CodedOutputStream::WriteLittleEndian64ToArray(value, target_);
+  }
+  void WriteRaw(std::string_view bytes) {
+    target_ = CodedOutputStream::WriteRawToArray(
+        bytes.data(), static_cast<int>(bytes.size()), target_);
+  }
+
+  void WriteMessage(const google::protobuf::MessageLite& message) {
+    std::size_t size = message.GetCachedSize();
+    if (size < min_slice_bytes_) {
+      target_ = SerializeToArray(message, target_, deterministic_);
+      return;
+    }
+    slices_.push_back({&message, {}, target_, size});
+    target_ += size;
+  }
+
+  void WriteImage(const ImageBuffer& buffer) {
+    if (buffer.Size() < min_slice_bytes_) {
+      target_ = CodedOutputStream::WriteRawToArray(
+          buffer.Bytes().data(), static_cast<int>(buffer.Size()), target_);
+      return;
+    }
+    slices_.push_back({nullptr, buffer.Bytes(), target_, buffer.Size()});
+    target_ += buffer.Size();
+  }
+
+ private:
+  uint8_t* begin_;
+  uint8_t* target_;
+  std::size_t min_slice_bytes_;
+  bool deterministic_;
+  std::vector<Slice>& slices_;
+};
+
+// tag, length and payload of a length delimited field
+std::size_t FieldSize(int field, std::size_t size) {
+  return CodedOutputStream::VarintSize32(
+             Tag(field, WireFormatLite::WIRETYPE_LENGTH_DELIMITED)) +
+         CodedOutputStream::VarintSize64(size) + size;
+}
+
+template <typename SinkT>
+void WriteFieldHeader(int field, std::size_t size, SinkT& sink) {
+  sink.WriteTag(Tag(field, WireFormatLite::WIRETYPE_LENGTH_DELIMITED));
+  sink.WriteVarint64(size);
+}
+
+template <typename SinkT>
+void WriteMessageField(int field, const google::protobuf::MessageLite& message,
+                       SinkT& sink) {
+  WriteFieldHeader(field, message.GetCachedSize(), sink);
+  sink.WriteMessage(message);
+}
+
+template <typename SinkT>
+void WriteStringField(int field, std::string_view value, SinkT& sink) {
+  WriteFieldHeader(field, value.size(), sink);
+  sink.WriteRaw(value);
+}
+
+// the key and the value are fields 1 and 2 of every map entry
+std::size_t MapEntrySize(std::string_view key, std::size_t value_size) {
+  return FieldSize(1, key.size()) + FieldSize(2, value_size);
+}
+
+// map entries always have both the key and the value written
+template <typename SinkT>
+void WriteMapEntryHeader(int field, std::string_view key,
+                         std::size_t value_size, SinkT& sink) {
+  WriteFieldHeader(field, MapEntrySize(key, value_size), sink);
+  WriteStringField(1, key, sink);
+  WriteFieldHeader(2, value_size, sink);
+}
+
+template <typename MapT>
+std::size_t MapSize(int field, const MapT& map) {
+  std::size_t size = 0;
+  for (const auto& [key, value] : map) {
+    size += FieldSize(field, MapEntrySize(key, value.ByteSizeLong()));
+  }
+  return size;
+}
+
+template <typename RepeatedT>
+std::size_t RepeatedSize(int field, const RepeatedT& messages) {
+  std::size_t size = 0;
+  for (const auto& message : messages) {
+    size += FieldSize(field, message.ByteSizeLong());
+  }
+  return size;
+}
+
+template <typename RepeatedT, typename SinkT>
+void WriteRepeated(int field, const RepeatedT& messages, SinkT& sink) {
+  for (const auto& message : messages) {
+    WriteMessageField(field, message, sink);
+  }
+}
+
+// The generated code writes the unknown fields after the known ones, so
+// do the messages written field by field
+const google::protobuf::UnknownFieldSet& UnknownFields(
+    const google::protobuf::Message& message) {
+  return message.GetReflection()->GetUnknownFields(message);
+}
+
+std::size_t UnknownFieldsSize(const google::protobuf::Message& message) {
+  const auto& unknown_fields = UnknownFields(message);
+  if (unknown_fields.empty()) [[likely]] {
+    return 0;
+  }
+  return WireFormat::ComputeUnknownFieldsSize(unknown_fields);
+}
+
+template <typename SinkT>
+void WriteUnknownFields(const google::protobuf::Message& message,
+                        SinkT& sink) {
+  const auto& unknown_fields = UnknownFields(message);
+  if (unknown_fields.empty()) [[likely]] {
+    return;
+  }
+  std::string bytes;
+  unknown_fields.SerializeToString(&bytes);
+  sink.WriteRaw(bytes);
+}
+
+std::size_t AnySize(std::size_t message_size) {
+  return FieldSize(Any::kTypeUrlFieldNumber, StateUpdateTypeUrl().size()) +
+         (message_size > 0 ? FieldSize(Any::kValueFieldNumber, message_size)
+                           : 0);
+}
+
+}  // namespace
+
+ProtobufWriter::ProtobufWriter(ParallelWriteOption option)
+    : parallel_(option) {}
+
+std::size_t ProtobufWriter::Prepare(const StateUpdate& message,
+                                    std::span<const ImageReference> images) {
+  message_ = &message;
+  images_.clear();
+  sizes_.clear();
+  for (const auto& reference : images) {
+    const auto& image = util::FindReferencedImage(message, reference);
+    const auto& update = message.updates(reference.update_index);
+    images_.push_back({&update, &update.primitives().at(reference.stream_id),
+                       &image, &reference.buffer});
+  }
+
+  message_size_ = 0;
+  if (message.update_type() != 0) {
+    message_size_ +=
+        TagSize(StateUpdate::kUpdateTypeFieldNumber,
+                WireFormatLite::WIRETYPE_VARINT) +
+        CodedOutputStream::VarintSize32SignExtended(message.update_type());
+  }
+  for (const auto& update : message.updates()) {
+    message_size_ +=
+        FieldSize(StateUpdate::kUpdatesFieldNumber,
+                  Expand(update) ? StreamSetSize(update)
+                                 : update.ByteSizeLong());
+  }
+  message_size_ += UnknownFieldsSize(message);
+
+  return kBinaryMagic.size() +
+         FieldSize(Envelope::kTypeFieldNumber, kStateUpdateType.size()) +
+         FieldSize(Envelope::kDataFieldNumber, AnySize(message_size_));
+}
+
+template <typename SinkT>
+void ProtobufWriter::WriteEnvelope(SinkT& sink) {
+  sink.WriteRaw(kBinaryMagic);
+  WriteStringField(Envelope::kTypeFieldNumber, kStateUpdateType, sink);
+  WriteFieldHeader(Envelope::kDataFieldNumber, AnySize(message_size_), sink);
+  WriteStringField(Any::kTypeUrlFieldNumber, StateUpdateTypeUrl(), sink);
+  if (message_size_ == 0) {
+    return;
+  }
+
+  WriteFieldHeader(Any::kValueFieldNumber, message_size_, sink);
+  next_size_ = 0;
+  if (message_->update_type() != 0) {
+    sink.WriteTag(Tag(StateUpdate::kUpdateTypeFieldNumber,
+                      WireFormatLite::WIRETYPE_VARINT));
+    sink.WriteVarint32SignExtended(message_->update_type());
+  }
+  for (update_index_ = 0; update_index_ < message_->updates_size();
+       update_index_++) {
+    const auto& update = message_->updates(update_index_);
+    if (Expand(update)) {
+      WriteStreamSet(update, sink);
+    } else {
+      WriteMessageField(StateUpdate::kUpdatesFieldNumber, update, sink);
+    }
+  }
+  WriteUnknownFields(*message_, sink);
+}
+
+template <typename MapT, typename FuncT>
+void ProtobufWriter::ForEachEntry(const MapT& map, FuncT&& func) {
+  if (!deterministic_) {
+    for (const auto& [key, value] : map) {
+      func(key, value);
+    }
+    return;
+  }
+  using EntryT = typename MapT::value_type;
+  order_.clear();
+  for (const auto& entry : map) {
+    order_.push_back(&entry);
+  }
+  std::sort(order_.begin(), order_.end(), [](const void* lhs, const void* rhs) {
+    return static_cast<const EntryT*>(lhs)->first <
+           static_cast<const EntryT*>(rhs)->first;
+  });
+  for (const void* entry : order_) {
+    func(static_cast<const EntryT*>(entry)->first,
+         static_cast<const EntryT*>(entry)->second);
+  }
+}
+
+template <typename MapT, typename SinkT>
+void ProtobufWriter::WriteEntries(int field, const MapT& map, SinkT& sink) {
+  ForEachEntry(map, [&](const std::string& key, const auto& value) {
+    WriteMapEntryHeader(field, key, value.GetCachedSize(), sink);
+    auto begin = sink.Position();
+    sink.WriteMessage(value);
+    RecordHash(field, key, begin, sink.Position());
+  });
+}
+
+void ProtobufWriter::RecordHash(int field, const std::string& stream_id,
+                                std::size_t begin, std::size_t end) {
+  if (hashing_) {
+    pending_hashes_.push_back({update_index_, field, &stream_id, begin, end});
+  }
+}
+
+void ProtobufWriter::ComputeHashes(std::string_view output) {
+  // the hashes are pending in StreamSet order
+  int update_index = -1;
+  for (const auto& pending : pending_hashes_) {
+    auto hash = util::Hash64(output.substr(pending.begin,
+                                           pending.end - pending.begin),
+                             pending.field);
+    if (pending.update_index != update_index) {
+      update_index = pending.update_index;
+      time_series_hashes_.clear();
+    }
+    // a stream may have several time series
+    if (pending.field == StreamSet::kTimeSeriesFieldNumber) {
+      auto [itr, inserted] =
+          time_series_hashes_.try_emplace(*pending.stream_id, hashes_.size());
+      if (!inserted) {
+        auto& combined = hashes_[itr->second].hash;
+        combined = util::HashCombine(combined, hash);
+        continue;
+      }
+    }
+    hashes_.push_back({pending.update_index, *pending.stream_id, hash});
+  }
+  time_series_hashes_.clear();
+}
+
+void ProtobufWriter::Write(const StateUpdate& message,
+                           std::span<const ImageReference> images,
+                           OutputChain& output) {
+  split_ = false;
+  // the positions do not account for the spliced images
+  hashing_ = false;
+  hashes_.clear();
+  Prepare(message, images);
+  CodedOutputStream coded(&output);
+  coded.SetSerializationDeterministic(deterministic_);
+  StreamSink sink(coded, &output);
+  WriteEnvelope(sink);
+}
+
+void ProtobufWriter::Write(const StateUpdate& message,
+                           std::span<const ImageReference> images,
+                           std::string& output) {
+  split_ = parallel_.has_value();
+  hashing_ = deterministic_;
+  hashes_.clear();
+  pending_hashes_.clear();
+  auto size = Prepare(message, images);
+  auto offset = output.size();
+  if (!split_) {
+    output.reserve(offset + size);
+    {
+      google::protobuf::io::StringOutputStream stream(&output);
+      CodedOutputStream coded(&stream);
+      coded.SetSerializationDeterministic(deterministic_);
+      StreamSink sink(coded, nullptr);
+      WriteEnvelope(sink);
+    }
+  } else {
+    output.resize(offset + size);
+    auto* target = reinterpret_cast<uint8_t*>(output.data() + offset);
+    slices_.clear();
+    SliceSink sink(target, parallel_->min_slice_bytes, deterministic_,
+                   slices_);
+    WriteEnvelope(sink);
+    assert(sink.Target() == target + size);
+    WriteSlices();
+  }
+  ComputeHashes(std::string_view(output).substr(offset));
+}
+
+void ProtobufWriter::WriteSlices() {
+  if (slices_.empty()) {
+    return;
+  }
+  auto& pool = util::ThreadPool::Shared();
+  std::size_t max_chunks =
+      parallel_->thread_count ? parallel_->thread_count : pool.Size();
+
+  // contiguous runs of slices of about the same number of bytes
+  std::size_t total = 0;
+  for (const auto& slice : slices_) {
+    total += slice.size;
+  }
+  std::size_t chunk_bytes = std::max<std::size_t>(1, total / max_chunks);
+  chunk_ends_.clear();
+  std::size_t bytes = 0;
+  for (std::size_t index = 0; index < slices_.size(); index++) {
+    bytes += slices_[index].size;
+    if (bytes >= chunk_bytes || index + 1 == slices_.size()) {
+      chunk_ends_.push_back(index + 1);
+      bytes = 0;
+    }
+  }
+
+  auto write_chunk = [this](std::size_t chunk) {
+    for (auto index = chunk ? chunk_ends_[chunk - 1] : 0;
+         index < chunk_ends_[chunk]; index++) {
+      const auto& slice = slices_[index];
+      if (slice.message) {
+        SerializeToArray(*slice.message, slice.target, deterministic_);
+      } else {
+        std::memcpy(slice.target, slice.bytes.data(), slice.size);
+      }
+    }
+  };
+  if (chunk_ends_.size() == 1) {
+    write_chunk(0);
+    return;
+  }
+  pool.ParallelFor(
+      chunk_ends_.size(), chunk_ends_.size(),
+      [&](std::size_t, std::size_t begin, std::size_t end) {
+        for (auto chunk = begin; chunk < end; chunk++) {
+          write_chunk(chunk);
+        }
+      });
+}
+
+bool ProtobufWriter::Expand(const StreamSet& update) const {
+  if (HasImages(update)) {
+    return true;
+  }
+  return (split_ || deterministic_) && UnknownFields(update).empty();
+}
+
+bool ProtobufWriter::Expand(const PrimitiveState& primitive) const {
+  if (HasImages(primitive)) {
+    return true;
+  }
+  return split_ && UnknownFields(primitive).empty();
+}
+
+bool ProtobufWriter::HasImages(const StreamSet& update) const {
+  for (const auto& image : images_) {
+    if (image.update == &update) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool ProtobufWriter::HasImages(const PrimitiveState& primitive) const {
+  for (const auto& image : images_) {
+    if (image.primitive == &primitive) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// the last reference wins if an image is referenced twice
+const ImageBuffer* ProtobufWriter::FindBuffer(const Image& image) const {
+  for (auto itr = images_.rbegin(); itr != images_.rend(); itr++) {
+    if (itr->image == &image) {
+      return itr->buffer;
+    }
+  }
+  return nullptr;
+}
+
+std::size_t ProtobufWriter::StreamSetSize(const StreamSet& update) {
+  auto slot = ReserveSize();
+  std::size_t size = 0;
+  if (std::bit_cast<uint64_t>(update.timestamp()) != 0) {
+    size += TagSize(StreamSet::kTimestampFieldNumber,
+                    WireFormatLite::WIRETYPE_FIXED64) +
+            sizeof(double);
+  }
+  size += MapSize(StreamSet::kPosesFieldNumber, update.poses());
+  // in the order they are written, for the sizes reserved by the images
+  ForEachEntry(update.primitives(), [&](const std::string& stream_id,
+                                        const PrimitiveState& primitive) {
+    size += FieldSize(StreamSet::kPrimitivesFieldNumber,
+                      MapEntrySize(stream_id,
+                                   Expand(primitive)
+                                       ? PrimitiveStateSize(primitive)
+                                       : primitive.ByteSizeLong()));
+  });
+  size += RepeatedSize(StreamSet::kTimeSeriesFieldNumber,
+                       update.time_series());
+  size += MapSize(StreamSet::kFutureInstancesFieldNumber,
+                  update.future_instances());
+  size += MapSize(StreamSet::kVariablesFieldNumber, update.variables());
+  size += MapSize(StreamSet::kAnnotationsFieldNumber, update.annotations());
+  size += MapSize(StreamSet::kUiPrimitivesFieldNumber, update.ui_primitives());
+  for (const auto& stream_id : update.no_data_streams()) {
+    size += FieldSize(StreamSet::kNoDataStreamsFieldNumber, stream_id.size());
+  }
+  size += MapSize(StreamSet::kLinksFieldNumber, update.links());
+  size += UnknownFieldsSize(update);
+  sizes_[slot] = size;
+  return size;
+}
+
+template <typename SinkT>
+void ProtobufWriter::WriteStreamSet(const StreamSet& update, SinkT& sink) {
+  WriteFieldHeader(StateUpdate::kUpdatesFieldNumber, NextSize(), sink);
+  if (std::bit_cast<uint64_t>(update.timestamp()) != 0) {
+    sink.WriteTag(Tag(StreamSet::kTimestampFieldNumber,
+                      WireFormatLite::WIRETYPE_FIXED64));
+    sink.WriteLittleEndian64(std::bit_cast<uint64_t>(update.timestamp()));
+  }
+  WriteEntries(StreamSet::kPosesFieldNumber, update.poses(), sink);
+  ForEachEntry(update.primitives(), [&](const std::string& stream_id,
+                                        const PrimitiveState& primitive) {
+    std::size_t begin = 0;
+    if (Expand(primitive)) {
+      begin = WritePrimitiveState(stream_id, primitive, sink);
+    } else {
+      WriteMapEntryHeader(StreamSet::kPrimitivesFieldNumber, stream_id,
+                          primitive.GetCachedSize(), sink);
+      begin = sink.Position();
+      sink.WriteMessage(primitive);
+    }
+    RecordHash(StreamSet::kPrimitivesFieldNumber, stream_id, begin,
+               sink.Position());
+  });
+  for (const auto& time_series : update.time_series()) {
+    WriteFieldHeader(StreamSet::kTimeSeriesFieldNumber,
+                     time_series.GetCachedSize(), sink);
+    auto begin = sink.Position();
+    sink.WriteMessage(time_series);
+    for (const auto& stream_id : time_series.streams()) {
+      RecordHash(StreamSet::kTimeSeriesFieldNumber, stream_id, begin,
+                 sink.Position());
+    }
+  }
+  WriteEntries(StreamSet::kFutureInstancesFieldNumber,
+               update.future_instances(), sink);
+  WriteEntries(StreamSet::kVariablesFieldNumber, update.variables(), sink);
+  WriteEntries(StreamSet::kAnnotationsFieldNumber, update.annotations(), sink);
+  WriteEntries(StreamSet::kUiPrimitivesFieldNumber, update.ui_primitives(),
+               sink);
+  for (const auto& stream_id : update.no_data_streams()) {
+    WriteStringField(StreamSet::kNoDataStreamsFieldNumber, stream_id, sink);
+  }
+  WriteEntries(StreamSet::kLinksFieldNumber, update.links(), sink);
+  WriteUnknownFields(update, sink);
+}
+
+std::size_t ProtobufWriter::PrimitiveStateSize(
+    const PrimitiveState& primitive) {
+  auto slot = ReserveSize();
+  using Fields = PrimitiveState;
+  std::size_t size =
+      RepeatedSize(Fields::kPolygonsFieldNumber, primitive.polygons()) +
+      RepeatedSize(Fields::kPolylinesFieldNumber, primitive.polylines()) +
+      RepeatedSize(Fields::kTextsFieldNumber, primitive.texts()) +
+      RepeatedSize(Fields::kCirclesFieldNumber, primitive.circles()) +
+      RepeatedSize(Fields::kPointsFieldNumber, primitive.points()) +
+      RepeatedSize(Fields::kStadiumsFieldNumber, primitive.stadiums());
+  for (const auto& image : primitive.images()) {
+    const auto* buffer = FindBuffer(image);
+    size += FieldSize(Fields::kImagesFieldNumber,
+                      buffer ? ImageSize(image, *buffer)
+                             : image.ByteSizeLong());
+  }
+  size += UnknownFieldsSize(primitive);
+  sizes_[slot] = size;
+  return size;
+}
+
+template <typename SinkT>
+std::size_t ProtobufWriter::WritePrimitiveState(
+    const std::string& stream_id, const PrimitiveState& primitive,
+    SinkT& sink) {
+  using Fields = PrimitiveState;
+  WriteMapEntryHeader(StreamSet::kPrimitivesFieldNumber, stream_id,
+                      NextSize(), sink);
+  auto begin = sink.Position();
+  WriteRepeated(Fields::kPolygonsFieldNumber, primitive.polygons(), sink);
+  WriteRepeated(Fields::kPolylinesFieldNumber, primitive.polylines(), sink);
+  WriteRepeated(Fields::kTextsFieldNumber, primitive.texts(), sink);
+  WriteRepeated(Fields::kCirclesFieldNumber, primitive.circles(), sink);
+  WriteRepeated(Fields::kPointsFieldNumber, primitive.points(), sink);
+  WriteRepeated(Fields::kStadiumsFieldNumber, primitive.stadiums(), sink);
+  for (const auto& image : primitive.images()) {
+    const auto* buffer = FindBuffer(image);
+    if (buffer) {
+      WriteImage(image, *buffer, sink);
+    } else {
+      WriteMessageField(Fields::kImagesFieldNumber, image, sink);
+    }
+  }
+  WriteUnknownFields(primitive, sink);
+  return begin;
+}
+
+std::size_t ProtobufWriter::ImageSize(const Image& image,
+                                      const ImageBuffer& buffer) {
+  auto slot = ReserveSize();
+  std::size_t size = 0;
+  if (image.has_base()) {
+    size += FieldSize(Image::kBaseFieldNumber, image.base().ByteSizeLong());
+  }
+  if (image.position_size() > 0) {
+    size += FieldSize(Image::kPositionFieldNumber,
+                      sizeof(float) * image.position_size());
+  }
+  if (!buffer.Empty()) {
+    size += FieldSize(Image::kDataFieldNumber, buffer.Size());
+  }
+  if (image.width_px() != 0) {
+    size += TagSize(Image::kWidthPxFieldNumber,
+                    WireFormatLite::WIRETYPE_VARINT) +
+            CodedOutputStream::VarintSize32(image.width_px());
+  }
+  if (image.height_px() != 0) {
+    size += TagSize(Image::kHeightPxFieldNumber,
+                    WireFormatLite::WIRETYPE_VARINT) +
+            CodedOutputStream::VarintSize32(image.height_px());
+  }
+  size += UnknownFieldsSize(image);
+  sizes_[slot] = size;
+  return size;
+}
+
+template <typename SinkT>
+void ProtobufWriter::WriteImage(const Image& image, const ImageBuffer& buffer,
+                                SinkT& sink) {
+  WriteFieldHeader(PrimitiveState::kImagesFieldNumber, NextSize(), sink);
+  if (image.has_base()) {
+    WriteMessageField(Image::kBaseFieldNumber, image.base(), sink);
+  }
+  if (image.position_size() > 0) {
+    WriteFieldHeader(Image::kPositionFieldNumber,
+                     sizeof(float) * image.position_size(), sink);
+    for (float position : image.position()) {
+      sink.WriteLittleEndian32(std::bit_cast<uint32_t>(position));
+    }
+  }
+  if (!buffer.Empty()) {
+    WriteFieldHeader(Image::kDataFieldNumber, buffer.Size(), sink);
+    sink.WriteImage(buffer);
+  }
+  if (image.width_px() != 0) {
+    sink.WriteTag(
+        Tag(Image::kWidthPxFieldNumber, WireFormatLite::WIRETYPE_VARINT));
+    sink.WriteVarint32(image.width_px());
+  }
+  if (image.height_px() != 0) {
+    sink.WriteTag(
+        Tag(Image::kHeightPxFieldNumber, WireFormatLite::WIRETYPE_VARINT));
+    sink.WriteVarint32(image.height_px());
+  }
+  WriteUnknownFields(image, sink);
+}
+
+void WriteProtobufEnvelope(const StateUpdate& message,
+                           std::span<const ImageReference> images,
+                           OutputChain& output) {
+  ProtobufWriter().Write(message, images, output);
+}
+
+void WriteProtobufEnvelope(const StateUpdate& message,
+                           std::span<const ImageReference> images,
+                           std::string& output) {
+  ProtobufWriter().Write(message, images, output);
+}
+
+}  // namespace xviz
@@ -0,0 +1,68 @@
+/*
+ * Project: libxviz
+ * Description: C++ Implementation of XVIZ Protocol
+ * Author: Minjun Xu (mjxu96@outlook.com)
+ * -----
+ * MIT License
+ * Copyright (c) 2023 Minjun Xu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <xviz/utils/hash.h>
+
+#include <cstring>
+
+namespace xviz::util {
+
+uint64_t Hash64(std::span<const uint8_t> bytes, uint64_t seed) {
+  constexpr uint64_t kMultiplier = 0xc6a4a7935bd1e995ULL;
+  constexpr int kShift = 47;
+
+  uint64_t hash = seed ^ (bytes.size() * kMultiplier);
+  const uint8_t* data = bytes.data();
+  const uint8_t* end = data + (bytes.size() & ~std::size_t(7));
+  for (; data != end; data += 8) {
+    uint64_t word;
+    // native byte order, every supported platform is little endian
+    std::memcpy(&word, data, sizeof(word));
+    word *= kMultiplier;
+    word ^= word >> kShift;
+    word *= kMultiplier;
+    hash ^= word;
+    hash *= kMultiplier;
+  }
+
+  std::size_t rest = bytes.size() & 7;
+  if (rest > 0) {
+    uint64_t word = 0;
+    for (std::size_t i = 0; i < rest; i++) {
+      word |= uint64_t(data[i]) << (8 * i);
+    }
+    hash ^= word;
+    hash *= kMultiplier;
+  }
+
+  hash ^= hash >> kShift;
+  hash *= kMultiplier;
+  hash ^= hash >> kShift;
+  return hash;
+}
+
+}  // namespace xviz::util
@@ -0,0 +1,65 @@
+/*
+ * Project: libxviz
+ * Description: C++ Implementation of XVIZ Protocol
+ * Author: Minjun Xu (mjxu96@outlook.com)
+ * -----
+ * MIT License
+ * Copyright (c) 2023 Minjun Xu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <xviz/utils/image_buffer.h>
+
+#include <stdexcept>
+
+namespace xviz::util {
+
+const Image& FindReferencedImage(const StateUpdate& message,
+                                 const ImageReference& reference) {
+  if (reference.update_index < 0 ||
+      reference.update_index >= message.updates_size()) [[unlikely]] {
+    throw std::runtime_error(std::format(
+        "update {} of the image does not exist", reference.update_index));
+  }
+  const auto& primitives = message.updates(reference.update_index).primitives();
+  auto itr = primitives.find(reference.stream_id);
+  if (itr == primitives.end() || reference.image_index < 0 ||
+      reference.image_index >= itr->second.images_size()) [[unlikely]] {
+    throw std::runtime_error(std::format("image {} of stream {} does not exist",
+                                         reference.image_index,
+                                         reference.stream_id));
+  }
+  return itr->second.images(reference.image_index);
+}
+
+void MaterializeImages(StateUpdate& message,
+                       std::span<const ImageReference> images) {
+  for (const auto& reference : images) {
+    // checks the reference before modifying the message
+    FindReferencedImage(message, reference);
+    auto& primitive = message.mutable_updates(reference.update_index)
+                          ->mutable_primitives()
+                          ->at(reference.stream_id);
+    primitive.mutable_images(reference.image_index)
+        ->set_data(reference.buffer.View().data(), reference.buffer.Size());
+  }
+}
+
+}  // namespace xviz::util
@@ -0,0 +1,289 @@
+/*
+ * Project: libxviz
+ * Description: C++ Implementation of XVIZ Protocol
+ * Author: Minjun Xu (mjxu96@outlook.com)
+ * -----
+ * MIT License
+ * Copyright (c) 2023 Minjun Xu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <xviz/utils/image_encoder.h>
+
+#include <xviz/def.h>
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+
+namespace xviz {
+
+namespace {
+
+constexpr std::array<uint32_t, 256> kCrcTable = []() {
+  std::array<uint32_t, 256> table{};
+  for (uint32_t i = 0; i < 256; i++) {
+    uint32_t crc = i;
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc & 1) ? 0xEDB88320u ^ (crc >> 1) : crc >> 1;
+    }
+    table[i] = crc;
+  }
+  return table;
+}();
+
+uint32_t Crc32(uint32_t crc, const char* data, std::size_t size) {
+  crc = ~crc;
+  for (std::size_t i = 0; i < size; i++) {
+    crc = kCrcTable[(crc ^ static_cast<uint8_t>(data[i])) & 0xFF] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+void AppendBigEndian(std::string& output, uint32_t value) {
+  output.push_back(static_cast<char>(value >> 24));
+  output.push_back(static_cast<char>(value >> 16));
+  output.push_back(static_cast<char>(value >> 8));
+  output.push_back(static_cast<char>(value));
+}
+
+// fills in the length of the chunk whose type starts at `start` and appends
+// its crc
+void FinishPngChunk(std::string& output, std::size_t start) {
+  uint32_t length = static_cast<uint32_t>(output.size() - start - 4);
+  for (int i = 0; i < 4; i++) {
+    output[start - 4 + i] = static_cast<char>(length >> (24 - 8 * i));
+  }
+  AppendBigEndian(output,
+                  Crc32(0, output.data() + start, output.size() - start));
+}
+
+}  // namespace
+
+std::size_t BytesPerPixel(PixelFormat format) {
+  switch (format) {
+    case PixelFormat::GRAY8:
+      return 1;
+    case PixelFormat::RGB8:
+    case PixelFormat::BGR8:
+      return 3;
+    case PixelFormat::RGBA8:
+    case PixelFormat::BGRA8:
+      return 4;
+  }
+  return 0;
+}
+
+std::pair<uint32_t, uint32_t> ImageEncodeOption::OutputSize(
+    uint32_t width_px, uint32_t height_px) const {
+  // nothing to scale, ImageEncoderPool::Encode() rejects empty images
+  if (width_px == 0 || height_px == 0 || (width == 0 && height == 0)) {
+    return {width_px, height_px};
+  }
+  if (width == 0) {
+    return {std::max<uint32_t>(1, static_cast<uint32_t>(uint64_t(width_px) *
+                                                        height / height_px)),
+            height};
+  }
+  if (height == 0) {
+    return {width,
+            std::max<uint32_t>(1, static_cast<uint32_t>(uint64_t(height_px) *
+                                                        width / width_px))};
+  }
+  return {width, height};
+}
+
+void PngStoreEncoder::Encode(const RawImage& image, const ImageEncodeOption&,
+                             std::string& output) {
+  std::size_t channels = BytesPerPixel(image.format);
+  bool swap_red_blue = image.format == PixelFormat::BGR8 ||
+                       image.format == PixelFormat::BGRA8;
+  std::size_t row_size = image.width * channels;
+
+  // filter type 0 followed by the row
+  scanlines_.resize((row_size + 1) * image.height);
+  for (uint32_t y = 0; y < image.height; y++) {
+    const uint8_t* src = image.pixels.data() + y * image.RowStride();
+    uint8_t* dst = scanlines_.data() + y * (row_size + 1);
+    dst[0] = 0;
+    std::copy(src, src + row_size, dst + 1);
+    if (swap_red_blue) {
+      for (std::size_t x = 0; x < row_size; x += channels) {
+        std::swap(dst[1 + x], dst[3 + x]);
+      }
+    }
+  }
+
+  constexpr std::size_t kMaxStoredBlock = 65535;
+  std::size_t block_count =
+      std::max<std::size_t>(1, (scanlines_.size() + kMaxStoredBlock - 1) /
+                                   kMaxStoredBlock);
+  output.reserve(output.size() + 57 + scanlines_.size() + 5 * block_count);
+
+  output.append("\x89PNG\r\n\x1a\n", 8);
+
+  AppendBigEndian(output, 0);
+  std::size_t start = output.size();
+  output.append("IHDR", 4);
+  AppendBigEndian(output, image.width);
+  AppendBigEndian(output, image.height);
+  output.push_back(8);
+  // grayscale, truecolor or truecolor with alpha
+  output.push_back(
+      static_cast<char>(channels == 1 ? 0 : channels == 3 ? 2 : 6));
+  output.append(3, '\0');
+  FinishPngChunk(output, start);
+
+  AppendBigEndian(output, 0);
+  start = output.size();
+  output.append("IDAT", 4);
+  // zlib stream made of stored deflate blocks
+  output.push_back(0x78);
+  output.push_back(0x01);
+  uint32_t adler_a = 1;
+  uint32_t adler_b = 0;
+  for (std::size_t offset = 0, block = 0; block < block_count; block++) {
+    auto size = std::min(kMaxStoredBlock, scanlines_.size() - offset);
+    output.push_back(block + 1 == block_count ? 1 : 0);
+    output.push_back(static_cast<char>(size & 0xFF));
+    output.push_back(static_cast<char>(size >> 8));
+    output.push_back(static_cast<char>(~size & 0xFF));
+    output.push_back(static_cast<char>((~size >> 8) & 0xFF));
+    output.append(reinterpret_cast<const char*>(scanlines_.data()) + offset,
+                  size);
+    // 5552 bytes are the most that can be summed before b overflows
+    for (std::size_t i = offset; i < offset + size;) {
+      std::size_t end = std::min(offset + size, i + 5552);
+      for (; i < end; i++) {
+        adler_a += scanlines_[i];
+        adler_b += adler_a;
+      }
+      adler_a %= 65521;
+      adler_b %= 65521;
+    }
+    offset += size;
+  }
+  AppendBigEndian(output, (adler_b << 16) | adler_a);
+  FinishPngChunk(output, start);
+
+  AppendBigEndian(output, 0);
+  start = output.size();
+  output.append("IEND", 4);
+  FinishPngChunk(output, start);
+}
+
+ImageEncoderPool::ImageEncoderPool(std::size_t thread_count,
+                                   ImageEncoderFactory factory)
+    : factory_(std::move(factory)), workers_(thread_count) {
+  if (!factory_) {
+    factory_ = []() { return std::make_unique<PngStoreEncoder>(); };
+  }
+}
+
+ImageEncoderPool& ImageEncoderPool::Shared() {
+  static ImageEncoderPool pool;
+  return pool;
+}
+
+ImageEncoderPool::Context& ImageEncoderPool::GetContext(
+    std::string_view context) {
+  std::lock_guard<std::mutex> lock(contexts_mutex_);
+  auto& ret = contexts_[std::string(context)];
+  if (!ret) {
+    ret = std::make_unique<Context>();
+    ret->encoder = factory_();
+  }
+  return *ret;
+}
+
+std::future<std::string> ImageEncoderPool::Encode(
+    std::string_view context, const RawImage& image,
+    const ImageEncodeOption& option) {
+  // checked here, a worker could neither scale nor encode an empty image
+  if (image.width == 0 || image.height == 0) [[unlikely]] {
+    throw std::runtime_error(std::format("Cannot encode a {}x{} image",
+                                         image.width, image.height));
+  }
+  std::size_t row_size = image.width * BytesPerPixel(image.format);
+  if (image.pixels.size() <
+      image.RowStride() * (image.height - 1) + row_size) [[unlikely]] {
+    throw std::runtime_error(
+        std::format("{} bytes are too few for a {}x{} image",
+                    image.pixels.size(), image.width, image.height));
+  }
+  auto& encoder_context = GetContext(context);
+  return workers_.Submit([&encoder_context, image, option]() {
+    std::string output;
+    std::lock_guard<std::mutex> lock(encoder_context.mutex);
+    auto [width, height] = option.OutputSize(image.width, image.height);
+    if (width != image.width || height != image.height) {
+      auto resized =
+          util::ResizeImage(image, width, height, encoder_context.resized);
+      encoder_context.encoder->Encode(resized, option, output);
+    } else {
+      encoder_context.encoder->Encode(image, option, output);
+    }
+    return output;
+  });
+}
+
+namespace util {
+
+RawImage ResizeImage(const RawImage& image, uint32_t width, uint32_t height,
+                     std::vector<uint8_t>& output) {
+  std::size_t channels = BytesPerPixel(image.format);
+  output.resize(std::size_t(width) * height * channels);
+  // every output pixel averages the source pixels it covers, which falls
+  // back to nearest neighbor when upscaling
+  for (uint32_t y = 0; y < height; y++) {
+    uint32_t y0 = static_cast<uint32_t>(uint64_t(y) * image.height / height);
+    uint32_t y1 = std::max(
+        y0 + 1, static_cast<uint32_t>(uint64_t(y + 1) * image.height / height));
+    for (uint32_t x = 0; x < width; x++) {
+      uint32_t x0 = static_cast<uint32_t>(uint64_t(x) * image.width / width);
+      uint32_t x1 = std::max(
+          x0 + 1, static_cast<uint32_t>(uint64_t(x + 1) * image.width / width));
+      std::array<uint32_t, 4> sums{};
+      for (uint32_t sy = y0; sy < y1; sy++) {
+        const uint8_t* row = image.pixels.data() + sy * image.RowStride();
+        for (uint32_t sx = x0; sx < x1; sx++) {
+          for (std::size_t c = 0; c < channels; c++) {
+            sums[c] += row[sx * channels + c];
+          }
+        }
+      }
+      uint32_t count = (y1 - y0) * (x1 - x0);
+      uint8_t* dst = output.data() + (std::size_t(y) * width + x) * channels;
+      for (std::size_t c = 0; c < channels; c++) {
+        dst[c] = static_cast<uint8_t>((sums[c] + count / 2) / count);
+      }
+    }
+  }
+
+  RawImage ret;
+  ret.pixels = output;
+  ret.width = width;
+  ret.height = height;
+  ret.format = image.format;
+  return ret;
+}
+
+}  // namespace util
+}  // namespace xviz
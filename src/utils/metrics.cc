@@ -0,0 +1,316 @@
+/*
+ * Project: libxviz
+ * Description: C++ Implementation of XVIZ Protocol
+ * Author: Minjun Xu (mjxu96@outlook.com)
+ * -----
+ * MIT License
+ * Copyright (c) 2023 Minjun Xu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <xviz/utils/metrics.h>
+
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+
+namespace xviz {
+
+namespace {
+
+void AppendEscapedLabel(std::string& out, std::string_view value) {
+  for (char c : value) {
+    switch (c) {
+      case '\\':
+        out += "\\\\";
+        break;
+      case '"':
+        out += "\\\"";
+        break;
+      case '\n':
+        out += "\\n";
+        break;
+      default:
+        out += c;
+    }
+  }
+}
+
+void AppendFamily(std::string& out, std::string_view name,
+                  std::string_view help, bool open_metrics) {
+  // OpenMetrics names the family without the counter's _total suffix
+  auto family = name;
+  if (open_metrics) {
+    family.remove_suffix(std::string_view("_total").size());
+  }
+  out += std::format("# HELP {} {}\n# TYPE {} counter\n", family, help,
+                     family);
+}
+
+template <typename T>
+void AppendSample(std::string& out, std::string_view name,
+                  std::string_view label, std::string_view label_value,
+                  T value) {
+  out += name;
+  out += '{';
+  out += label;
+  out += "=\"";
+  AppendEscapedLabel(out, label_value);
+  out += "\"} ";
+  out += std::format("{}\n", value);
+}
+
+double ToSeconds(uint64_t ns) { return static_cast<double>(ns) / 1e9; }
+
+}  // namespace
+
+std::string MetricsSnapshot::ToPrometheus(bool open_metrics) const {
+  std::string out;
+  AppendFamily(out, "xviz_stream_primitives_total",
+               "Primitives built on the stream.", open_metrics);
+  for (const auto& [stream_id, stream] : streams) {
+    AppendSample(out, "xviz_stream_primitives_total", "stream", stream_id,
+                 stream.primitives);
+  }
+  AppendFamily(out, "xviz_stream_bytes_total",
+               "Protobuf bytes encoded for the stream.", open_metrics);
+  for (const auto& [stream_id, stream] : streams) {
+    AppendSample(out, "xviz_stream_bytes_total", "stream", stream_id,
+                 stream.bytes);
+  }
+  AppendFamily(out, "xviz_stream_build_seconds_total",
+               "Time spent building the stream.", open_metrics);
+  for (const auto& [stream_id, stream] : streams) {
+    AppendSample(out, "xviz_stream_build_seconds_total", "stream", stream_id,
+                 ToSeconds(stream.build_ns));
+  }
+  const std::pair<std::string_view, const MessageMetrics&> formats[] = {
+      {"protobuf", protobuf}, {"json", json}};
+  AppendFamily(out, "xviz_messages_total", "Messages encoded.", open_metrics);
+  for (const auto& [format, message] : formats) {
+    AppendSample(out, "xviz_messages_total", "format", format,
+                 message.messages);
+  }
+  AppendFamily(out, "xviz_message_bytes_total", "Bytes of encoded messages.",
+               open_metrics);
+  for (const auto& [format, message] : formats) {
+    AppendSample(out, "xviz_message_bytes_total", "format", format,
+                 message.bytes);
+  }
+  AppendFamily(out, "xviz_message_encode_seconds_total",
+               "Time spent encoding messages.", open_metrics);
+  for (const auto& [format, message] : formats) {
+    AppendSample(out, "xviz_message_encode_seconds_total", "format", format,
+                 ToSeconds(message.encode_ns));
+  }
+
+  if (open_metrics) {
+    out += "# EOF\n";
+  }
+  return out;
+}
+
+Metrics& Metrics::Global() {
+  static Metrics metrics;
+  return metrics;
+}
+
+StreamCounters& Metrics::Stream(std::string_view stream_id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto itr = streams_.find(stream_id);
+  if (itr == streams_.end()) {
+    itr = streams_.try_emplace(std::string(stream_id)).first;
+  }
+  return itr->second;
+}
+
+void Metrics::RecordStreamBuild(std::string_view stream_id,
+                                uint64_t primitives, uint64_t build_ns) {
+  auto& stream = Stream(stream_id);
+  stream.primitives.fetch_add(primitives, std::memory_order_relaxed);
+  stream.build_ns.fetch_add(build_ns, std::memory_order_relaxed);
+}
+
+void Metrics::RecordStreamEncode(std::string_view stream_id, uint64_t bytes) {
+  Stream(stream_id).bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void Metrics::RecordMessage(MessageFormat format, uint64_t bytes,
+                            uint64_t encode_ns) {
+  auto& message = messages_[static_cast<int>(format)];
+  message.messages.fetch_add(1, std::memory_order_relaxed);
+  message.bytes.fetch_add(bytes, std::memory_order_relaxed);
+  message.encode_ns.fetch_add(encode_ns, std::memory_order_relaxed);
+}
+
+MetricsSnapshot Metrics::Snapshot() const {
+  MetricsSnapshot ret;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& [stream_id, counters] : streams_) {
+      StreamMetrics stream{
+          counters.primitives.load(std::memory_order_relaxed),
+          counters.bytes.load(std::memory_order_relaxed),
+          counters.build_ns.load(std::memory_order_relaxed)};
+      if (stream.primitives || stream.bytes || stream.build_ns) {
+        ret.streams.emplace(stream_id, stream);
+      }
+    }
+  }
+  auto load = [this](MessageFormat format) {
+    const auto& message = messages_[static_cast<int>(format)];
+    return MessageMetrics{message.messages.load(std::memory_order_relaxed),
+                          message.bytes.load(std::memory_order_relaxed),
+                          message.encode_ns.load(std::memory_order_relaxed)};
+  };
+  ret.protobuf = load(MessageFormat::PROTOBUF);
+  ret.json = load(MessageFormat::JSON);
+  return ret;
+}
+
+void Metrics::Reset() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto& [stream_id, counters] : streams_) {
+    counters.primitives.store(0, std::memory_order_relaxed);
+    counters.bytes.store(0, std::memory_order_relaxed);
+    counters.build_ns.store(0, std::memory_order_relaxed);
+  }
+  for (auto& message : messages_) {
+    message.messages.store(0, std::memory_order_relaxed);
+    message.bytes.store(0, std::memory_order_relaxed);
+    message.encode_ns.store(0, std::memory_order_relaxed);
+  }
+}
+
+namespace detail {
+
+namespace {
+
+struct StreamIdHash {
+  using is_transparent = void;
+  std::size_t operator()(std::string_view stream_id) const {
+    return std::hash<std::string_view>{}(stream_id);
+  }
+};
+
+}  // namespace
+
+StreamCounters& GlobalStream(std::string_view stream_id) {
+  thread_local std::unordered_map<std::string, StreamCounters*, StreamIdHash,
+                                  std::equal_to<>>
+      streams;
+  auto itr = streams.find(stream_id);
+  if (itr == streams.end()) {
+    itr = streams
+              .emplace(std::string(stream_id),
+                       &Metrics::Global().Stream(stream_id))
+              .first;
+  }
+  return *itr->second;
+}
+
+void RecordStreamEncode(const StateUpdate& update,
+                        std::span<const ImageReference> images) {
+  // the serialization has just cached the size of every value
+  auto add = [](std::string_view stream_id, uint64_t bytes) {
+    GlobalStream(stream_id).bytes.fetch_add(bytes, std::memory_order_relaxed);
+  };
+  auto add_map = [&add](const auto& map) {
+    for (const auto& [stream_id, value] : map) {
+      add(stream_id, value.GetCachedSize());
+    }
+  };
+  auto add_repeated = [](uint64_t& bytes, const auto& values) {
+    for (const auto& value : values) {
+      bytes += value.GetCachedSize();
+    }
+  };
+  for (const auto& stream_set : update.updates()) {
+    add_map(stream_set.poses());
+    for (const auto& [stream_id, primitive] : stream_set.primitives()) {
+      // the images held by reference are not in the message, and their
+      // primitives may be written field by field without a cached size
+      uint64_t bytes = 0;
+      add_repeated(bytes, primitive.polygons());
+      add_repeated(bytes, primitive.polylines());
+      add_repeated(bytes, primitive.texts());
+      add_repeated(bytes, primitive.circles());
+      add_repeated(bytes, primitive.points());
+      add_repeated(bytes, primitive.stadiums());
+      for (const auto& image : primitive.images()) {
+        bytes += image.data().size();
+      }
+      add(stream_id, bytes);
+    }
+    for (const auto& time_series : stream_set.time_series()) {
+      if (time_series.streams().empty()) {
+        continue;
+      }
+      uint64_t bytes = time_series.GetCachedSize() / time_series.streams_size();
+      for (const auto& stream_id : time_series.streams()) {
+        add(stream_id, bytes);
+      }
+    }
+    add_map(stream_set.future_instances());
+    add_map(stream_set.variables());
+    add_map(stream_set.annotations());
+    add_map(stream_set.ui_primitives());
+    add_map(stream_set.links());
+  }
+  for (const auto& image : images) {
+    add(image.stream_id, image.buffer.Size());
+  }
+}
+
+#ifdef XVIZ_ENABLE_METRICS
+void BuilderMetrics::RecordFrame(const StateUpdate& update) {
+  auto add = [](std::string_view stream_id, uint64_t primitives) {
+    GlobalStream(stream_id).primitives.fetch_add(primitives,
+                                                 std::memory_order_relaxed);
+  };
+  for (const auto& stream_set : update.updates()) {
+    for (const auto& [stream_id, pose] : stream_set.poses()) {
+      add(stream_id, 1);
+    }
+    for (const auto& [stream_id, primitive] : stream_set.primitives()) {
+      add(stream_id, primitive.polygons_size() + primitive.polylines_size() +
+                         primitive.texts_size() + primitive.circles_size() +
+                         primitive.points_size() + primitive.stadiums_size() +
+                         primitive.images_size());
+    }
+    for (const auto& time_series : stream_set.time_series()) {
+      for (const auto& stream_id : time_series.streams()) {
+        add(stream_id, 1);
+      }
+    }
+    for (const auto& [stream_id, ui_primitive] : stream_set.ui_primitives()) {
+      add(stream_id, 1);
+    }
+  }
+  for (const auto& [stream_id, build_ns] : build_ns_) {
+    GlobalStream(stream_id).build_ns.fetch_add(build_ns,
+                                               std::memory_order_relaxed);
+  }
+}
+#endif
+
+}  // namespace detail
+
+}  // namespace xviz
@@ -0,0 +1,197 @@
+/*
+ * Project: libxviz
+ * Description: C++ Implementation of XVIZ Protocol
+ * Author: Minjun Xu (mjxu96@outlook.com)
+ * -----
+ * MIT License
+ * Copyright (c) 2023 Minjun Xu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <xviz/utils/object_index.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace xviz {
+
+namespace {
+
+void AppendVarint(std::string& output, uint64_t value) {
+  while (value >= 0x80) {
+    output.push_back(static_cast<char>(value | 0x80));
+    value >>= 7;
+  }
+  output.push_back(static_cast<char>(value));
+}
+
+uint64_t ReadVarint(std::string_view input, std::size_t& position) {
+  uint64_t ret = 0;
+  for (int shift = 0; position < input.size(); shift += 7) {
+    auto byte = static_cast<uint8_t>(input[position++]);
+    ret |= uint64_t(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) {
+      break;
+    }
+  }
+  return ret;
+}
+
+template <typename MessageT>
+void AddPrimitives(const google::protobuf::RepeatedPtrField<MessageT>& field,
+                   const auto& add) {
+  for (const auto& primitive : field) {
+    add(primitive.base().object_id());
+  }
+}
+
+void AddPrimitiveState(const PrimitiveState& primitive, const auto& add) {
+  AddPrimitives(primitive.polygons(), add);
+  AddPrimitives(primitive.polylines(), add);
+  AddPrimitives(primitive.texts(), add);
+  AddPrimitives(primitive.circles(), add);
+  AddPrimitives(primitive.points(), add);
+  AddPrimitives(primitive.stadiums(), add);
+  AddPrimitives(primitive.images(), add);
+}
+
+}  // namespace
+
+void ObjectIndex::Record(uint64_t frame, const StateUpdate& update) {
+  if (frame < last_frame_) [[unlikely]] {
+    throw std::runtime_error(std::format(
+        "Frame {} is recorded after frame {}", frame, last_frame_));
+  }
+  last_frame_ = frame;
+
+  for (const auto& stream_set : update.updates()) {
+    for (const auto& [stream_id, primitive] : stream_set.primitives()) {
+      auto stream = StreamIndex(stream_id);
+      AddPrimitiveState(primitive, [&](const std::string& object_id) {
+        Add(object_id, stream, frame);
+      });
+    }
+    for (const auto& [stream_id, instances] : stream_set.future_instances()) {
+      auto stream = StreamIndex(stream_id);
+      for (const auto& primitive : instances.primitives()) {
+        AddPrimitiveState(primitive, [&](const std::string& object_id) {
+          Add(object_id, stream, frame);
+        });
+      }
+    }
+    for (const auto& time_series : stream_set.time_series()) {
+      if (time_series.object_id().empty()) {
+        continue;
+      }
+      for (const auto& stream_id : time_series.streams()) {
+        Add(time_series.object_id(), StreamIndex(stream_id), frame);
+      }
+    }
+    for (const auto& [stream_id, variables] : stream_set.variables()) {
+      auto stream = StreamIndex(stream_id);
+      for (const auto& variable : variables.variables()) {
+        Add(variable.base().object_id(), stream, frame);
+      }
+    }
+    for (const auto& [stream_id, annotations] : stream_set.annotations()) {
+      auto stream = StreamIndex(stream_id);
+      for (const auto& visual : annotations.visuals()) {
+        Add(visual.base().object_id(), stream, frame);
+      }
+    }
+  }
+}
+
+void ObjectIndex::Add(const std::string& object_id, uint32_t stream,
+                      uint64_t frame) {
+  if (object_id.empty()) {
+    return;
+  }
+  auto [itr, inserted] = postings_.try_emplace(object_id);
+  auto& posting = itr->second;
+  if (inserted) {
+    posting.first = frame;
+    posting.last = frame;
+  } else if (frame > posting.last + 1) {
+    // a gap closes the growing range
+    AppendVarint(posting.ranges, posting.first - posting.closed_last);
+    AppendVarint(posting.ranges, posting.last - posting.first);
+    posting.closed_last = posting.last;
+    posting.first = frame;
+    posting.last = frame;
+  } else {
+    posting.last = std::max(posting.last, frame);
+  }
+
+  auto position = std::ranges::lower_bound(posting.streams, stream);
+  if (position == posting.streams.end() || *position != stream) {
+    posting.streams.insert(position, stream);
+  }
+}
+
+uint32_t ObjectIndex::StreamIndex(const std::string& stream_id) {
+  auto [itr, inserted] = stream_indices_.try_emplace(
+      stream_id, static_cast<uint32_t>(stream_ids_.size()));
+  if (inserted) {
+    stream_ids_.push_back(stream_id);
+  }
+  return itr->second;
+}
+
+std::vector<FrameRange> ObjectIndex::Frames(std::string_view object_id) const {
+  std::vector<FrameRange> ret;
+  auto itr = postings_.find(std::string(object_id));
+  if (itr == postings_.end()) {
+    return ret;
+  }
+  const auto& posting = itr->second;
+  uint64_t last = 0;
+  std::size_t position = 0;
+  while (position < posting.ranges.size()) {
+    uint64_t first = last + ReadVarint(posting.ranges, position);
+    last = first + ReadVarint(posting.ranges, position);
+    ret.push_back({first, last});
+  }
+  ret.push_back({posting.first, posting.last});
+  return ret;
+}
+
+std::vector<std::string_view> ObjectIndex::Streams(
+    std::string_view object_id) const {
+  std::vector<std::string_view> ret;
+  auto itr = postings_.find(std::string(object_id));
+  if (itr == postings_.end()) {
+    return ret;
+  }
+  for (auto stream : itr->second.streams) {
+    ret.push_back(stream_ids_[stream]);
+  }
+  return ret;
+}
+
+std::size_t ObjectIndex::PostingBytes() const {
+  std::size_t ret = 0;
+  for (const auto& [object_id, posting] : postings_) {
+    ret += posting.ranges.size();
+  }
+  return ret;
+}
+
+}  // namespace xviz
@@ -0,0 +1,270 @@
+/*
+ * Project: libxviz
+ * Description: C++ Implementation of XVIZ Protocol
+ * Author: Minjun Xu (mjxu96@outlook.com)
+ * -----
+ * MIT License
+ * Copyright (c) 2023 Minjun Xu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <xviz/utils/point_cloud.h>
+#include <xviz/utils/thread_pool.h>
+
+#include <xviz/def.h>
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace xviz::util {
+
+namespace {
+
+// below this many points per chunk it is not worth waking up workers
+constexpr std::size_t kMinPointsPerChunk = 1 << 16;
+constexpr int64_t kVoxelAxisLimit = (int64_t(1) << 20) - 1;
+
+uint64_t SplitMix64(uint64_t x) {
+  x += 0x9E3779B97F4A7C15ull;
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+  return x ^ (x >> 31);
+}
+
+double UnitRandom(uint64_t index, uint64_t seed) {
+  return double(SplitMix64(index ^ SplitMix64(seed)) >> 11) * 0x1.0p-53;
+}
+
+// The point has to be finite. Far out cells are clamped before the
+// conversion, which is undefined for values out of the int64_t range.
+uint64_t VoxelKey(const float* point, float inverse_voxel_size) {
+  uint64_t key = 0;
+  for (int axis = 0; axis < 3; axis++) {
+    double cell = std::clamp(
+        std::floor(double(point[axis]) * inverse_voxel_size),
+        double(-kVoxelAxisLimit), double(kVoxelAxisLimit));
+    key = (key << 21) | uint64_t(static_cast<int64_t>(cell) + kVoxelAxisLimit);
+  }
+  return key;
+}
+
+bool IsFinite(const float* point) {
+  return std::isfinite(point[0]) && std::isfinite(point[1]) &&
+         std::isfinite(point[2]);
+}
+
+// open addressing set of voxel keys, keys never reach the empty marker since
+// they only use 63 bits
+class VoxelSet {
+ public:
+  explicit VoxelSet(std::size_t expected_size = 32)
+      : keys_(std::bit_ceil(std::max<std::size_t>(64, expected_size * 2)),
+              kEmpty) {}
+
+  bool Insert(uint64_t key) {
+    if ((size_ + 1) * 2 > keys_.size()) {
+      Grow();
+    }
+    if (InsertNoGrow(keys_, key)) {
+      size_++;
+      return true;
+    }
+    return false;
+  }
+
+ private:
+  static constexpr uint64_t kEmpty = std::numeric_limits<uint64_t>::max();
+
+  static bool InsertNoGrow(std::vector<uint64_t>& keys, uint64_t key) {
+    std::size_t mask = keys.size() - 1;
+    std::size_t slot = SplitMix64(key) & mask;
+    while (true) {
+      if (keys[slot] == kEmpty) {
+        keys[slot] = key;
+        return true;
+      }
+      if (keys[slot] == key) {
+        return false;
+      }
+      slot = (slot + 1) & mask;
+    }
+  }
+
+  void Grow() {
+    std::vector<uint64_t> keys(keys_.size() * 2, kEmpty);
+    for (uint64_t key : keys_) {
+      if (key != kEmpty) {
+        InsertNoGrow(keys, key);
+      }
+    }
+    keys_.swap(keys);
+  }
+
+  std::vector<uint64_t> keys_;
+  std::size_t size_{0};
+};
+
+bool KeepPoint(const PointDownsampleOption& option, const float* point,
+               uint64_t index) {
+  switch (option.method) {
+    case PointDownsampleOption::UNIFORM:
+      return option.stride <= 1 || index % option.stride == 0;
+    case PointDownsampleOption::RANDOM:
+      return UnitRandom(index, option.seed) < option.keep_ratio;
+    case PointDownsampleOption::DISTANCE_WEIGHTED: {
+      double distance2 = double(point[0]) * point[0] +
+                         double(point[1]) * point[1] +
+                         double(point[2]) * point[2];
+      double reference2 =
+          double(option.reference_distance) * option.reference_distance;
+      double probability = reference2 > 0 ? distance2 / reference2 : 1.0;
+      probability = std::max(probability, double(option.keep_ratio));
+      return UnitRandom(index, option.seed) < probability;
+    }
+    default:
+      return true;
+  }
+}
+
+struct ChunkResult {
+  std::vector<std::vector<uint32_t>> kept;
+  // voxel key of every kept point, only filled for VOXEL_GRID levels
+  std::vector<std::vector<uint64_t>> keys;
+};
+
+void ValidateLevel(const PointDownsampleOption& option) {
+  if (option.method == PointDownsampleOption::VOXEL_GRID &&
+      !(option.voxel_size > 0)) [[unlikely]] {
+    throw std::invalid_argument(
+        std::format("voxel size {} should be positive", option.voxel_size));
+  }
+}
+
+}  // namespace
+
+std::vector<uint32_t> DownsamplePoints(std::span<const float> flatten_points,
+                                       const PointDownsampleOption& option,
+                                       uint32_t thread_count) {
+  auto ret = DownsamplePoints(flatten_points, std::span(&option, 1),
+                              thread_count);
+  return std::move(ret.front());
+}
+
+std::vector<std::vector<uint32_t>> DownsamplePoints(
+    std::span<const float> flatten_points,
+    std::span<const PointDownsampleOption> levels, uint32_t thread_count) {
+  if (flatten_points.size() % 3 != 0) [[unlikely]] {
+    throw std::invalid_argument(
+        std::format("flatten points size {} is not a multiple of 3",
+                    flatten_points.size()));
+  }
+  std::size_t point_count = flatten_points.size() / 3;
+  if (point_count > std::numeric_limits<uint32_t>::max()) [[unlikely]] {
+    throw std::invalid_argument(
+        std::format("too many points to downsample: {}", point_count));
+  }
+  for (const auto& level : levels) {
+    ValidateLevel(level);
+  }
+
+  auto& pool = ThreadPool::Shared();
+  std::size_t max_chunks = thread_count ? thread_count : pool.Size();
+  max_chunks = std::min(
+      max_chunks, std::max<std::size_t>(1, point_count / kMinPointsPerChunk));
+  std::size_t chunk_size = std::max<std::size_t>(
+      1, (point_count + max_chunks - 1) / max_chunks);
+  std::vector<ChunkResult> chunks((point_count + chunk_size - 1) / chunk_size);
+
+  pool.ParallelFor(point_count, chunks.size(), [&](std::size_t chunk_index,
+                                                   std::size_t begin,
+                                                   std::size_t end) {
+    auto& chunk = chunks[chunk_index];
+    chunk.kept.resize(levels.size());
+    chunk.keys.resize(levels.size());
+    std::vector<VoxelSet> voxel_sets;
+    std::vector<float> inverse_voxel_sizes(levels.size());
+    voxel_sets.reserve(levels.size());
+    for (std::size_t level = 0; level < levels.size(); level++) {
+      if (levels[level].method == PointDownsampleOption::VOXEL_GRID) {
+        inverse_voxel_sizes[level] = 1.0f / levels[level].voxel_size;
+        // sized for the worst case so that the hot loop never rehashes
+        voxel_sets.emplace_back(end - begin);
+      } else {
+        voxel_sets.emplace_back();
+      }
+    }
+
+    for (std::size_t index = begin; index < end; index++) {
+      const float* point = flatten_points.data() + index * 3;
+      // no level keeps them, they have no voxel, distance or JSON number
+      if (!IsFinite(point)) {
+        continue;
+      }
+      for (std::size_t level = 0; level < levels.size(); level++) {
+        const auto& option = levels[level];
+        if (option.method == PointDownsampleOption::VOXEL_GRID) {
+          uint64_t key = VoxelKey(point, inverse_voxel_sizes[level]);
+          if (voxel_sets[level].Insert(key)) {
+            chunk.kept[level].push_back(uint32_t(index));
+            chunk.keys[level].push_back(key);
+          }
+        } else if (KeepPoint(option, point, index)) {
+          chunk.kept[level].push_back(uint32_t(index));
+        }
+      }
+    }
+  });
+
+  std::vector<std::vector<uint32_t>> ret(levels.size());
+  for (std::size_t level = 0; level < levels.size(); level++) {
+    auto& kept = ret[level];
+    if (chunks.size() == 1) {
+      kept = std::move(chunks.front().kept[level]);
+      continue;
+    }
+    std::size_t total = 0;
+    for (const auto& chunk : chunks) {
+      total += chunk.kept[level].size();
+    }
+    kept.reserve(total);
+    if (levels[level].method != PointDownsampleOption::VOXEL_GRID) {
+      for (const auto& chunk : chunks) {
+        kept.insert(kept.end(), chunk.kept[level].begin(),
+                    chunk.kept[level].end());
+      }
+      continue;
+    }
+    // a voxel may be hit by several chunks, the earliest point wins
+    VoxelSet merged;
+    for (const auto& chunk : chunks) {
+      for (std::size_t i = 0; i < chunk.kept[level].size(); i++) {
+        if (merged.Insert(chunk.keys[level][i])) {
+          kept.push_back(chunk.kept[level][i]);
+        }
+      }
+    }
+  }
+  return ret;
+}
+
+}  // namespace xviz::util
@@ -0,0 +1,156 @@
+/*
+ * Project: libxviz
+ * Description: C++ Implementation of XVIZ Protocol
+ * Author: Minjun Xu (mjxu96@outlook.com)
+ * -----
+ * MIT License
+ * Copyright (c) 2023 Minjun Xu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <xviz/utils/thread_pool.h>
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+
+namespace xviz::util {
+
+ThreadPool::ThreadPool(std::size_t thread_count) {
+  if (thread_count == 0) {
+    thread_count = std::max(1u, std::thread::hardware_concurrency());
+  }
+  workers_.reserve(thread_count);
+  for (std::size_t i = 0; i < thread_count; i++) {
+    workers_.emplace_back(&ThreadPool::WorkerLoop, this);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopped_ = true;
+  }
+  cv_.notify_all();
+  for (auto& worker : workers_) {
+    worker.join();
+  }
+}
+
+ThreadPool& ThreadPool::Shared() {
+  static ThreadPool pool;
+  return pool;
+}
+
+namespace {
+
+// Shared with the helper tasks, which may only get to run after
+// ParallelFor() returned and then find no chunk left
+struct ParallelForState {
+  const std::function<void(std::size_t, std::size_t, std::size_t)>* func;
+  std::size_t count;
+  std::size_t chunks;
+  std::size_t chunk_size;
+  std::atomic<std::size_t> next{0};
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::size_t done{0};
+  std::exception_ptr error;
+};
+
+void RunChunks(ParallelForState& state) {
+  while (true) {
+    std::size_t chunk = state.next.fetch_add(1, std::memory_order_relaxed);
+    if (chunk >= state.chunks) {
+      return;
+    }
+    std::size_t begin = chunk * state.chunk_size;
+    std::size_t end = std::min(state.count, begin + state.chunk_size);
+    std::exception_ptr error;
+    try {
+      (*state.func)(chunk, begin, end);
+    } catch (...) {
+      error = std::current_exception();
+    }
+    std::lock_guard<std::mutex> lock(state.mutex);
+    if (error && !state.error) {
+      state.error = error;
+    }
+    if (++state.done == state.chunks) {
+      state.cv.notify_all();
+    }
+  }
+}
+
+}  // namespace
+
+void ThreadPool::ParallelFor(
+    std::size_t count, std::size_t max_chunks,
+    const std::function<void(std::size_t, std::size_t, std::size_t)>& func) {
+  if (count == 0) {
+    return;
+  }
+  auto state = std::make_shared<ParallelForState>();
+  state->func = &func;
+  state->count = count;
+  state->chunks = std::clamp<std::size_t>(max_chunks, 1, count);
+  state->chunk_size = (count + state->chunks - 1) / state->chunks;
+  state->chunks = (count + state->chunk_size - 1) / state->chunk_size;
+
+  std::size_t helpers = std::min(state->chunks - 1, Size());
+  for (std::size_t helper = 0; helper < helpers; helper++) {
+    Enqueue([state]() { RunChunks(*state); });
+  }
+  // The caller takes chunks too and only waits for the ones already
+  // running, so a ParallelFor() on a worker of the same pool, e.g. of
+  // Shared(), finishes even when every worker is busy
+  RunChunks(*state);
+  std::unique_lock<std::mutex> lock(state->mutex);
+  state->cv.wait(lock, [&state]() { return state->done == state->chunks; });
+  if (state->error) {
+    std::rethrow_exception(state->error);
+  }
+}
+
+void ThreadPool::Enqueue(std::function<void()> task) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    tasks_.push(std::move(task));
+  }
+  cv_.notify_one();
+}
+
+void ThreadPool::WorkerLoop() {
+  while (true) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cv_.wait(lock, [this]() { return stopped_ || !tasks_.empty(); });
+      if (stopped_ && tasks_.empty()) {
+        return;
+      }
+      task = std::move(tasks_.front());
+      tasks_.pop();
+    }
+    task();
+  }
+}
+
+}  // namespace xviz::util
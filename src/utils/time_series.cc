@@ -0,0 +1,191 @@
+/*
+ * Project: libxviz
+ * Description: C++ Implementation of XVIZ Protocol
+ * Author: Minjun Xu (mjxu96@outlook.com)
+ * -----
+ * MIT License
+ * Copyright (c) 2023 Minjun Xu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <xviz/utils/time_series.h>
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+namespace xviz::util {
+
+namespace {
+
+struct GroupKey {
+  uint64_t timestamp_bits;
+  std::string_view object_id;
+  std::size_t value_type;
+
+  bool operator==(const GroupKey&) const = default;
+};
+
+struct GroupKeyHash {
+  std::size_t operator()(const GroupKey& key) const {
+    std::size_t hash = std::hash<uint64_t>()(key.timestamp_bits);
+    hash ^= std::hash<std::string_view>()(key.object_id) + 0x9E3779B9 +
+            (hash << 6) + (hash >> 2);
+    return hash ^ key.value_type;
+  }
+};
+
+}  // namespace
+
+void AppendTimeSeriesSamples(
+    google::protobuf::RepeatedPtrField<TimeSeriesState>& time_series,
+    std::span<const TimeSeriesSample> samples) {
+  // first pass to find the groups and their sizes so that every repeated
+  // field is reserved once
+  std::unordered_map<GroupKey, uint32_t, GroupKeyHash> group_indices;
+  std::vector<uint32_t> sample_groups(samples.size());
+  std::vector<int> group_sizes;
+  for (std::size_t i = 0; i < samples.size(); i++) {
+    const auto& sample = samples[i];
+    GroupKey key{std::bit_cast<uint64_t>(sample.timestamp), sample.object_id,
+                 sample.value.index()};
+    auto [itr, inserted] =
+        group_indices.try_emplace(key, uint32_t(group_sizes.size()));
+    if (inserted) {
+      group_sizes.push_back(0);
+    }
+    sample_groups[i] = itr->second;
+    group_sizes[itr->second]++;
+  }
+
+  int first_state = time_series.size();
+  time_series.Reserve(first_state + static_cast<int>(group_sizes.size()));
+  for (std::size_t i = 0; i < samples.size(); i++) {
+    uint32_t group = sample_groups[i];
+    const auto& sample = samples[i];
+    if (first_state + int(group) == time_series.size()) {
+      // groups are numbered by their first sample
+      auto new_state = time_series.Add();
+      new_state->set_timestamp(sample.timestamp);
+      if (!sample.object_id.empty()) {
+        new_state->set_object_id(sample.object_id.data(),
+                                 sample.object_id.size());
+      }
+      new_state->mutable_streams()->Reserve(group_sizes[group]);
+      auto values = new_state->mutable_values();
+      switch (sample.value.index()) {
+        case 0:
+          values->mutable_doubles()->Reserve(group_sizes[group]);
+          break;
+        case 1:
+          values->mutable_int32s()->Reserve(group_sizes[group]);
+          break;
+        case 2:
+          values->mutable_bools()->Reserve(group_sizes[group]);
+          break;
+        default:
+          values->mutable_strings()->Reserve(group_sizes[group]);
+          break;
+      }
+    }
+
+    auto state = time_series.Mutable(first_state + static_cast<int>(group));
+    state->add_streams(sample.stream_id.data(), sample.stream_id.size());
+    auto values = state->mutable_values();
+    std::visit(
+        [values](const auto& value) {
+          using ValueT = std::decay_t<decltype(value)>;
+          if constexpr (std::is_same_v<ValueT, double>) {
+            values->add_doubles(value);
+          } else if constexpr (std::is_same_v<ValueT, int32_t>) {
+            values->add_int32s(value);
+          } else if constexpr (std::is_same_v<ValueT, bool>) {
+            values->add_bools(value);
+          } else {
+            values->add_strings(value.data(), value.size());
+          }
+        },
+        sample.value);
+  }
+}
+
+std::vector<std::size_t> LargestTriangleThreeBuckets(std::span<const double> x,
+                                                     std::span<const double> y,
+                                                     std::size_t threshold) {
+  std::size_t size = std::min(x.size(), y.size());
+  std::vector<std::size_t> indices;
+  if (threshold == 0 || threshold >= size) {
+    indices.resize(size);
+    for (std::size_t i = 0; i < size; i++) {
+      indices[i] = i;
+    }
+    return indices;
+  }
+  if (threshold < 3) {
+    // no room for buckets, keep the ends only
+    if (threshold == 2) {
+      indices.push_back(0);
+    }
+    indices.push_back(size - 1);
+    return indices;
+  }
+
+  indices.reserve(threshold);
+  indices.push_back(0);
+  // the first and last points are fixed, the rest is split into buckets
+  double bucket_size = double(size - 2) / double(threshold - 2);
+  std::size_t selected = 0;
+  for (std::size_t bucket = 0; bucket < threshold - 2; bucket++) {
+    auto begin = static_cast<std::size_t>(double(bucket) * bucket_size) + 1;
+    auto end = static_cast<std::size_t>(double(bucket + 1) * bucket_size) + 1;
+    // average of the next bucket, or the last point for the last bucket
+    auto next_begin = end;
+    auto next_end = std::min(
+        static_cast<std::size_t>(double(bucket + 2) * bucket_size) + 1, size);
+    double average_x = 0;
+    double average_y = 0;
+    for (std::size_t i = next_begin; i < next_end; i++) {
+      average_x += x[i];
+      average_y += y[i];
+    }
+    average_x /= double(next_end - next_begin);
+    average_y /= double(next_end - next_begin);
+
+    double max_area = -1;
+    std::size_t max_index = begin;
+    for (std::size_t i = begin; i < end; i++) {
+      double area = std::abs((x[selected] - average_x) * (y[i] - y[selected]) -
+                             (x[selected] - x[i]) * (average_y - y[selected]));
+      if (area > max_area) {
+        max_area = area;
+        max_index = i;
+      }
+    }
+    indices.push_back(max_index);
+    selected = max_index;
+  }
+  indices.push_back(size - 1);
+  return indices;
+}
+
+}  // namespace xviz::util
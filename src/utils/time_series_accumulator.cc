@@ -0,0 +1,130 @@
+/*
+ * Project: libxviz
+ * Description: C++ Implementation of XVIZ Protocol
+ * Author: Minjun Xu (mjxu96@outlook.com)
+ * -----
+ * MIT License
+ * Copyright (c) 2023 Minjun Xu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <xviz/utils/time_series_accumulator.h>
+
+#include <algorithm>
+#include <bit>
+
+namespace xviz {
+
+TimeSeriesAccumulator::Handle TimeSeriesAccumulator::Register(
+    std::string stream_id, const StreamOption& option) {
+  auto stream = std::make_unique<Stream>();
+  stream->stream_id = std::move(stream_id);
+  stream->option = option;
+  std::size_t capacity =
+      std::bit_ceil(std::max<std::size_t>(option.capacity, 2));
+  stream->slots = std::make_unique<Slot[]>(capacity);
+  stream->mask = capacity - 1;
+  streams_.push_back(std::move(stream));
+  return static_cast<Handle>(streams_.size() - 1);
+}
+
+bool TimeSeriesAccumulator::Push(Handle handle, double timestamp,
+                                 double value) {
+  auto& stream = *streams_[handle];
+  uint64_t index = stream.write_index.load(std::memory_order_relaxed);
+  do {
+    if (index - stream.read_index.load(std::memory_order_acquire) >
+        stream.mask) [[unlikely]] {
+      stream.dropped.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+  } while (!stream.write_index.compare_exchange_weak(
+      index, index + 1, std::memory_order_acq_rel, std::memory_order_relaxed));
+
+  // the slot is ours until the collector moves past it
+  auto& slot = stream.slots[index & stream.mask];
+  slot.timestamp = timestamp;
+  slot.value = value;
+  slot.sequence.store(index + 1, std::memory_order_release);
+  return true;
+}
+
+std::span<const TimeSeriesSample> TimeSeriesAccumulator::Collect() {
+  samples_.clear();
+  for (const auto& stream : streams_) {
+    timestamps_.clear();
+    values_.clear();
+    uint64_t begin = stream->read_index.load(std::memory_order_relaxed);
+    uint64_t end = stream->write_index.load(std::memory_order_acquire);
+    uint64_t index = begin;
+    for (; index < end; index++) {
+      const auto& slot = stream->slots[index & stream->mask];
+      if (slot.sequence.load(std::memory_order_acquire) != index + 1) {
+        // a producer is still writing it, the rest goes to the next flush
+        break;
+      }
+      timestamps_.push_back(slot.timestamp);
+      values_.push_back(slot.value);
+    }
+    stream->read_index.store(index, std::memory_order_release);
+    if (!values_.empty()) {
+      Reduce(*stream);
+    }
+  }
+  return samples_;
+}
+
+void TimeSeriesAccumulator::Reduce(const Stream& stream) {
+  const std::string& stream_id = stream.stream_id;
+  switch (stream.option.reduction) {
+    case LAST:
+      samples_.push_back({stream_id, values_.back(), timestamps_.back()});
+      break;
+    case MIN: {
+      auto itr = std::min_element(values_.begin(), values_.end());
+      samples_.push_back(
+          {stream_id, *itr, timestamps_[itr - values_.begin()]});
+      break;
+    }
+    case MAX: {
+      auto itr = std::max_element(values_.begin(), values_.end());
+      samples_.push_back(
+          {stream_id, *itr, timestamps_[itr - values_.begin()]});
+      break;
+    }
+    case MEAN: {
+      double sum = 0;
+      for (double value : values_) {
+        sum += value;
+      }
+      samples_.push_back(
+          {stream_id, sum / double(values_.size()), timestamps_.back()});
+      break;
+    }
+    case LTTB:
+      for (std::size_t index : util::LargestTriangleThreeBuckets(
+               timestamps_, values_, stream.option.lttb_threshold)) {
+        samples_.push_back({stream_id, values_[index], timestamps_[index]});
+      }
+      break;
+  }
+}
+
+}  // namespace xviz
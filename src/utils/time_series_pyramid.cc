@@ -0,0 +1,162 @@
+/*
+ * Project: libxviz
+ * Description: C++ Implementation of XVIZ Protocol
+ * Author: Minjun Xu (mjxu96@outlook.com)
+ * -----
+ * MIT License
+ * Copyright (c) 2023 Minjun Xu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <xviz/utils/time_series_pyramid.h>
+
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+
+namespace xviz {
+
+void TimeSeriesPyramid::Node::Merge(const Node& other) {
+  if (count == 0) {
+    *this = other;
+    return;
+  }
+  min = std::min(min, other.min);
+  max = std::max(max, other.max);
+  sum += other.sum;
+  count += other.count;
+}
+
+void TimeSeriesPyramid::Add(std::string_view stream_id, double timestamp,
+                            double value) {
+  auto itr = streams_.find(stream_id);
+  if (itr == streams_.end()) {
+    itr = streams_.emplace(std::string(stream_id), Stream()).first;
+  }
+  auto& stream = itr->second;
+  if (!stream.timestamps.empty() && timestamp < stream.timestamps.back())
+      [[unlikely]] {
+    throw std::runtime_error(
+        std::format("Timestamp {} of {} is before the previous one {}",
+                    timestamp, stream_id, stream.timestamps.back()));
+  }
+  stream.timestamps.push_back(timestamp);
+
+  // the sample goes into the last node of every level
+  Node sample{value, value, value, 1};
+  std::size_t index = stream.timestamps.size() - 1;
+  for (std::size_t level = 0;; level++) {
+    if (level == 0 && stream.levels.empty()) {
+      stream.levels.emplace_back();
+    } else if (level == stream.levels.size()) {
+      // the previous top node sums up every sample before this one
+      stream.levels.push_back({stream.levels[level - 1].front()});
+    }
+    auto& nodes = stream.levels[level];
+    if ((index >> level) == nodes.size()) {
+      nodes.push_back(sample);
+    } else {
+      nodes.back().Merge(sample);
+    }
+    // the top level has a single node
+    if (nodes.size() == 1 && (std::size_t(1) << level) >= index + 1) {
+      break;
+    }
+  }
+}
+
+void TimeSeriesPyramid::Record(const StateUpdate& update) {
+  for (const auto& stream_set : update.updates()) {
+    for (const auto& time_series : stream_set.time_series()) {
+      if (!time_series.object_id().empty()) {
+        continue;
+      }
+      const auto& values = time_series.values();
+      for (int index = 0; index < time_series.streams_size(); index++) {
+        if (index < values.doubles_size()) {
+          Add(time_series.streams(index), time_series.timestamp(),
+              values.doubles(index));
+        } else if (index < values.int32s_size()) {
+          Add(time_series.streams(index), time_series.timestamp(),
+              values.int32s(index));
+        }
+      }
+    }
+  }
+}
+
+TimeSeriesPyramid::Node TimeSeriesPyramid::Aggregate(const Stream& stream,
+                                                     std::size_t first,
+                                                     std::size_t last) {
+  Node ret;
+  while (first < last) {
+    // the node of `first` at this level starts at it and ends before `last`
+    std::size_t level = std::min<std::size_t>(
+        {first == 0 ? 63 : static_cast<std::size_t>(std::countr_zero(first)),
+         static_cast<std::size_t>(std::bit_width(last - first) - 1),
+         stream.levels.size() - 1});
+    ret.Merge(stream.levels[level][first >> level]);
+    first += std::size_t(1) << level;
+  }
+  return ret;
+}
+
+std::vector<PlotBucket> TimeSeriesPyramid::Buckets(std::string_view stream_id,
+                                                   double begin, double end,
+                                                   std::size_t count) const {
+  std::vector<PlotBucket> ret(count);
+  double width = count ? (end - begin) / double(count) : 0;
+  for (std::size_t index = 0; index < count; index++) {
+    ret[index].begin = begin + width * double(index);
+    ret[index].end =
+        index + 1 == count ? end : begin + width * double(index + 1);
+  }
+  auto itr = streams_.find(stream_id);
+  if (itr == streams_.end() || count == 0) {
+    return ret;
+  }
+
+  const auto& stream = itr->second;
+  const auto& timestamps = stream.timestamps;
+  auto first = std::lower_bound(timestamps.begin(), timestamps.end(), begin);
+  for (auto& bucket : ret) {
+    bool last_bucket = &bucket == &ret.back();
+    auto last = last_bucket
+                    ? std::upper_bound(first, timestamps.end(), bucket.end)
+                    : std::lower_bound(first, timestamps.end(), bucket.end);
+    auto node = Aggregate(stream, first - timestamps.begin(),
+                          last - timestamps.begin());
+    if (node.count > 0) {
+      bucket.count = node.count;
+      bucket.min = node.min;
+      bucket.max = node.max;
+      bucket.mean = node.sum / double(node.count);
+    }
+    first = last;
+  }
+  return ret;
+}
+
+std::size_t TimeSeriesPyramid::SampleCount(std::string_view stream_id) const {
+  auto itr = streams_.find(stream_id);
+  return itr == streams_.end() ? 0 : itr->second.timestamps.size();
+}
+
+}  // namespace xviz
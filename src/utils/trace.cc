@@ -0,0 +1,264 @@
+/*
+ * Project: libxviz
+ * Description: C++ Implementation of XVIZ Protocol
+ * Author: Minjun Xu (mjxu96@outlook.com)
+ * -----
+ * MIT License
+ * Copyright (c) 2023 Minjun Xu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <xviz/utils/trace.h>
+
+#include <xviz/def.h>
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+
+namespace xviz::trace {
+
+namespace detail {
+
+std::atomic<bool> enabled{false};
+
+namespace {
+
+// Single producer ring, the owner thread writes and Collect() reads the
+// slots through a per slot sequence number
+class Ring {
+ public:
+  Ring(std::size_t capacity, uint32_t thread_id)
+      : slots_(std::make_unique<Slot[]>(capacity)),
+        mask_(capacity - 1),
+        thread_id_(thread_id) {}
+
+  void Push(const char* name, const char* category, uint64_t start_ns,
+            uint64_t end_ns) {
+    auto index = head_.load(std::memory_order_relaxed);
+    auto& slot = slots_[index & mask_];
+    slot.sequence.store(index * 2 + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.name.store(name, std::memory_order_relaxed);
+    slot.category.store(category, std::memory_order_relaxed);
+    slot.start_ns.store(start_ns, std::memory_order_relaxed);
+    slot.duration_ns.store(end_ns - start_ns, std::memory_order_relaxed);
+    slot.sequence.store(index * 2 + 2, std::memory_order_release);
+    head_.store(index + 1, std::memory_order_release);
+  }
+
+  // Owner thread only, the copies live as long as the ring
+  const char* Intern(std::string_view name) {
+    auto found = names_.find(name);
+    if (found == names_.end()) {
+      found = names_.emplace(name).first;
+    }
+    return found->c_str();
+  }
+
+  void Collect(std::vector<Event>& events) const {
+    auto end = head_.load(std::memory_order_acquire);
+    auto begin = end > mask_ + 1 ? end - mask_ - 1 : 0;
+    for (auto index = begin; index < end; index++) {
+      const auto& slot = slots_[index & mask_];
+      auto sequence = slot.sequence.load(std::memory_order_acquire);
+      if (sequence != index * 2 + 2) {
+        continue;
+      }
+      Event event{slot.name.load(std::memory_order_relaxed),
+                  slot.category.load(std::memory_order_relaxed),
+                  slot.start_ns.load(std::memory_order_relaxed),
+                  slot.duration_ns.load(std::memory_order_relaxed),
+                  thread_id_};
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (slot.sequence.load(std::memory_order_relaxed) == sequence) {
+        events.push_back(event);
+      }
+    }
+  }
+
+ private:
+  struct Slot {
+    std::atomic<uint64_t> sequence{0};
+    std::atomic<const char*> name{nullptr};
+    std::atomic<const char*> category{nullptr};
+    std::atomic<uint64_t> start_ns{0};
+    std::atomic<uint64_t> duration_ns{0};
+  };
+
+  std::unique_ptr<Slot[]> slots_;
+  uint64_t mask_;
+  uint32_t thread_id_;
+  std::atomic<uint64_t> head_{0};
+  // Looked up by string_view so that recording a known name does not allocate
+  struct NameHash {
+    using is_transparent = void;
+    std::size_t operator()(std::string_view name) const {
+      return std::hash<std::string_view>{}(name);
+    }
+  };
+  std::unordered_set<std::string, NameHash, std::equal_to<>> names_;
+};
+
+struct Registry {
+  std::mutex mutex;
+  std::size_t capacity{8192};
+  std::vector<std::shared_ptr<Ring>> rings;
+  // rings of exited threads, reused by new ones
+  std::vector<std::shared_ptr<Ring>> idle;
+};
+
+Registry& GetRegistry() {
+  static Registry registry;
+  return registry;
+}
+
+class ThreadRing {
+ public:
+  ~ThreadRing() {
+    if (ring_) {
+      auto& registry = GetRegistry();
+      std::lock_guard<std::mutex> lock(registry.mutex);
+      registry.idle.push_back(std::move(ring_));
+    }
+  }
+
+  Ring& Get() {
+    if (!ring_) [[unlikely]] {
+      auto& registry = GetRegistry();
+      std::lock_guard<std::mutex> lock(registry.mutex);
+      if (!registry.idle.empty()) {
+        ring_ = std::move(registry.idle.back());
+        registry.idle.pop_back();
+      } else {
+        ring_ = std::make_shared<Ring>(
+            registry.capacity, static_cast<uint32_t>(registry.rings.size()));
+        registry.rings.push_back(ring_);
+      }
+    }
+    return *ring_;
+  }
+
+ private:
+  std::shared_ptr<Ring> ring_;
+};
+
+Ring& CurrentRing() {
+  static thread_local ThreadRing ring;
+  return ring.Get();
+}
+
+void AppendEscaped(std::string& out, std::string_view text) {
+  for (char c : text) {
+    switch (c) {
+      case '"':
+        out += "\\\"";
+        break;
+      case '\\':
+        out += "\\\\";
+        break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          out += std::format("\\u{:04x}", static_cast<int>(c));
+        } else {
+          out += c;
+        }
+    }
+  }
+}
+
+}  // namespace
+
+uint64_t Now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+void Record(const char* name, const char* category, uint64_t start_ns,
+            uint64_t end_ns) {
+  CurrentRing().Push(name, category, start_ns, end_ns);
+}
+
+void Record(std::string_view name, const char* category, uint64_t start_ns,
+            uint64_t end_ns) {
+  auto& ring = CurrentRing();
+  ring.Push(ring.Intern(name), category, start_ns, end_ns);
+}
+
+}  // namespace detail
+
+void Enable(std::size_t events_per_thread) {
+  auto& registry = detail::GetRegistry();
+  {
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.capacity = std::bit_ceil(std::max<std::size_t>(
+        events_per_thread, 1));
+  }
+  detail::enabled.store(true, std::memory_order_relaxed);
+}
+
+void Disable() { detail::enabled.store(false, std::memory_order_relaxed); }
+
+std::vector<Event> Collect() {
+  std::vector<std::shared_ptr<detail::Ring>> rings;
+  {
+    auto& registry = detail::GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    rings = registry.rings;
+  }
+  std::vector<Event> events;
+  for (const auto& ring : rings) {
+    ring->Collect(events);
+  }
+  return events;
+}
+
+std::string DumpChromeTrace() {
+  auto events = Collect();
+  uint64_t origin_ns = UINT64_MAX;
+  for (const auto& event : events) {
+    origin_ns = std::min(origin_ns, event.start_ns);
+  }
+
+  std::string out = "{\"traceEvents\":[";
+  for (std::size_t i = 0; i < events.size(); i++) {
+    const auto& event = events[i];
+    if (i) {
+      out += ',';
+    }
+    out += "{\"name\":\"";
+    detail::AppendEscaped(out, event.name);
+    out += "\",\"cat\":\"";
+    detail::AppendEscaped(out, event.category);
+    out += std::format(
+        "\",\"ph\":\"X\",\"ts\":{:.3f},\"dur\":{:.3f},\"pid\":1,\"tid\":{}}}",
+        (event.start_ns - origin_ns) / 1e3, event.duration_ns / 1e3,
+        event.thread_id);
+  }
+  out += "],\"displayTimeUnit\":\"ms\"}";
+  return out;
+}
+
+}  // namespace xviz::trace
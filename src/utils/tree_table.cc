@@ -0,0 +1,162 @@
+/*
+ * Project: libxviz
+ * Description: C++ Implementation of XVIZ Protocol
+ * Author: Minjun Xu (mjxu96@outlook.com)
+ * -----
+ * MIT License
+ * Copyright (c) 2023 Minjun Xu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <xviz/utils/tree_table.h>
+
+#include <charconv>
+#include <cstdio>
+#include <stdexcept>
+
+namespace xviz::util {
+
+namespace {
+
+// Formats a cell into an internal buffer, the returned view is only valid
+// until the next call.
+class CellFormatter {
+ public:
+  std::string_view operator()(int value) {
+    auto res = std::to_chars(buffer_, buffer_ + sizeof(buffer_), value);
+    return {buffer_, res.ptr};
+  }
+
+  // same as std::to_string(double), i.e. "%f"
+  std::string_view operator()(double value) {
+#if defined(__cpp_lib_to_chars)
+    auto res = std::to_chars(buffer_, buffer_ + sizeof(buffer_), value,
+                             std::chars_format::fixed, 6);
+    if (res.ec == std::errc()) [[likely]] {
+      return {buffer_, res.ptr};
+    }
+#else
+    int size = std::snprintf(buffer_, sizeof(buffer_), "%f", value);
+    if (size >= 0 && std::size_t(size) < sizeof(buffer_)) [[likely]] {
+      return {buffer_, std::size_t(size)};
+    }
+#endif
+    // huge values do not fit into the buffer
+    large_value_ = std::to_string(value);
+    return large_value_;
+  }
+
+  std::string_view operator()(bool value) { return value ? "1" : "0"; }
+
+  std::string_view operator()(const std::string& value) { return value; }
+
+  std::string_view operator()(std::string_view value) { return value; }
+
+ private:
+  char buffer_[64];
+  std::string large_value_;
+};
+
+void CheckColumns(const xviz::TreeTable& table, std::size_t row_count,
+                  std::span<const TreeTableColumnView> columns) {
+  if (columns.size() != std::size_t(table.columns_size())) [[unlikely]] {
+    throw std::runtime_error(
+        std::format("{} columns are given but the tree table has {}",
+                    columns.size(), table.columns_size()));
+  }
+  for (std::size_t idx = 0; idx < columns.size(); idx++) {
+    auto expected_type = table.columns(idx).type();
+    if (columns[idx].GetHoldType() != expected_type) [[unlikely]] {
+      throw std::runtime_error(std::format(
+          "column {} value type {} does not match the required column type "
+          "{}",
+          table.columns(idx).display_text(),
+          TreeTableColumn_ColumnType_Name(columns[idx].GetHoldType()),
+          TreeTableColumn_ColumnType_Name(expected_type)));
+    }
+    if (columns[idx].Size() != row_count) [[unlikely]] {
+      throw std::runtime_error(
+          std::format("column {} has {} values but {} rows are expected",
+                      table.columns(idx).display_text(), columns[idx].Size(),
+                      row_count));
+    }
+  }
+}
+
+}  // namespace
+
+void AppendTreeTableRows(xviz::TreeTable& table, std::span<const int> ids,
+                         std::span<const int> parents,
+                         std::span<const TreeTableColumnView> columns) {
+  if (!parents.empty() && parents.size() != ids.size()) [[unlikely]] {
+    throw std::runtime_error(std::format(
+        "{} parents are given for {} rows", parents.size(), ids.size()));
+  }
+  CheckColumns(table, ids.size(), columns);
+
+  auto nodes = table.mutable_nodes();
+  int first_node = nodes->size();
+  nodes->Reserve(first_node + static_cast<int>(ids.size()));
+  for (std::size_t row = 0; row < ids.size(); row++) {
+    auto new_node = nodes->Add();
+    new_node->set_id(ids[row]);
+    new_node->set_parent(parents.empty() ? 0 : parents[row]);
+    auto values = new_node->mutable_column_values();
+    values->Reserve(static_cast<int>(columns.size()));
+    for (std::size_t idx = 0; idx < columns.size(); idx++) {
+      values->Add();
+    }
+  }
+
+  CellFormatter formatter;
+  for (std::size_t idx = 0; idx < columns.size(); idx++) {
+    columns[idx].Visit([&](const auto& values) {
+      for (std::size_t row = 0; row < values.size(); row++) {
+        nodes->Mutable(first_node + static_cast<int>(row))
+            ->mutable_column_values(static_cast<int>(idx))
+            ->assign(formatter(values[row]));
+      }
+    });
+  }
+}
+
+void UpdateTreeTableRows(xviz::TreeTable& table,
+                         std::span<const uint32_t> positions,
+                         std::span<const TreeTableColumnView> columns) {
+  CheckColumns(table, table.nodes_size(), columns);
+
+  auto nodes = table.mutable_nodes();
+  CellFormatter formatter;
+  for (std::size_t idx = 0; idx < columns.size(); idx++) {
+    columns[idx].Visit([&](const auto& values) {
+      for (uint32_t position : positions) {
+        if (position >= values.size()) [[unlikely]] {
+          throw std::out_of_range(std::format(
+              "row {} is out of the {} rows", position, values.size()));
+        }
+        nodes->Mutable(static_cast<int>(position))
+            ->mutable_column_values(static_cast<int>(idx))
+            ->assign(formatter(values[position]));
+      }
+    });
+  }
+}
+
+}  // namespace xviz::util
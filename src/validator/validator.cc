@@ -0,0 +1,243 @@
+/*
+ * Project: libxviz
+ * Description: C++ Implementation of XVIZ Protocol
+ * Author: Minjun Xu (mjxu96@outlook.com)
+ * -----
+ * MIT License
+ * Copyright (c) 2023 Minjun Xu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <xviz/validator/validator.h>
+
+namespace xviz {
+
+std::string_view ToString(ViolationType type) {
+  switch (type) {
+    case ViolationType::UNKNOWN_STREAM:
+      return "UNKNOWN_STREAM";
+    case ViolationType::WRONG_CATEGORY:
+      return "WRONG_CATEGORY";
+    case ViolationType::WRONG_PRIMITIVE_TYPE:
+      return "WRONG_PRIMITIVE_TYPE";
+    case ViolationType::WRONG_SCALAR_TYPE:
+      return "WRONG_SCALAR_TYPE";
+    case ViolationType::MISSING_POSE:
+      return "MISSING_POSE";
+    default:
+      return "UNKNOWN";
+  }
+}
+
+Validator::Validator(const Metadata& metadata, ValidatorOption option)
+    : option_(std::move(option)) {
+  if (option_.sample_every == 0) {
+    option_.sample_every = 1;
+  }
+  rules_.reserve(metadata.streams_size());
+  for (const auto& [stream_id, stream] : metadata.streams()) {
+    bool needs_pose = stream.coordinate() == StreamMetadata::VEHICLE_RELATIVE;
+    rules_.emplace(stream_id,
+                   Rule{stream.category(), stream.primitive_type(),
+                        stream.scalar_type(), needs_pose});
+  }
+}
+
+std::size_t Validator::Validate(const StateUpdate& update) {
+  auto seen = updates_seen_.fetch_add(1, std::memory_order_relaxed);
+  if (seen % option_.sample_every != 0) {
+    return 0;
+  }
+  updates_checked_.fetch_add(1, std::memory_order_relaxed);
+
+  std::size_t count = 0;
+  // SNAPSHOT is deprecated and means the same as INCREMENTAL, only a
+  // complete state has to carry everything a viewer needs
+  bool complete = update.update_type() == StateUpdate::COMPLETE_STATE;
+  for (int index = 0; index < update.updates_size(); index++) {
+    count += ValidateStreamSet(update.updates(index), index, complete);
+  }
+  return count;
+}
+
+uint64_t Validator::UpdatesSeen() const {
+  return updates_seen_.load(std::memory_order_relaxed);
+}
+
+uint64_t Validator::UpdatesChecked() const {
+  return updates_checked_.load(std::memory_order_relaxed);
+}
+
+uint64_t Validator::Violations(ViolationType type) const {
+  return violations_[static_cast<std::size_t>(type)].load(
+      std::memory_order_relaxed);
+}
+
+uint64_t Validator::TotalViolations() const {
+  uint64_t total = 0;
+  for (const auto& count : violations_) {
+    total += count.load(std::memory_order_relaxed);
+  }
+  return total;
+}
+
+std::size_t Validator::ValidateStreamSet(const StreamSet& stream_set,
+                                         int update_index, bool complete) {
+  std::size_t count = 0;
+  bool has_pose = !stream_set.poses().empty();
+  auto find_stream = [&](const std::string& stream_id) -> const Rule* {
+    auto itr = rules_.find(stream_id);
+    if (itr == rules_.end()) [[unlikely]] {
+      Report(ViolationType::UNKNOWN_STREAM, update_index, stream_id);
+      count++;
+      return nullptr;
+    }
+    return &itr->second;
+  };
+  auto find_rule = [&](const std::string& stream_id,
+                       StreamMetadata::Category category) -> const Rule* {
+    const auto* found = find_stream(stream_id);
+    if (!found) [[unlikely]] {
+      return nullptr;
+    }
+    const auto& rule = *found;
+    if (rule.category != category) [[unlikely]] {
+      Report(ViolationType::WRONG_CATEGORY, update_index, stream_id);
+      count++;
+      return nullptr;
+    }
+    if (rule.needs_pose && complete && !has_pose) [[unlikely]] {
+      Report(ViolationType::MISSING_POSE, update_index, stream_id);
+      count++;
+    }
+    return &rule;
+  };
+
+  for (const auto& [stream_id, pose] : stream_set.poses()) {
+    find_rule(stream_id, StreamMetadata::POSE);
+  }
+  for (const auto& [stream_id, primitive] : stream_set.primitives()) {
+    auto rule = find_rule(stream_id, StreamMetadata::PRIMITIVE);
+    if (rule && !MatchPrimitiveType(*rule, primitive)) [[unlikely]] {
+      Report(ViolationType::WRONG_PRIMITIVE_TYPE, update_index, stream_id);
+      count++;
+    }
+  }
+  for (const auto& time_series : stream_set.time_series()) {
+    for (const auto& stream_id : time_series.streams()) {
+      auto rule = find_rule(stream_id, StreamMetadata::TIME_SERIES);
+      if (rule && !MatchScalarType(*rule, time_series.values())) [[unlikely]] {
+        Report(ViolationType::WRONG_SCALAR_TYPE, update_index, stream_id);
+        count++;
+      }
+    }
+  }
+  for (const auto& [stream_id, variable] : stream_set.variables()) {
+    find_rule(stream_id, StreamMetadata::VARIABLE);
+  }
+  for (const auto& [stream_id, annotation] : stream_set.annotations()) {
+    find_rule(stream_id, StreamMetadata::ANNOTATION);
+  }
+  for (const auto& [stream_id, instances] : stream_set.future_instances()) {
+    find_rule(stream_id, StreamMetadata::FUTURE_INSTANCE);
+  }
+  for (const auto& [stream_id, ui_primitive] : stream_set.ui_primitives()) {
+    find_rule(stream_id, StreamMetadata::UI_PRIMITIVE);
+  }
+  for (const auto& stream_id : stream_set.no_data_streams()) {
+    find_stream(stream_id);
+  }
+  // the linked stream follows the target pose
+  for (const auto& [stream_id, link] : stream_set.links()) {
+    find_stream(stream_id);
+    find_rule(link.target_pose(), StreamMetadata::POSE);
+  }
+  return count;
+}
+
+void Validator::Report(ViolationType type, int update_index,
+                       std::string_view stream_id) {
+  violations_[static_cast<std::size_t>(type)].fetch_add(
+      1, std::memory_order_relaxed);
+  if (option_.callback) {
+    option_.callback({type, update_index, stream_id});
+  }
+}
+
+bool Validator::MatchPrimitiveType(const Rule& rule,
+                                   const PrimitiveState& state) {
+  int matched = 0;
+  switch (rule.primitive_type) {
+    case StreamMetadata::CIRCLE:
+      matched = state.circles_size();
+      break;
+    case StreamMetadata::IMAGE:
+      matched = state.images_size();
+      break;
+    case StreamMetadata::POINT:
+      matched = state.points_size();
+      break;
+    case StreamMetadata::POLYGON:
+      matched = state.polygons_size();
+      break;
+    case StreamMetadata::POLYLINE:
+      matched = state.polylines_size();
+      break;
+    case StreamMetadata::STADIUM:
+      matched = state.stadiums_size();
+      break;
+    case StreamMetadata::TEXT:
+      matched = state.texts_size();
+      break;
+    default:
+      // the metadata does not restrict the type
+      return true;
+  }
+  int total = state.circles_size() + state.images_size() +
+              state.points_size() + state.polygons_size() +
+              state.polylines_size() + state.stadiums_size() +
+              state.texts_size();
+  return matched == total;
+}
+
+bool Validator::MatchScalarType(const Rule& rule, const Values& values) {
+  int matched = 0;
+  switch (rule.scalar_type) {
+    case StreamMetadata::FLOAT:
+      matched = values.doubles_size();
+      break;
+    case StreamMetadata::INT32:
+      matched = values.int32s_size();
+      break;
+    case StreamMetadata::STRING:
+      matched = values.strings_size();
+      break;
+    case StreamMetadata::BOOL:
+      matched = values.bools_size();
+      break;
+    default:
+      return true;
+  }
+  int total = values.doubles_size() + values.int32s_size() +
+              values.strings_size() + values.bools_size();
+  return matched == total;
+}
+
+}  // namespace xviz
@@ -0,0 +1,141 @@
+/*
+ * Project: libxviz
+ * Description: C++ Implementation of XVIZ Protocol
+ * Author: Minjun Xu (mjxu96@outlook.com)
+ * -----
+ * MIT License
+ * Copyright (c) 2023 Minjun Xu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <xviz/xviz.h>
+#include "utils/cleanup.h"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace xviz::tests {
+
+class BuilderPoolTest : public ::testing::Test {
+ public:
+  void SetUp() override {}
+
+  void TearDown() override {}
+
+  static void BuildFrame(Builder& builder, double timestamp) {
+    // clang-format off
+    builder
+      .Timestamp(timestamp)
+      .Primitive("/object/shape")
+        .Polygon({{1, 2, 3}, {4, 5, 6}, {7, 8, 9}})
+      .TimeSeries("/speed")
+        .Timestamp(timestamp)
+        .Value(timestamp);
+    // clang-format on
+  }
+};
+
+TEST_F(BuilderPoolTest, FinishTest) {
+  Builder builder;
+  BuildFrame(builder, 1);
+  auto image = std::make_shared<const std::string>("image");
+  builder.Primitive("/camera").Image(ImageBuffer(image));
+  auto frame = builder.Finish();
+
+  ASSERT_FALSE(frame.Empty());
+  EXPECT_EQ(frame.Data().updates(0).timestamp(), 1);
+  EXPECT_EQ(frame.Data().updates(0).primitives().size(), 2);
+  ASSERT_EQ(frame.ImageReferences().size(), 1);
+  EXPECT_EQ(frame.ImageReferences()[0].stream_id, "/camera");
+
+  // the builder starts over right away
+  const auto& next = builder.GetData();
+  EXPECT_EQ(next.updates_size(), 1);
+  EXPECT_EQ(next.updates(0).primitives().size(), 0);
+  EXPECT_TRUE(builder.ImageReferences().empty());
+
+  BuildFrame(builder, 2);
+  auto second = builder.Finish();
+  EXPECT_EQ(second.Data().updates(0).timestamp(), 2);
+  EXPECT_EQ(frame.Data().updates(0).timestamp(), 1);
+
+  Message<StateUpdate> message(std::move(second));
+  EXPECT_FALSE(message.ToProtobufBinary().empty());
+}
+
+TEST_F(BuilderPoolTest, RecycleTest) {
+  BuilderPool pool;
+  const StateUpdate* first_data = nullptr;
+  Builder* first_builder = nullptr;
+  {
+    auto builder = pool.Acquire();
+    first_builder = builder.get();
+    BuildFrame(*builder, 1);
+    auto frame = builder->Finish();
+    first_data = &frame.Data();
+    EXPECT_EQ(pool.Recycler().IdleCount(), 0);
+  }
+  // both the frame's data and the builder went back to the pool
+  EXPECT_EQ(pool.IdleBuilders(), 1);
+  EXPECT_EQ(pool.Recycler().IdleCount(), 1);
+
+  auto builder = pool.Acquire();
+  EXPECT_EQ(builder.get(), first_builder);
+  EXPECT_EQ(pool.IdleBuilders(), 0);
+  BuildFrame(*builder, 2);
+  auto frame = builder->Finish();
+  EXPECT_EQ(frame.Data().updates(0).timestamp(), 2);
+  EXPECT_EQ(frame.Data().updates(0).time_series_size(), 1);
+
+  // the recycled update backs the next frame
+  EXPECT_EQ(pool.Recycler().IdleCount(), 0);
+  EXPECT_EQ(&builder->GetData(), first_data);
+}
+
+TEST_F(BuilderPoolTest, ConcurrentTest) {
+  BuilderPool pool(4);
+  std::vector<std::thread> threads;
+  std::vector<std::vector<double>> timestamps(4);
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([&pool, &timestamps, t]() {
+      for (int i = 0; i < 100; i++) {
+        auto builder = pool.Acquire();
+        BuildFrame(*builder, t * 1000 + i);
+        auto frame = builder->Finish();
+        timestamps[t].push_back(frame.Data().updates(0).timestamp());
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (int t = 0; t < 4; t++) {
+    ASSERT_EQ(timestamps[t].size(), 100);
+    EXPECT_EQ(timestamps[t][42], t * 1000 + 42);
+  }
+  EXPECT_LE(pool.IdleBuilders(), 4);
+  EXPECT_GE(pool.IdleBuilders(), 1);
+}
+
+}  // namespace xviz::tests
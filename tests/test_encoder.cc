@@ -0,0 +1,624 @@
+/*
+ * Project: libxviz
+ * Description: C++ Implementation of XVIZ Protocol
+ * Author: Minjun Xu (mjxu96@outlook.com)
+ * -----
+ * MIT License
+ * Copyright (c) 2023 Minjun Xu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <xviz/xviz.h>
+#include "utils/cleanup.h"
+
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/io/zero_copy_stream_impl_lite.h>
+#include <google/protobuf/util/message_differencer.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace xviz::tests {
+std::atomic<std::size_t> allocation_count = 0;
+}  // namespace xviz::tests
+
+// counts every heap allocation of the test binary
+void* operator new(std::size_t size) {
+  xviz::tests::allocation_count.fetch_add(1, std::memory_order_relaxed);
+  if (void* ptr = std::malloc(size ? size : 1)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+
+namespace xviz::tests {
+
+class EncoderTest : public ::testing::Test {
+ public:
+  void SetUp() override {
+    camera_ = std::make_shared<const std::vector<uint8_t>>(300000, 7);
+    small_ = std::make_shared<const std::string>("small image");
+  }
+
+  void TearDown() override {}
+
+  // a frame with a bit of everything and images both held by reference and
+  // copied
+  void Build() {
+    std::vector<uint8_t> copied = {1, 2, 3};
+    // clang-format off
+    builder_
+      .Timestamp(1000.5)
+      .Pose("/vehicle_pose")
+        .Position(1, 2, 3)
+      .Primitive("/object/shape")
+        .Polygon({{1, 2, 3}, {4, 5, 6}, {7, 8, 9}})
+        .ID("object-1")
+      .Primitive("/camera/front")
+        .Image(ImageBuffer(camera_))
+          .Dimensions(1920, 1080)
+          .ID("front")
+        .Image(copied.data(), copied.size())
+      .Primitive("/camera/rear")
+        .Image(ImageBuffer(small_))
+      .TimeSeries("/speed")
+        .Timestamp(1000)
+        .Value(10.0)
+      .UIPrimitive("/table")
+        .Column("name", TreeTableColumn::STRING)
+        .Row(0, {"row"});
+    // clang-format on
+  }
+
+  xviz::Builder builder_;
+  std::shared_ptr<const std::vector<uint8_t>> camera_;
+  std::shared_ptr<const std::string> small_;
+};
+
+TEST_F(EncoderTest, ImageReferencesTest) {
+  Build();
+  auto& data = builder_.GetData();
+  auto references = builder_.ImageReferences();
+  ASSERT_EQ(references.size(), 2);
+  for (const auto& reference : references) {
+    EXPECT_EQ(reference.update_index, 0);
+    EXPECT_EQ(reference.image_index, 0);
+    EXPECT_TRUE(util::FindReferencedImage(data, reference).data().empty());
+  }
+  // the copied image is untouched
+  EXPECT_EQ(data.updates(0).primitives().at("/camera/front").images(1).data(),
+            "\x01\x02\x03");
+}
+
+TEST_F(EncoderTest, ProtobufBinaryIdenticalTest) {
+  Build();
+  auto& data = builder_.GetData();
+  auto references = builder_.ImageReferences();
+
+  std::string spliced;
+  WriteProtobufEnvelope(data, references, spliced);
+  SlicePool pool(1024);
+  OutputChain chain(pool);
+  WriteProtobufEnvelope(data, references, chain);
+  // the large image is spliced, not copied
+  bool zero_copy = false;
+  for (const auto& vec : chain.IoVecs()) {
+    zero_copy = zero_copy || vec.iov_base == camera_->data();
+  }
+  EXPECT_TRUE(zero_copy);
+
+  // protobuf's output for the same message, map iteration order included,
+  // with the images copied in
+  util::MaterializeImages(data, references);
+  Envelope envelope;
+  envelope.set_type("xviz/state_update");
+  envelope.mutable_data()->PackFrom(data);
+  auto expected = "\x50\x42\x45\x31" + envelope.SerializeAsString();
+
+  EXPECT_EQ(spliced.size(), expected.size());
+  EXPECT_TRUE(spliced == expected);
+  EXPECT_EQ(chain.Size(), expected.size());
+  EXPECT_TRUE(chain.ToString() == expected);
+
+  // without any reference the writer matches protobuf as well
+  std::string plain;
+  WriteProtobufEnvelope(data, {}, plain);
+  EXPECT_TRUE(plain == expected);
+}
+
+TEST_F(EncoderTest, ParallelWriterIdenticalTest) {
+  Build();
+  std::vector<float> points(3 * 50000, 1.5f);
+  // clang-format off
+  builder_
+    .Primitive("/lidar")
+      .Point(points)
+    .NextUpdate()
+    .Timestamp(1000.6)
+    .Primitive("/lidar")
+      .Point(points)
+    .Primitive("/camera/front")
+      .Image(ImageBuffer(camera_));
+  // clang-format on
+  auto& data = builder_.GetData();
+  auto references = builder_.ImageReferences();
+  ASSERT_EQ(references.size(), 3);
+
+  std::string expected;
+  WriteProtobufEnvelope(data, references, expected);
+  for (std::size_t min_slice_bytes : {1, 1024, 64 * 1024, 1 << 30}) {
+    for (uint32_t threads : {1, 4}) {
+      ProtobufWriter writer({threads, min_slice_bytes});
+      std::string parallel = "prefix";
+      writer.Write(data, references, parallel);
+      EXPECT_TRUE(parallel == "prefix" + expected)
+          << min_slice_bytes << " " << threads;
+    }
+  }
+
+  Encoder encoder(ParallelWriteOption{});
+  EXPECT_TRUE(encoder.ToProtobufBinary(data, references) == expected);
+  std::string plain;
+  WriteProtobufEnvelope(data, {}, plain);
+  EXPECT_TRUE(encoder.ToProtobufBinary(data, {}) == plain);
+}
+
+TEST_F(EncoderTest, ProtobufWriterFieldCountTest) {
+  // a field missing from ProtobufWriter would be dropped from the output
+  EXPECT_EQ(StateUpdate::descriptor()->field_count(),
+            ProtobufWriter::kStateUpdateFieldCount);
+  EXPECT_EQ(StreamSet::descriptor()->field_count(),
+            ProtobufWriter::kStreamSetFieldCount);
+  EXPECT_EQ(PrimitiveState::descriptor()->field_count(),
+            ProtobufWriter::kPrimitiveStateFieldCount);
+  EXPECT_EQ(Image::descriptor()->field_count(),
+            ProtobufWriter::kImageFieldCount);
+}
+
+TEST_F(EncoderTest, ProtobufWriterUnknownFieldsTest) {
+  Build();
+  auto& data = builder_.GetData();
+  auto references = builder_.ImageReferences();
+  // e.g. fields of a newer protocol version kept while parsing
+  auto unknown_fields = [](google::protobuf::Message& message) {
+    return message.GetReflection()->MutableUnknownFields(&message);
+  };
+  unknown_fields(data)->AddVarint(100, 1);
+  auto& update = *data.mutable_updates(0);
+  unknown_fields(update)->AddLengthDelimited(100, "stream set");
+  auto& primitives = *update.mutable_primitives();
+  unknown_fields(primitives["/object/shape"])->AddFixed32(100, 2);
+  unknown_fields(primitives["/camera/front"])->AddFixed64(100, 3);
+  unknown_fields(*primitives["/camera/front"].mutable_images(0))
+      ->AddVarint(100, 4);
+
+  std::string plain;
+  WriteProtobufEnvelope(data, references, plain);
+  SlicePool pool(1024);
+  OutputChain chain(pool);
+  WriteProtobufEnvelope(data, references, chain);
+  std::vector<std::string> parallel;
+  for (std::size_t min_slice_bytes : {1, 1 << 30}) {
+    ProtobufWriter writer({4, min_slice_bytes});
+    writer.Write(data, references, parallel.emplace_back());
+  }
+  ProtobufWriter writer;
+  writer.SetDeterministic(true);
+  std::string deterministic;
+  writer.Write(data, references, deterministic);
+
+  // a copy would iterate its maps in another order
+  util::MaterializeImages(data, references);
+  auto envelope_of = [](const std::string& value) {
+    Envelope envelope;
+    envelope.set_type("xviz/state_update");
+    envelope.mutable_data()->set_type_url(
+        "type.googleapis.com/xviz.v2.StateUpdate");
+    envelope.mutable_data()->set_value(value);
+    return "\x50\x42\x45\x31" + envelope.SerializeAsString();
+  };
+  auto expected = envelope_of(data.SerializeAsString());
+  EXPECT_NE(expected.find("stream set"), std::string::npos);
+  EXPECT_TRUE(plain == expected);
+  EXPECT_TRUE(chain.ToString() == expected);
+  for (const auto& output : parallel) {
+    EXPECT_TRUE(output == expected);
+  }
+
+  std::string sorted;
+  {
+    google::protobuf::io::StringOutputStream stream(&sorted);
+    google::protobuf::io::CodedOutputStream coded(&stream);
+    coded.SetSerializationDeterministic(true);
+    data.SerializeToCodedStream(&coded);
+  }
+  EXPECT_TRUE(deterministic == envelope_of(sorted));
+}
+
+TEST_F(EncoderTest, ParallelJsonIdenticalTest) {
+  Build();
+  std::vector<float> points;
+  for (int i = 0; i < 3 * 2000; i++) {
+    points.push_back(i * 0.37f - 100);
+  }
+  // clang-format off
+  builder_
+    .Primitive("/lidar")
+      .Point(points)
+    .NextUpdate()
+    .Timestamp(1000.6)
+    .Pose("/vehicle_pose")
+      .Position(4, 5, 6)
+    .Primitive("/lidar \"quoted\" {}")
+      .Point(points)
+      .Point(std::vector<float>{1, 2, 3})
+    .Primitive("/empty");
+  // clang-format on
+  auto& data = builder_.GetData();
+  auto references = builder_.ImageReferences();
+  std::string binary;
+  WriteProtobufEnvelope(data, references, binary);
+
+  google::protobuf::util::JsonPrintOptions options;
+  options.preserve_proto_field_names = true;
+  std::string expected;
+  ConvertEnvelopeToJson(binary, expected, options);
+  for (std::size_t min_slice_bytes : {64, 1024, 8192}) {
+    for (uint32_t threads : {1, 4}) {
+      std::string json = "prefix";
+      ConvertEnvelopeToJson(binary, json, options,
+                            {threads, min_slice_bytes});
+      EXPECT_TRUE(json == "prefix" + expected)
+          << min_slice_bytes << " " << threads;
+    }
+  }
+
+  // the field names and enums as protobuf prints them by default
+  options.preserve_proto_field_names = false;
+  options.always_print_enums_as_ints = true;
+  expected.clear();
+  ConvertEnvelopeToJson(binary, expected, options);
+  std::string json;
+  ConvertEnvelopeToJson(binary, json, options, {4, 256});
+  EXPECT_TRUE(json == expected);
+
+  Message<StateUpdate> message(data);
+  EXPECT_TRUE(message.ToJsonString({4, 256}) == message.ToJsonString());
+  Encoder encoder(ParallelWriteOption{4, 256});
+  EXPECT_TRUE(encoder.ToJsonString(data, references) ==
+              Encoder().ToJsonString(data, references));
+}
+
+// Sets every field of `message`, with three values in every map and
+// repeated field, down to `depth` levels of messages. The values start from
+// `seed`.
+void FillMessage(google::protobuf::Message& message, int depth,
+                 int seed = 0) {
+  const auto* descriptor = message.GetDescriptor();
+  const auto* reflection = message.GetReflection();
+  for (int index = 0; index < descriptor->field_count(); index++) {
+    const auto* field = descriptor->field(index);
+    const auto* oneof = field->containing_oneof();
+    if ((oneof && reflection->HasOneof(message, oneof)) ||
+        (field->message_type() && depth == 0)) {
+      continue;
+    }
+    for (int value = 0; value < (field->is_repeated() ? 3 : 1); value++) {
+      auto number = seed + value + index + 1;
+      bool repeated = field->is_repeated();
+      switch (field->cpp_type()) {
+        case google::protobuf::FieldDescriptor::CPPTYPE_INT32:
+          repeated ? reflection->AddInt32(&message, field, number)
+                   : reflection->SetInt32(&message, field, number);
+          break;
+        case google::protobuf::FieldDescriptor::CPPTYPE_INT64:
+          repeated ? reflection->AddInt64(&message, field, number)
+                   : reflection->SetInt64(&message, field, number);
+          break;
+        case google::protobuf::FieldDescriptor::CPPTYPE_UINT32:
+          repeated ? reflection->AddUInt32(&message, field, number)
+                   : reflection->SetUInt32(&message, field, number);
+          break;
+        case google::protobuf::FieldDescriptor::CPPTYPE_UINT64:
+          repeated ? reflection->AddUInt64(&message, field, number)
+                   : reflection->SetUInt64(&message, field, number);
+          break;
+        case google::protobuf::FieldDescriptor::CPPTYPE_DOUBLE:
+          repeated ? reflection->AddDouble(&message, field, number * 0.37)
+                   : reflection->SetDouble(&message, field, number * 0.37);
+          break;
+        case google::protobuf::FieldDescriptor::CPPTYPE_FLOAT:
+          repeated ? reflection->AddFloat(&message, field, number * 0.37f)
+                   : reflection->SetFloat(&message, field, number * 0.37f);
+          break;
+        case google::protobuf::FieldDescriptor::CPPTYPE_BOOL:
+          repeated ? reflection->AddBool(&message, field, true)
+                   : reflection->SetBool(&message, field, true);
+          break;
+        case google::protobuf::FieldDescriptor::CPPTYPE_ENUM: {
+          const auto* values = field->enum_type();
+          const auto* enum_value =
+              values->value(number % values->value_count());
+          repeated ? reflection->AddEnum(&message, field, enum_value)
+                   : reflection->SetEnum(&message, field, enum_value);
+          break;
+        }
+        case google::protobuf::FieldDescriptor::CPPTYPE_STRING: {
+          // map keys have to differ
+          auto text = "/\"quoted\" {" + std::to_string(number) + "}";
+          repeated ? reflection->AddString(&message, field, text)
+                   : reflection->SetString(&message, field, text);
+          break;
+        }
+        case google::protobuf::FieldDescriptor::CPPTYPE_MESSAGE:
+          FillMessage(repeated ? *reflection->AddMessage(&message, field)
+                               : *reflection->MutableMessage(&message, field),
+                      field->is_map() ? depth : depth - 1, number);
+          break;
+      }
+    }
+  }
+}
+
+TEST_F(EncoderTest, ParallelJsonEveryFieldTest) {
+  StateUpdate data;
+  FillMessage(data, 6);
+  ASSERT_EQ(data.updates_size(), 3);
+  ASSERT_EQ(data.updates(0).primitives_size(), 3);
+  ASSERT_EQ(data.updates(0).links_size(), 3);
+  Message<StateUpdate> message(data);
+  auto expected = message.ToJsonString();
+  for (std::size_t min_slice_bytes : {1, 16, 256, 4096, 1 << 30}) {
+    for (uint32_t threads : {1, 4}) {
+      EXPECT_TRUE(message.ToJsonString({threads, min_slice_bytes}) ==
+                  expected)
+          << min_slice_bytes << " " << threads;
+    }
+  }
+}
+
+TEST_F(EncoderTest, DeterministicTest) {
+  auto build = [](Builder& builder, bool reversed, float moved) {
+    builder.Timestamp(1000).Pose("/vehicle_pose").Position(1, 2, 3);
+    for (int i = 0; i < 20; i++) {
+      int stream = reversed ? 19 - i : i;
+      builder.Primitive("/object/" + std::to_string(stream))
+          .Circle(std::array<float, 3>{stream == 7 ? moved : 0, 0, 0}, 1);
+    }
+    builder.TimeSeries("/speed").Timestamp(1000).Value(10.0);
+    builder.TimeSeries("/speed").Timestamp(1000).Value(11.0);
+    return builder.GetData();
+  };
+  Builder forward;
+  Builder reversed;
+  Builder changed;
+  Message<StateUpdate> first(build(forward, false, 0));
+  Message<StateUpdate> second(build(reversed, true, 0));
+  Message<StateUpdate> third(build(changed, false, 5));
+
+  std::vector<StreamHash> first_hashes;
+  std::vector<StreamHash> second_hashes;
+  std::vector<StreamHash> third_hashes;
+  auto binary = first.ToDeterministicProtobufBinary(&first_hashes);
+  EXPECT_TRUE(binary == second.ToDeterministicProtobufBinary(&second_hashes));
+  EXPECT_FALSE(binary == third.ToDeterministicProtobufBinary(&third_hashes));
+
+  // the same bytes as protobuf's deterministic serialization
+  std::string data;
+  {
+    google::protobuf::io::StringOutputStream stream(&data);
+    google::protobuf::io::CodedOutputStream coded(&stream);
+    coded.SetSerializationDeterministic(true);
+    forward.GetData().SerializeToCodedStream(&coded);
+  }
+  Envelope envelope;
+  envelope.set_type("xviz/state_update");
+  envelope.mutable_data()->set_type_url(
+      "type.googleapis.com/xviz.v2.StateUpdate");
+  envelope.mutable_data()->set_value(data);
+  EXPECT_TRUE(binary == "\x50\x42\x45\x31" + envelope.SerializeAsString());
+
+  // sorted by stream id, the two time series of /speed combined
+  ASSERT_EQ(first_hashes.size(), 22);
+  EXPECT_EQ(first_hashes.front().stream_id, "/vehicle_pose");
+  EXPECT_EQ(first_hashes[1].stream_id, "/object/0");
+  EXPECT_EQ(first_hashes.back().stream_id, "/speed");
+  EXPECT_EQ(first_hashes, second_hashes);
+  ASSERT_EQ(third_hashes.size(), 22);
+  for (std::size_t i = 0; i < first_hashes.size(); i++) {
+    EXPECT_EQ(first_hashes[i].hash == third_hashes[i].hash,
+              first_hashes[i].stream_id != "/object/7")
+        << first_hashes[i].stream_id;
+  }
+
+  // the parallel writer gives the same bytes and hashes
+  ProtobufWriter writer(ParallelWriteOption{4, 1});
+  writer.SetDeterministic(true);
+  std::string parallel;
+  writer.Write(reversed.GetData(), {}, parallel);
+  EXPECT_TRUE(parallel == binary);
+  EXPECT_TRUE(std::ranges::equal(writer.StreamHashes(), second_hashes));
+}
+
+TEST_F(EncoderTest, MessageWithImageReferencesTest) {
+  Build();
+  StateUpdate materialized = builder_.GetData();
+  auto references = builder_.ImageReferences();
+  Message<StateUpdate> message(builder_.GetData(), references);
+  util::MaterializeImages(materialized, references);
+
+  Envelope envelope;
+  ASSERT_TRUE(envelope.ParseFromString(message.ToProtobufBinary().substr(4)));
+  StateUpdate parsed;
+  ASSERT_TRUE(envelope.data().UnpackTo(&parsed));
+  EXPECT_TRUE(google::protobuf::util::MessageDifferencer::Equals(
+      parsed, materialized));
+}
+
+TEST_F(EncoderTest, JsonMaterializedTest) {
+  Build();
+  StateUpdate materialized = builder_.GetData();
+  auto references = builder_.ImageReferences();
+  util::MaterializeImages(materialized, references);
+
+  // map order may differ between the copies, compare the parsed documents
+  google::protobuf::Struct json;
+  google::protobuf::Struct expected;
+  ASSERT_TRUE(google::protobuf::util::JsonStringToMessage(
+                  Message<StateUpdate>(builder_.GetData(), references)
+                      .ToJsonString(),
+                  &json)
+                  .ok());
+  ASSERT_TRUE(google::protobuf::util::JsonStringToMessage(
+                  Message<StateUpdate>(materialized).ToJsonString(), &expected)
+                  .ok());
+  EXPECT_TRUE(
+      google::protobuf::util::MessageDifferencer::Equals(json, expected));
+}
+
+TEST_F(EncoderTest, OutputChainReuseTest) {
+  SlicePool pool(16);
+  OutputChain chain(pool);
+  Build();
+  Message<StateUpdate> message(builder_.GetData(), builder_.ImageReferences());
+  message.ToProtobufBinary(chain);
+  auto first = chain.ToString();
+  EXPECT_EQ(pool.IdleSlices(), 0);
+
+  // the slices go back to the pool and are taken again for the next frame
+  chain.Clear();
+  EXPECT_EQ(chain.Size(), 0);
+  auto idle = pool.IdleSlices();
+  EXPECT_GT(idle, 0);
+  message.ToProtobufBinary(chain);
+  EXPECT_EQ(chain.ToString(), first);
+  EXPECT_LT(pool.IdleSlices(), idle);
+}
+
+TEST_F(EncoderTest, JsonOutputChainTest) {
+  Build();
+  auto& data = builder_.GetData();
+  auto references = builder_.ImageReferences();
+
+  SlicePool pool(256);
+  OutputChain chain(pool);
+  google::protobuf::util::JsonPrintOptions options;
+  options.preserve_proto_field_names = true;
+  WriteJsonEnvelope(data, references, chain, options);
+
+  util::MaterializeImages(data, references);
+  Envelope envelope;
+  envelope.set_type("xviz/state_update");
+  envelope.mutable_data()->PackFrom(data);
+  std::string expected;
+  ASSERT_TRUE(google::protobuf::util::MessageToJsonString(envelope, &expected,
+                                                          options)
+                  .ok());
+  EXPECT_GT(chain.IoVecs().size(), 1);
+  EXPECT_TRUE(chain.ToString() == expected);
+}
+
+#ifndef _WIN32
+TEST_F(EncoderTest, WritevTest) {
+  Build();
+  Message<StateUpdate> message(builder_.GetData(), builder_.ImageReferences());
+  OutputChain chain;
+  message.ToProtobufBinary(chain);
+
+  FILE* file = std::tmpfile();
+  ASSERT_NE(file, nullptr);
+  auto iovecs = chain.IoVecs();
+  auto written = ::writev(fileno(file), iovecs.data(),
+                          static_cast<int>(iovecs.size()));
+  EXPECT_EQ(written, static_cast<ssize_t>(chain.Size()));
+
+  std::string read_back(chain.Size(), '\0');
+  std::rewind(file);
+  EXPECT_EQ(std::fread(read_back.data(), 1, read_back.size(), file),
+            read_back.size());
+  std::fclose(file);
+  EXPECT_TRUE(read_back == message.ToProtobufBinary());
+}
+#endif
+
+TEST_F(EncoderTest, EncoderSteadyStateAllocationTest) {
+  Build();
+  const auto& data = builder_.GetData();
+  auto references = builder_.ImageReferences();
+  std::string expected;
+  WriteProtobufEnvelope(data, references, expected);
+
+  Encoder encoder;
+  SlicePool pool(4096);
+  OutputChain chain(pool);
+  std::vector<std::size_t> allocations;
+  std::vector<bool> identical;
+  for (int frame = 0; frame < 4; frame++) {
+    auto before = allocation_count.load();
+    auto binary = encoder.ToProtobufBinary(data, references);
+    chain.Clear();
+    encoder.ToProtobufBinary(data, references, chain);
+    allocations.push_back(allocation_count.load() - before);
+    identical.push_back(binary == expected && chain.Size() == expected.size());
+  }
+
+  EXPECT_GT(allocations[0], 0);
+  for (int frame = 0; frame < 4; frame++) {
+    EXPECT_TRUE(identical[frame]);
+    if (frame > 0) {
+      EXPECT_EQ(allocations[frame], 0) << "frame " << frame;
+    }
+  }
+  EXPECT_TRUE(chain.ToString() == expected);
+}
+
+TEST_F(EncoderTest, EncoderJsonTest) {
+  Build();
+  auto& data = builder_.GetData();
+  auto references = builder_.ImageReferences();
+  Encoder encoder;
+  std::string json(encoder.ToJsonString(data, references));
+  EXPECT_EQ(encoder.ToJsonString(data, references), json);
+
+  util::MaterializeImages(data, references);
+  Envelope envelope;
+  envelope.set_type("xviz/state_update");
+  envelope.mutable_data()->PackFrom(data);
+  google::protobuf::util::JsonPrintOptions options;
+  options.preserve_proto_field_names = true;
+  std::string expected;
+  ASSERT_TRUE(google::protobuf::util::MessageToJsonString(envelope, &expected,
+                                                          options)
+                  .ok());
+  EXPECT_TRUE(json == expected);
+}
+
+}  // namespace xviz::tests
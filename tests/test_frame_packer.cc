@@ -0,0 +1,168 @@
+/*
+ * Project: libxviz
+ * Description: C++ Implementation of XVIZ Protocol
+ * Author: Minjun Xu (mjxu96@outlook.com)
+ * -----
+ * MIT License
+ * Copyright (c) 2023 Minjun Xu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <xviz/xviz.h>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace xviz::tests {
+
+class FramePackerTest : public ::testing::Test {
+ public:
+  void SetUp() override {
+    option_.priorities = {{"/vehicle_pose", 2}, {"/speed", 1}};
+    option_.lod_groups = {{"/lidar/lod0", "/lidar/lod1", "/lidar/lod2"}};
+  }
+
+  void TearDown() override {}
+
+  Frame Build() {
+    std::vector<float> points(3 * 1000, 1.0f);
+    std::vector<PointDownsampleOption> levels{
+        PointDownsampleOption::Uniform(1), PointDownsampleOption::Uniform(4),
+        PointDownsampleOption::Uniform(16)};
+    // clang-format off
+    builder_
+      .Timestamp(1)
+      .Pose("/vehicle_pose")
+        .Position(1, 2, 3)
+      .Primitive("/camera")
+        .Image(ImageBuffer(image_))
+      .TimeSeries("/speed")
+        .Timestamp(1)
+        .Value(10.0);
+    // clang-format on
+    builder_.PointLOD({"/lidar/lod0", "/lidar/lod1", "/lidar/lod2"}, points,
+                      levels);
+    return builder_.Finish();
+  }
+
+  static std::size_t Size(const Frame& frame) {
+    std::size_t ret = frame.Data().ByteSizeLong();
+    for (const auto& image : frame.ImageReferences()) {
+      ret += image.buffer.Size();
+    }
+    return ret;
+  }
+
+  static std::size_t StreamSize(const Frame& frame, std::string stream_id) {
+    return frame.Data().updates(0).primitives().at(stream_id).ByteSizeLong();
+  }
+
+  static std::vector<std::string> Names(
+      const std::vector<PackedStream>& streams) {
+    std::vector<std::string> ret;
+    for (const auto& stream : streams) {
+      ret.push_back(stream.stream_id);
+    }
+    std::ranges::sort(ret);
+    return ret;
+  }
+
+  Builder builder_;
+  PackOption option_;
+  std::shared_ptr<const std::string> image_ =
+      std::make_shared<const std::string>(20000, 'x');
+};
+
+TEST_F(FramePackerTest, KeepAllTest) {
+  FramePacker packer(option_);
+  auto frame = Build();
+  auto size = Size(frame);
+  auto report = packer.Pack(frame, size);
+  EXPECT_TRUE(report.dropped.empty());
+  // only the finest level of detail is sent even when all of them fit
+  EXPECT_EQ(Names(report.cleared),
+            (std::vector<std::string>{"/lidar/lod1", "/lidar/lod2"}));
+  const auto& primitives = frame.Data().updates(0).primitives();
+  EXPECT_EQ(primitives.at("/lidar/lod0").points_size(), 1);
+  EXPECT_EQ(primitives.at("/lidar/lod1").points_size(), 0);
+  EXPECT_EQ(primitives.at("/lidar/lod2").points_size(), 0);
+  EXPECT_EQ(frame.ImageReferences().size(), 1);
+  EXPECT_LE(Size(frame), report.bytes);
+  EXPECT_GE(Size(frame) + 4, report.bytes);
+}
+
+TEST_F(FramePackerTest, DropImageTest) {
+  FramePacker packer(option_);
+  auto reference = Build();
+  // short of the camera once the coarser levels are sent empty
+  auto budget = Size(reference) - StreamSize(reference, "/lidar/lod1") -
+                StreamSize(reference, "/lidar/lod2") - 100;
+
+  auto frame = Build();
+  auto report = packer.Pack(frame, budget);
+  EXPECT_EQ(Names(report.dropped), std::vector<std::string>{"/camera"});
+  ASSERT_EQ(report.dropped.size(), 1);
+  EXPECT_GT(report.dropped[0].bytes, image_->size());
+  EXPECT_EQ(Names(report.cleared),
+            (std::vector<std::string>{"/lidar/lod1", "/lidar/lod2"}));
+  EXPECT_TRUE(frame.ImageReferences().empty());
+  EXPECT_FALSE(frame.Data().updates(0).primitives().contains("/camera"));
+  EXPECT_LE(Size(frame), report.bytes);
+  EXPECT_GE(Size(frame) + 4, report.bytes);
+}
+
+TEST_F(FramePackerTest, LowerDetailTest) {
+  FramePacker packer(option_);
+  auto reference = Build();
+  // room for the second level but not the first
+  auto budget = Size(reference) - image_->size() -
+                StreamSize(reference, "/lidar/lod0") - 100;
+
+  auto frame = Build();
+  auto report = packer.Pack(frame, budget);
+  EXPECT_EQ(Names(report.dropped), std::vector<std::string>{"/camera"});
+  EXPECT_EQ(Names(report.cleared),
+            (std::vector<std::string>{"/lidar/lod0", "/lidar/lod2"}));
+  const auto& primitives = frame.Data().updates(0).primitives();
+  EXPECT_EQ(primitives.at("/lidar/lod0").points_size(), 0);
+  EXPECT_EQ(primitives.at("/lidar/lod1").points_size(), 1);
+  EXPECT_EQ(primitives.at("/lidar/lod2").points_size(), 0);
+  EXPECT_LE(Size(frame), budget);
+}
+
+TEST_F(FramePackerTest, TimeSeriesOnlyTest) {
+  FramePacker packer(option_);
+  auto frame = Build();
+  auto report = packer.Pack(frame, 120);
+  EXPECT_EQ(Names(report.dropped),
+            (std::vector<std::string>{"/camera", "/lidar/lod0", "/lidar/lod1",
+                                      "/lidar/lod2"}));
+  const auto& update = frame.Data().updates(0);
+  EXPECT_TRUE(update.primitives().empty());
+  EXPECT_EQ(update.poses_size(), 1);
+  EXPECT_EQ(update.time_series_size(), 1);
+  EXPECT_LE(Size(frame), 120);
+}
+
+}  // namespace xviz::tests
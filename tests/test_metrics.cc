@@ -0,0 +1,136 @@
+/*
+ * Project: libxviz
+ * Description: C++ Implementation of XVIZ Protocol
+ * Author: Minjun Xu (mjxu96@outlook.com)
+ * -----
+ * MIT License
+ * Copyright (c) 2023 Minjun Xu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <xviz/xviz.h>
+#include "utils/cleanup.h"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+
+namespace xviz::tests {
+
+class MetricsTest : public ::testing::Test {
+ public:
+  void SetUp() override { Metrics::Global().Reset(); }
+
+  void TearDown() override { Metrics::Global().Reset(); }
+
+  xviz::Builder builder_;
+};
+
+TEST_F(MetricsTest, PrometheusTest) {
+  auto& metrics = Metrics::Global();
+  metrics.RecordStreamBuild("/object/shape", 3, 2000000000);
+  metrics.RecordStreamBuild("/object/shape", 2, 500000000);
+  metrics.RecordStreamEncode("/object/\"shape\"", 100);
+  metrics.RecordMessage(MessageFormat::PROTOBUF, 120, 1000000);
+
+  auto snapshot = metrics.Snapshot();
+  ASSERT_EQ(snapshot.streams.size(), 2);
+  EXPECT_EQ(snapshot.streams.at("/object/shape").primitives, 5);
+  EXPECT_EQ(snapshot.streams.at("/object/shape").build_ns, 2500000000);
+  EXPECT_EQ(snapshot.protobuf.messages, 1);
+  EXPECT_EQ(snapshot.json.messages, 0);
+
+  auto text = snapshot.ToPrometheus();
+  EXPECT_NE(text.find("# TYPE xviz_stream_primitives_total counter\n"),
+            std::string::npos);
+  EXPECT_NE(
+      text.find("xviz_stream_primitives_total{stream=\"/object/shape\"} 5\n"),
+      std::string::npos);
+  EXPECT_NE(text.find("xviz_stream_build_seconds_total{stream=\"/object/"
+                      "shape\"} 2.5\n"),
+            std::string::npos);
+  EXPECT_NE(text.find("xviz_stream_bytes_total{stream=\"/object/\\\"shape\\\""
+                      "\"} 100\n"),
+            std::string::npos);
+  EXPECT_NE(text.find("xviz_message_bytes_total{format=\"protobuf\"} 120\n"),
+            std::string::npos);
+  EXPECT_EQ(text.find("# EOF"), std::string::npos);
+
+  auto open_metrics = snapshot.ToPrometheus(true);
+  EXPECT_NE(open_metrics.find("# TYPE xviz_stream_primitives counter\n"),
+            std::string::npos);
+  EXPECT_TRUE(open_metrics.ends_with("# EOF\n"));
+}
+
+TEST_F(MetricsTest, RecordTest) {
+  // clang-format off
+  builder_
+    .Primitive("/object/shape")
+      .Polygon({{0, 0, 0}, {1, 0, 0}, {1, 1, 0}})
+      .Polygon({{0, 0, 0}, {2, 0, 0}, {2, 2, 0}})
+    .TimeSeries("/vehicle/speed")
+      .Timestamp(1)
+      .Value(1.0);
+  // clang-format on
+  Message<StateUpdate> message(builder_.GetData());
+  auto binary = message.ToProtobufBinary();
+  // recorded once per frame
+  builder_.GetData();
+
+  auto snapshot = Metrics::Global().Snapshot();
+  if constexpr (!kMetricsEnabled) {
+    EXPECT_TRUE(snapshot.streams.empty());
+    EXPECT_EQ(snapshot.protobuf.messages, 0);
+    return;
+  }
+  ASSERT_EQ(snapshot.streams.size(), 2);
+  const auto& shape = snapshot.streams.at("/object/shape");
+  EXPECT_EQ(shape.primitives, 2);
+  EXPECT_GT(shape.bytes, 0);
+  EXPECT_EQ(snapshot.streams.at("/vehicle/speed").primitives, 1);
+  EXPECT_EQ(snapshot.protobuf.messages, 1);
+  EXPECT_EQ(snapshot.protobuf.bytes, binary.size());
+  EXPECT_LT(shape.bytes + snapshot.streams.at("/vehicle/speed").bytes,
+            binary.size());
+}
+
+TEST_F(MetricsTest, StreamBytesTest) {
+  auto image = std::make_shared<const std::string>(4096, 'x');
+  builder_.Primitive("/camera").Image(ImageBuffer(image));
+  auto& data = builder_.GetData();
+  (*data.mutable_updates(0)->mutable_links())["/object/shape"]
+      .set_target_pose("/vehicle_pose");
+  Encoder encoder;
+  auto binary = encoder.ToProtobufBinary(data, builder_.ImageReferences());
+  EXPECT_GT(binary.size(), image->size());
+
+  auto snapshot = Metrics::Global().Snapshot();
+  if constexpr (!kMetricsEnabled) {
+    EXPECT_TRUE(snapshot.streams.empty());
+    return;
+  }
+  // the image is held by reference and spliced in by the encoder
+  EXPECT_GE(snapshot.streams.at("/camera").bytes, image->size());
+  EXPECT_EQ(snapshot.streams.at("/object/shape").bytes,
+            data.updates(0).links().at("/object/shape").ByteSizeLong());
+}
+
+}  // namespace xviz::tests
@@ -0,0 +1,106 @@
+/*
+ * Project: libxviz
+ * Description: C++ Implementation of XVIZ Protocol
+ * Author: Minjun Xu (mjxu96@outlook.com)
+ * -----
+ * MIT License
+ * Copyright (c) 2023 Minjun Xu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <xviz/xviz.h>
+#include <xviz/utils/object_index.h>
+
+#include <gtest/gtest.h>
+
+#include <string_view>
+#include <vector>
+
+namespace xviz::tests {
+
+class ObjectIndexTest : public ::testing::Test {
+ public:
+  void SetUp() override {}
+
+  void TearDown() override {}
+};
+
+TEST_F(ObjectIndexTest, LifetimeTest) {
+  ObjectIndex index;
+  Builder builder;
+  for (uint64_t frame = 0; frame < 10; frame++) {
+    builder.Timestamp(double(frame));
+    if (frame <= 3 || frame >= 7) {
+      builder.Primitive("/object/shape")
+          .Polygon({{1, 2, 3}, {4, 5, 6}, {7, 8, 9}})
+          .ID("track-1");
+    }
+    builder.Primitive("/object/other").Circle({0, 0, 0}, 1).ID("track-2");
+    if (frame == 5) {
+      builder.TimeSeries("/object/speed").Timestamp(5).Value(1.0).ID(
+          "track-3");
+    }
+    auto data = builder.Finish();
+    if (frame == 8) {
+      auto& variables =
+          (*data.MutableData().mutable_updates(0)->mutable_variables())
+              ["/object/variables"];
+      variables.add_variables()->mutable_base()->set_object_id("track-1");
+    }
+    index.Record(frame, data.Data());
+  }
+
+  EXPECT_EQ(index.ObjectCount(), 3);
+  EXPECT_EQ(index.Frames("track-1"),
+            (std::vector<FrameRange>{{0, 3}, {7, 9}}));
+  EXPECT_EQ(index.Frames("track-2"), (std::vector<FrameRange>{{0, 9}}));
+  EXPECT_EQ(index.Frames("track-3"), (std::vector<FrameRange>{{5, 5}}));
+  EXPECT_TRUE(index.Frames("track-4").empty());
+  EXPECT_EQ(index.Streams("track-1"),
+            (std::vector<std::string_view>{"/object/shape",
+                                           "/object/variables"}));
+  EXPECT_EQ(index.Streams("track-3"),
+            std::vector<std::string_view>{"/object/speed"});
+
+  EXPECT_THROW(index.Record(3, StateUpdate()), std::runtime_error);
+}
+
+TEST_F(ObjectIndexTest, CompressedTest) {
+  ObjectIndex index;
+  // a track seen for 10 frames out of every 20
+  for (uint64_t frame = 0; frame < 100000; frame++) {
+    StateUpdate update;
+    auto& primitive =
+        (*update.add_updates()->mutable_primitives())["/object/shape"];
+    primitive.add_circles()->mutable_base()->set_object_id(
+        frame % 20 < 10 ? "track-1" : "track-2");
+    index.Record(frame, update);
+    // a frame may be recorded in more than one call
+    index.Record(frame, update);
+  }
+  auto ranges = index.Frames("track-1");
+  ASSERT_EQ(ranges.size(), 5000);
+  EXPECT_EQ(ranges[1], (FrameRange{20, 29}));
+  EXPECT_EQ(ranges.back(), (FrameRange{99980, 99989}));
+  // two bytes per range instead of eight per frame
+  EXPECT_LE(index.PostingBytes(), 2 * 2 * 5000);
+}
+
+}  // namespace xviz::tests
@@ -0,0 +1,362 @@
+/*
+ * Project: libxviz
+ * Description: C++ Implementation of XVIZ Protocol
+ * Author: Minjun Xu (mjxu96@outlook.com)
+ * -----
+ * MIT License
+ * Copyright (c) 2023 Minjun Xu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <xviz/xviz.h>
+#include <xviz/utils/thread_pool.h>
+#include "utils/cleanup.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <future>
+#include <limits>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace xviz::tests {
+
+class PrimitiveBuilderTest : public ::testing::Test {
+ public:
+  // two points in every 1m voxel along x, and the color of a point is its
+  // index
+  void SetUp() override {
+    for (uint8_t i = 0; i < 10; i++) {
+      points_.insert(points_.end(), {0.25f + 0.5f * i, 0.5f, 0.5f});
+      colors_.insert(colors_.end(), {i, i, i, 255});
+    }
+  }
+
+  void TearDown() override {}
+
+  xviz::Builder builder_;
+  std::vector<float> points_;
+  std::vector<uint8_t> colors_;
+};
+
+TEST_F(PrimitiveBuilderTest, PointVoxelDownsampleTest) {
+  // clang-format off
+  auto& msg = builder_
+    .Primitive("/test/points")
+      .Point(points_)
+      .Color(colors_)
+      .Downsample(xviz::PointDownsampleOption::VoxelGrid(1.0f))
+    .GetData();
+  // clang-format on
+
+  const auto& point = msg.updates(0).primitives().at("/test/points").points(0);
+  ASSERT_EQ(point.points_size(), 5 * 3);
+  ASSERT_EQ(point.colors().size(), 5 * 4);
+  for (int i = 0; i < 5; i++) {
+    EXPECT_FLOAT_EQ(point.points(i * 3), 0.25f + 1.0f * i);
+    EXPECT_EQ(static_cast<uint8_t>(point.colors()[i * 4]), i * 2);
+  }
+}
+
+TEST_F(PrimitiveBuilderTest, PointColorAfterDownsampleTest) {
+  // clang-format off
+  auto& msg = builder_
+    .Primitive("/test/points")
+      .Point(points_)
+      .Downsample(xviz::PointDownsampleOption::Uniform(3))
+      .Downsample(xviz::PointDownsampleOption::Uniform(2))
+      .Color(colors_)
+    .GetData();
+  // clang-format on
+
+  // 0, 3, 6, 9 and then 0, 6
+  const auto& point = msg.updates(0).primitives().at("/test/points").points(0);
+  ASSERT_EQ(point.points_size(), 2 * 3);
+  ASSERT_EQ(point.colors().size(), 2 * 4);
+  EXPECT_EQ(static_cast<uint8_t>(point.colors()[0]), 0);
+  EXPECT_EQ(static_cast<uint8_t>(point.colors()[4]), 6);
+}
+
+TEST_F(PrimitiveBuilderTest, PointLODTest) {
+  std::vector<xviz::PointDownsampleOption> levels = {
+      xviz::PointDownsampleOption::Uniform(1),
+      xviz::PointDownsampleOption::VoxelGrid(1.0f),
+      xviz::PointDownsampleOption::VoxelGrid(10.0f)};
+  auto& msg = builder_
+                  .PointLOD({"/lidar/lod0", "/lidar/lod1", "/lidar/lod2"},
+                            points_, levels, colors_)
+                  .GetData();
+
+  const auto& primitives = msg.updates(0).primitives();
+  ASSERT_EQ(primitives.size(), 3);
+  EXPECT_EQ(primitives.at("/lidar/lod0").points(0).points_size(), 10 * 3);
+  EXPECT_EQ(primitives.at("/lidar/lod1").points(0).points_size(), 5 * 3);
+  EXPECT_EQ(primitives.at("/lidar/lod2").points(0).points_size(), 1 * 3);
+  EXPECT_EQ(primitives.at("/lidar/lod1").points(0).colors().size(), 5 * 4);
+}
+
+TEST_F(PrimitiveBuilderTest, PointVoxelOutOfRangeTest) {
+  // far out points share the outermost cell, non-finite ones are dropped
+  float inf = std::numeric_limits<float>::infinity();
+  std::vector<float> points{1e30f, 0, 0, -1e30f, 0, 0, std::nanf(""), 0, 0,
+                            0, inf, 0, 0, 0, 0, 3e9f, 0, 0, 0, 0, -inf};
+  auto kept = util::DownsamplePoints(
+      points, xviz::PointDownsampleOption::VoxelGrid(1.0f));
+  EXPECT_EQ(kept, (std::vector<uint32_t>{0, 1, 4}));
+}
+
+TEST_F(PrimitiveBuilderTest, PointDownsampleChunkedTest) {
+  // enough points to be split across several chunks, voxels shared by
+  // neighbouring chunks must only be kept once
+  std::vector<float> points;
+  for (int i = 0; i < 300000; i++) {
+    points.insert(points.end(), {float(i % 1000) * 0.01f, 0.0f, 0.0f});
+  }
+  auto single = util::DownsamplePoints(
+      points, xviz::PointDownsampleOption::VoxelGrid(0.5f), 1);
+  auto chunked = util::DownsamplePoints(
+      points, xviz::PointDownsampleOption::VoxelGrid(0.5f), 4);
+  EXPECT_EQ(single.size(), 20);
+  EXPECT_EQ(single, chunked);
+}
+
+TEST_F(PrimitiveBuilderTest, PointDownsampleNonFiniteTest) {
+  float inf = std::numeric_limits<float>::infinity();
+  std::vector<float> points{0, 0, 0, std::nanf(""), 0, 0, 5, 0, 0,
+                            0, inf, 0, 10, 0, 0, 0, 0, -inf};
+  std::vector<xviz::PointDownsampleOption> levels = {
+      xviz::PointDownsampleOption::VoxelGrid(1.0f),
+      xviz::PointDownsampleOption::Uniform(1),
+      xviz::PointDownsampleOption::Random(1.0f),
+      xviz::PointDownsampleOption::DistanceWeighted(1.0f, 1.0f)};
+  // every method drops the same points
+  for (const auto& kept : util::DownsamplePoints(points, levels)) {
+    EXPECT_EQ(kept, (std::vector<uint32_t>{0, 2, 4}));
+  }
+}
+
+TEST_F(PrimitiveBuilderTest, PointDownsampleOnPoolTest) {
+  std::vector<float> points;
+  for (int i = 0; i < 300000; i++) {
+    points.insert(points.end(), {float(i % 1000) * 0.01f, 0.0f, 0.0f});
+  }
+  // every worker of the shared pool splits its own call across the pool
+  auto& pool = util::ThreadPool::Shared();
+  std::vector<std::future<std::size_t>> results;
+  for (std::size_t i = 0; i < pool.Size() + 1; i++) {
+    results.push_back(pool.Submit([&points]() {
+      return util::DownsamplePoints(
+                 points, xviz::PointDownsampleOption::VoxelGrid(0.5f), 4)
+          .size();
+    }));
+  }
+  for (auto& result : results) {
+    EXPECT_EQ(result.get(), 20);
+  }
+}
+
+// records the size of the frames it is given instead of compressing them
+class SizeEncoder : public xviz::ImageEncoder {
+ public:
+  explicit SizeEncoder(std::atomic<int>& created) { created++; }
+
+  void Encode(const xviz::RawImage& image, const xviz::ImageEncodeOption&,
+              std::string& output) override {
+    output = std::to_string(image.width) + "x" + std::to_string(image.height) +
+             ":" + std::to_string(image.pixels[0]);
+  }
+};
+
+TEST_F(PrimitiveBuilderTest, RawImageEncodeTest) {
+  std::vector<uint8_t> pixels(4 * 2 * 3, 200);
+  xviz::RawImage image{pixels, 4, 2, xviz::PixelFormat::RGB8};
+
+  // clang-format off
+  auto& msg = builder_
+    .Primitive("/camera/front")
+      .Image(image)
+    .GetData();
+  // clang-format on
+
+  const auto& encoded = msg.updates(0).primitives().at("/camera/front");
+  ASSERT_EQ(encoded.images_size(), 1);
+  EXPECT_EQ(encoded.images(0).width_px(), 4);
+  EXPECT_EQ(encoded.images(0).height_px(), 2);
+  const auto& data = encoded.images(0).data();
+  ASSERT_GT(data.size(), 8 + 25 + 12);
+  EXPECT_EQ(data.substr(0, 8), std::string("\x89PNG\r\n\x1a\n", 8));
+  EXPECT_EQ(data.substr(12, 4), "IHDR");
+  EXPECT_EQ(data.substr(data.size() - 8, 4), "IEND");
+}
+
+TEST_F(PrimitiveBuilderTest, RawImageResizeAndContextTest) {
+  std::atomic<int> created = 0;
+  xviz::ImageEncoderPool pool(2, [&created]() {
+    return std::make_unique<SizeEncoder>(created);
+  });
+  builder_.ImageEncoders(pool);
+
+  std::vector<uint8_t> pixels(8 * 4, 0);
+  for (size_t i = 0; i < pixels.size(); i++) {
+    pixels[i] = (i % 8) < 2 && i < 16 ? 100 : 0;
+  }
+  xviz::RawImage image{pixels, 8, 4, xviz::PixelFormat::GRAY8};
+  xviz::ImageEncodeOption option;
+  option.width = 4;
+
+  for (int frame = 0; frame < 3; frame++) {
+    builder_.Reset();
+    // clang-format off
+    auto& msg = builder_
+      .Primitive("/camera/left")
+        .Image(image, option)
+      .Primitive("/camera/right")
+        .Image(image)
+      .GetData();
+    // clang-format on
+    const auto& left = msg.updates(0).primitives().at("/camera/left");
+    EXPECT_EQ(left.images(0).width_px(), 4);
+    EXPECT_EQ(left.images(0).height_px(), 2);
+    // the top left 2x2 block is averaged into one pixel
+    EXPECT_EQ(left.images(0).data(), "4x2:100");
+    const auto& right = msg.updates(0).primitives().at("/camera/right");
+    EXPECT_EQ(right.images(0).data(), "8x4:100");
+  }
+  // one encoder context per camera, reused across frames
+  EXPECT_EQ(created, 2);
+}
+
+// sleeps so that the encodes are still running when the builder goes away
+class SlowEncoder : public xviz::ImageEncoder {
+ public:
+  explicit SlowEncoder(std::atomic<int>& encoded) : encoded_(encoded) {}
+
+  void Encode(const xviz::RawImage& image, const xviz::ImageEncodeOption&,
+              std::string& output) override {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    output.assign(image.pixels.begin(), image.pixels.end());
+    encoded_++;
+  }
+
+ private:
+  std::atomic<int>& encoded_;
+};
+
+TEST_F(PrimitiveBuilderTest, RawImageDestroyBuilderTest) {
+  std::atomic<int> encoded = 0;
+  xviz::ImageEncoderPool pool(1, [&encoded]() {
+    return std::make_unique<SlowEncoder>(encoded);
+  });
+  {
+    std::vector<uint8_t> pixels(4 * 2 * 3, 200);
+    xviz::RawImage image{pixels, 4, 2, xviz::PixelFormat::RGB8};
+    xviz::Builder builder;
+    builder.ImageEncoders(pool);
+    // clang-format off
+    builder
+      .Primitive("/camera/left")
+        .Image(image)
+      .Primitive("/camera/right")
+        .Image(image);
+    // clang-format on
+    // the builder is destroyed before the pixels it was given
+  }
+  EXPECT_EQ(encoded, 2);
+}
+
+TEST_F(PrimitiveBuilderTest, RawImageTooSmallTest) {
+  std::vector<uint8_t> pixels(10);
+  xviz::RawImage image{pixels, 4, 4, xviz::PixelFormat::RGBA8};
+  EXPECT_THROW(builder_.Primitive("/camera").Image(image), std::runtime_error);
+}
+
+TEST_F(PrimitiveBuilderTest, RawImageEmptyTest) {
+  std::vector<uint8_t> pixels(16);
+  xviz::ImageEncodeOption option;
+  option.width = 2;
+  for (auto [width, height] : {std::pair<uint32_t, uint32_t>{0, 0},
+                               {0, 4},
+                               {4, 0}}) {
+    xviz::RawImage image{pixels, width, height, xviz::PixelFormat::GRAY8};
+    EXPECT_THROW(builder_.Primitive("/camera").Image(image, option),
+                 std::runtime_error);
+  }
+}
+
+TEST_F(PrimitiveBuilderTest, ImageDedupTest) {
+  builder_.DeduplicateImages();
+  auto shared = std::make_shared<const std::string>("rear");
+  std::vector<uint8_t> pixels(4 * 2 * 3, 200);
+  xviz::RawImage raw{pixels, 4, 2, xviz::PixelFormat::RGB8};
+  auto build = [&](std::string front) {
+    // clang-format off
+    builder_
+      .Primitive("/camera/front")
+        .Image(front)
+      .Primitive("/camera/rear")
+        .Image(xviz::ImageBuffer(shared))
+      .Primitive("/camera/raw")
+        .Image(raw)
+      .Primitive("/camera/labeled")
+        .Image(std::string("labeled"))
+        .Text("car");
+    // clang-format on
+    return builder_.Finish();
+  };
+  auto streams = [](const xviz::Frame& frame) {
+    std::vector<std::string> ret;
+    for (const auto& [stream_id, primitive] :
+         frame.Data().updates(0).primitives()) {
+      ret.push_back(stream_id);
+    }
+    std::ranges::sort(ret);
+    return ret;
+  };
+
+  auto first = build("front");
+  EXPECT_EQ(streams(first).size(), 4);
+  EXPECT_EQ(first.ImageReferences().size(), 1);
+
+  // only the stream with other primitives is sent again
+  auto second = build("front");
+  EXPECT_EQ(streams(second), std::vector<std::string>{"/camera/labeled"});
+  EXPECT_TRUE(second.ImageReferences().empty());
+
+  auto third = build("front moved");
+  EXPECT_EQ(streams(third),
+            (std::vector<std::string>{"/camera/front", "/camera/labeled"}));
+
+  pixels[0] = 100;
+  auto fourth = build("front moved");
+  EXPECT_EQ(streams(fourth),
+            (std::vector<std::string>{"/camera/labeled", "/camera/raw"}));
+
+  // a new receiver gets every image once
+  builder_.DeduplicateImages();
+  EXPECT_EQ(streams(build("front moved")).size(), 4);
+}
+
+}  // namespace xviz::tests
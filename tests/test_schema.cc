@@ -0,0 +1,154 @@
+/*
+ * Project: libxviz
+ * Description: C++ Implementation of XVIZ Protocol
+ * Author: Minjun Xu (mjxu96@outlook.com)
+ * -----
+ * MIT License
+ * Copyright (c) 2023 Minjun Xu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <xviz/xviz.h>
+#include "utils/cleanup.h"
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <concepts>
+#include <string>
+#include <utility>
+
+namespace xviz::tests {
+
+constexpr schema::Stream<"/vehicle_pose", schema::Pose> kPose;
+constexpr schema::Stream<"/object/shape", schema::Polygon> kShape;
+constexpr schema::Stream<"/object/label", schema::Text> kLabel;
+constexpr schema::Stream<"/vehicle/speed",
+                         schema::TimeSeries<StreamMetadata::FLOAT>>
+    kSpeed;
+
+template <typename T>
+concept CanBuildCircle = requires(T& builder) {
+  builder.Circle(std::array<float, 3>{}, 1.0f);
+};
+
+template <typename T>
+concept CanBuildPolygon = requires(T& builder) {
+  builder.Polygon(std::vector<std::array<float, 3>>{});
+};
+
+static_assert(CanBuildCircle<PrimitiveBuilder<Builder>>);
+static_assert(CanBuildPolygon<PrimitiveBuilder<Builder>>);
+static_assert(!CanBuildCircle<PrimitiveBuilder<Builder, schema::Polygon>>);
+static_assert(CanBuildPolygon<PrimitiveBuilder<Builder, schema::Polygon>>);
+static_assert(!CanBuildPolygon<PrimitiveBuilder<Builder, schema::Text>>);
+
+template <typename T, typename ValueT>
+concept CanSetValue = requires(T& builder, ValueT value) {
+  builder.Value(value);
+};
+
+using FloatTimeSeriesBuilder =
+    TimeSeriesBuilder<Builder, schema::TimeSeries<StreamMetadata::FLOAT>>;
+using StringTimeSeriesBuilder =
+    TimeSeriesBuilder<Builder, schema::TimeSeries<StreamMetadata::STRING>>;
+static_assert(CanSetValue<TimeSeriesBuilder<Builder>, double>);
+static_assert(CanSetValue<TimeSeriesBuilder<Builder>, const char*>);
+static_assert(CanSetValue<FloatTimeSeriesBuilder, double>);
+static_assert(!CanSetValue<FloatTimeSeriesBuilder, int32_t>);
+static_assert(!CanSetValue<FloatTimeSeriesBuilder, const char*>);
+static_assert(CanSetValue<StringTimeSeriesBuilder, const char*>);
+static_assert(CanSetValue<StringTimeSeriesBuilder, std::string>);
+static_assert(!CanSetValue<StringTimeSeriesBuilder, bool>);
+static_assert(
+    std::same_as<decltype(std::declval<Builder&>().TimeSeries(kSpeed)),
+                 FloatTimeSeriesBuilder&>);
+
+class SchemaTest : public ::testing::Test {
+ public:
+  void SetUp() override {}
+
+  void TearDown() override {}
+
+  xviz::Builder builder_;
+};
+
+TEST_F(SchemaTest, MetadataTest) {
+  xviz::MetadataBuilder meta_builder;
+  // clang-format off
+  const auto& metadata = meta_builder
+    .Stream(kPose)
+    .Stream(kShape)
+      .Coordinate(xviz::StreamMetadata::IDENTITY)
+    .Stream(kLabel)
+    .Stream(kSpeed)
+      .Unit("m/s")
+    .GetData();
+  // clang-format on
+
+  ASSERT_EQ(metadata.streams_size(), 4);
+  const auto& pose = metadata.streams().at("/vehicle_pose");
+  EXPECT_EQ(pose.category(), StreamMetadata::POSE);
+  const auto& shape = metadata.streams().at("/object/shape");
+  EXPECT_EQ(shape.category(), StreamMetadata::PRIMITIVE);
+  EXPECT_EQ(shape.primitive_type(), StreamMetadata::POLYGON);
+  EXPECT_EQ(shape.coordinate(), StreamMetadata::IDENTITY);
+  const auto& label = metadata.streams().at("/object/label");
+  EXPECT_EQ(label.primitive_type(), StreamMetadata::TEXT);
+  const auto& speed = metadata.streams().at("/vehicle/speed");
+  EXPECT_EQ(speed.category(), StreamMetadata::TIME_SERIES);
+  EXPECT_EQ(speed.scalar_type(), StreamMetadata::FLOAT);
+  EXPECT_EQ(speed.units(), "m/s");
+}
+
+TEST_F(SchemaTest, BuildTest) {
+  for (int frame = 0; frame < 2; frame++) {
+    // clang-format off
+    const auto& data = builder_
+      .Timestamp(frame)
+      .Pose(kPose)
+        .Position(frame, 0, 0)
+      .Primitive(kShape)
+        .Polygon({{0, 0, 0}, {1, 0, 0}, {1, 1, 0}})
+          .ID("1")
+        .Polygon({{0, 0, 0}, {2, 0, 0}, {2, 2, 0}})
+      .Primitive(kLabel)
+        .Text("car")
+      .TimeSeries(kSpeed)
+        .Timestamp(frame)
+        .Value(2.0)
+      .Primitive(kShape)
+        .Polygon({{0, 0, 0}, {3, 0, 0}, {3, 3, 0}})
+      .GetData();
+    // clang-format on
+
+    const auto& update = data.updates(0);
+    EXPECT_EQ(update.poses().at("/vehicle_pose").position(0), frame);
+    const auto& shape = update.primitives().at("/object/shape");
+    ASSERT_EQ(shape.polygons_size(), 3);
+    EXPECT_EQ(shape.polygons(0).base().object_id(), "1");
+    EXPECT_EQ(shape.polygons(2).vertices(3), 3);
+    EXPECT_EQ(update.primitives().at("/object/label").texts(0).text(), "car");
+    EXPECT_EQ(update.time_series(0).streams(0), "/vehicle/speed");
+    builder_.Reset();
+  }
+}
+
+}  // namespace xviz::tests
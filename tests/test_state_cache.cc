@@ -0,0 +1,179 @@
+/*
+ * Project: libxviz
+ * Description: C++ Implementation of XVIZ Protocol
+ * Author: Minjun Xu (mjxu96@outlook.com)
+ * -----
+ * MIT License
+ * Copyright (c) 2023 Minjun Xu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <xviz/xviz.h>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+
+namespace xviz::tests {
+
+class StateCacheTest : public ::testing::Test {
+ public:
+  void SetUp() override {}
+
+  void TearDown() override {}
+
+  std::shared_ptr<Frame> Publish(
+      StateUpdate::UpdateType type = StateUpdate::INCREMENTAL) {
+    auto frame = std::make_shared<Frame>(builder_.Finish());
+    frame->MutableData().set_update_type(type);
+    return frame;
+  }
+
+  Builder builder_;
+  StateCache cache_;
+};
+
+TEST_F(StateCacheTest, LatestStateTest) {
+  auto image = std::make_shared<const std::string>("image");
+  // clang-format off
+  builder_
+    .Timestamp(1)
+    .Primitive("/map")
+      .Polyline({{0, 0, 0}, {1, 1, 0}});
+  cache_.Update(Publish(StateUpdate::PERSISTENT));
+
+  builder_
+    .Timestamp(2)
+    .Pose("/vehicle_pose")
+      .Position(1, 0, 0)
+    .Primitive("/object/shape")
+      .Polygon({{1, 2, 3}, {4, 5, 6}, {7, 8, 9}})
+    .Primitive("/camera")
+      .Image(ImageBuffer(image))
+    .TimeSeries("/speed")
+      .Timestamp(2)
+      .Value(10.0);
+  cache_.Update(Publish());
+
+  builder_
+    .Timestamp(3)
+    .Pose("/vehicle_pose")
+      .Position(2, 0, 0);
+  // clang-format on
+  auto third = Publish();
+  third->MutableData().mutable_updates(0)->add_no_data_streams(
+      "/object/shape");
+  cache_.Update(third);
+  EXPECT_EQ(cache_.StreamCount(), 4);
+
+  auto snapshot = cache_.Snapshot();
+  const auto& data = snapshot.Data();
+  EXPECT_EQ(data.update_type(), StateUpdate::COMPLETE_STATE);
+  ASSERT_EQ(data.updates_size(), 1);
+  const auto& update = data.updates(0);
+  EXPECT_EQ(update.timestamp(), 3);
+  EXPECT_EQ(update.poses().at("/vehicle_pose").position(0), 2);
+  EXPECT_TRUE(update.primitives().contains("/map"));
+  EXPECT_TRUE(update.primitives().contains("/camera"));
+  EXPECT_FALSE(update.primitives().contains("/object/shape"));
+  ASSERT_EQ(update.time_series_size(), 1);
+  EXPECT_EQ(update.time_series(0).values().doubles(0), 10.0);
+  ASSERT_EQ(snapshot.ImageReferences().size(), 1);
+  EXPECT_EQ(snapshot.ImageReferences()[0].update_index, 0);
+  EXPECT_EQ(snapshot.ImageReferences()[0].stream_id, "/camera");
+  EXPECT_EQ(snapshot.ImageReferences()[0].buffer.View(), "image");
+}
+
+TEST_F(StateCacheTest, ExpiryTest) {
+  StateCache cache({2});
+  // clang-format off
+  builder_
+    .Timestamp(1)
+    .Primitive("/map")
+      .Polyline({{0, 0, 0}, {1, 1, 0}});
+  cache.Update(Publish(StateUpdate::PERSISTENT));
+  builder_
+    .Timestamp(1)
+    .Primitive("/object/shape")
+      .Polygon({{1, 2, 3}, {4, 5, 6}, {7, 8, 9}});
+  cache.Update(Publish());
+  builder_
+    .Timestamp(4)
+    .Pose("/vehicle_pose")
+      .Position(1, 0, 0);
+  cache.Update(Publish());
+  // clang-format on
+  EXPECT_EQ(cache.StreamCount(), 2);
+
+  // a complete state replaces everything but the persistent streams
+  builder_.Timestamp(5).Primitive("/object/other").Circle({0, 0, 0}, 1);
+  cache.Update(Publish(StateUpdate::COMPLETE_STATE));
+  auto snapshot = cache.Snapshot();
+  const auto& primitives = snapshot.Data().updates(0).primitives();
+  EXPECT_EQ(primitives.size(), 2);
+  EXPECT_TRUE(primitives.contains("/map"));
+  EXPECT_TRUE(primitives.contains("/object/other"));
+}
+
+TEST_F(StateCacheTest, ReleaseFrameTest) {
+  builder_.Timestamp(1).Primitive("/object/shape").Circle({0, 0, 0}, 1);
+  auto first = Publish();
+  std::weak_ptr<const Frame> released = first;
+  cache_.Update(std::move(first));
+  for (int frame = 2; frame < 4; frame++) {
+    builder_.Timestamp(frame).Primitive("/object/shape").Circle({0, 0, 0}, 2);
+    cache_.Update(Publish());
+    // the older version of the index holds it for one more update
+    EXPECT_EQ(released.expired(), frame == 3);
+  }
+  auto snapshot = cache_.Snapshot();
+  EXPECT_EQ(snapshot.Data().updates(0).primitives().at("/object/shape")
+                .circles(0).radius(),
+            2);
+}
+
+TEST_F(StateCacheTest, ConcurrentSnapshotTest) {
+  std::atomic<bool> done = false;
+  std::thread producer([this, &done]() {
+    for (int frame = 0; frame < 200; frame++) {
+      builder_.Timestamp(frame).Pose("/vehicle_pose").Position(frame, 0, 0);
+      builder_.Primitive("/object/" + std::to_string(frame % 10))
+          .Circle({0, 0, 0}, 1);
+      cache_.Update(Publish());
+    }
+    done = true;
+  });
+  while (!done) {
+    auto snapshot = cache_.Snapshot();
+    const auto& update = snapshot.Data().updates(0);
+    if (update.poses_size() > 0) {
+      EXPECT_EQ(update.poses().at("/vehicle_pose").position(0),
+                update.timestamp());
+    }
+  }
+  producer.join();
+  EXPECT_EQ(cache_.StreamCount(), 11);
+}
+
+}  // namespace xviz::tests
@@ -0,0 +1,157 @@
+/*
+ * Project: libxviz
+ * Description: C++ Implementation of XVIZ Protocol
+ * Author: Minjun Xu (mjxu96@outlook.com)
+ * -----
+ * MIT License
+ * Copyright (c) 2023 Minjun Xu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <xviz/xviz.h>
+#include "utils/cleanup.h"
+
+#include <google/protobuf/util/message_differencer.h>
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+
+namespace xviz::tests {
+
+class StreamRegistryTest : public ::testing::Test {
+ public:
+  void SetUp() override {
+    // clang-format off
+    meta_builder_
+      .Stream("/vehicle_pose")
+        .Category<xviz::StreamMetadata::POSE>()
+      .Stream("/object/shape")
+        .Category(xviz::StreamMetadata::PRIMITIVE)
+        .Type(xviz::StreamMetadata::POLYGON)
+      .Stream("/vehicle/speed")
+        .Category<xviz::StreamMetadata::TIME_SERIES>()
+          .Type(xviz::StreamMetadata::FLOAT);
+    // clang-format on
+    registry_ = StreamRegistry::FromMetadata(meta_builder_.GetData());
+    builder_.Streams(registry_);
+  }
+
+  void TearDown() override {}
+
+  xviz::MetadataBuilder meta_builder_;
+  xviz::StreamRegistry registry_;
+  xviz::Builder builder_;
+};
+
+TEST_F(StreamRegistryTest, RegisterTest) {
+  ASSERT_EQ(registry_.Size(), 3);
+  EXPECT_EQ(registry_.Name({0}), "/object/shape");
+  EXPECT_EQ(registry_.Name({1}), "/vehicle/speed");
+  EXPECT_EQ(registry_.Name({2}), "/vehicle_pose");
+
+  EXPECT_EQ(registry_.Register("/vehicle/speed"), StreamId{1});
+  EXPECT_EQ(registry_.Register("/camera"), StreamId{3});
+  EXPECT_EQ(registry_.Find("/camera"), StreamId{3});
+  EXPECT_FALSE(registry_.Find("/lidar").has_value());
+  EXPECT_THROW(registry_.Name({4}), std::runtime_error);
+}
+
+TEST_F(StreamRegistryTest, BuildByIdTest) {
+  auto pose = *registry_.Find("/vehicle_pose");
+  auto shape = *registry_.Find("/object/shape");
+  auto speed = *registry_.Find("/vehicle/speed");
+
+  xviz::Builder expected_builder;
+  for (int frame = 0; frame < 3; frame++) {
+    // clang-format off
+    const auto& data = builder_
+      .Timestamp(frame)
+      .Pose(pose)
+        .Timestamp(frame)
+        .Position(frame, 0, 0)
+      .Primitive(shape)
+        .Polygon({{0, 0, 0}, {1, 0, 0}, {1, 1, 0}})
+          .ID("1")
+      .TimeSeries(speed)
+        .Timestamp(frame)
+        .Value(1.0 * frame)
+      .Primitive(shape)
+        .Polygon({{0, 0, 0}, {2, 0, 0}, {2, 2, 0}})
+          .ID("2")
+      .GetData();
+    const auto& expected = expected_builder
+      .Timestamp(frame)
+      .Pose("/vehicle_pose")
+        .Timestamp(frame)
+        .Position(frame, 0, 0)
+      .Primitive("/object/shape")
+        .Polygon({{0, 0, 0}, {1, 0, 0}, {1, 1, 0}})
+          .ID("1")
+      .TimeSeries("/vehicle/speed")
+        .Timestamp(frame)
+        .Value(1.0 * frame)
+      .Primitive("/object/shape")
+        .Polygon({{0, 0, 0}, {2, 0, 0}, {2, 2, 0}})
+          .ID("2")
+      .GetData();
+    // clang-format on
+    EXPECT_TRUE(
+        google::protobuf::util::MessageDifferencer::Equals(data, expected));
+    builder_.Reset();
+    expected_builder.Reset();
+  }
+}
+
+TEST_F(StreamRegistryTest, BuildByIdAndNameTest) {
+  auto shape = *registry_.Find("/object/shape");
+  auto image = std::make_shared<const std::string>("image");
+
+  // clang-format off
+  builder_
+    .Primitive("/object/shape")
+      .Polygon({{0, 0, 0}, {1, 0, 0}, {1, 1, 0}})
+    .Primitive(shape)
+      .Polygon({{0, 0, 0}, {2, 0, 0}, {2, 2, 0}})
+      .Image(ImageBuffer(image));
+  // clang-format on
+  const auto& data = builder_.GetData();
+  const auto& primitive = data.updates(0).primitives().at("/object/shape");
+  EXPECT_EQ(primitive.polygons_size(), 2);
+
+  // built again after GetData()
+  builder_.Primitive(shape).Polygon({{0, 0, 0}, {3, 0, 0}, {3, 3, 0}});
+  builder_.GetData();
+  EXPECT_EQ(primitive.polygons_size(), 3);
+  EXPECT_EQ(primitive.polygons(2).vertices(3), 3);
+
+  auto references = builder_.ImageReferences();
+  ASSERT_EQ(references.size(), 1);
+  EXPECT_EQ(references[0].stream_id, "/object/shape");
+  EXPECT_EQ(references[0].image_index, 0);
+}
+
+TEST_F(StreamRegistryTest, NotRegisteredTest) {
+  EXPECT_THROW(builder_.Primitive(StreamId{3}), std::runtime_error);
+  xviz::Builder builder;
+  EXPECT_THROW(builder.Pose(StreamId{0}), std::runtime_error);
+}
+
+}  // namespace xviz::tests
@@ -0,0 +1,151 @@
+/*
+ * Project: libxviz
+ * Description: C++ Implementation of XVIZ Protocol
+ * Author: Minjun Xu (mjxu96@outlook.com)
+ * -----
+ * MIT License
+ * Copyright (c) 2023 Minjun Xu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <xviz/xviz.h>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace xviz::tests {
+
+class StreamSchedulerTest : public ::testing::Test {
+ public:
+  void SetUp() override {}
+
+  void TearDown() override {}
+
+  static std::vector<std::string> Streams(const Frame& frame) {
+    std::vector<std::string> ret;
+    const auto& update = frame.Data().updates(0);
+    for (const auto& [stream_id, pose] : update.poses()) {
+      ret.push_back(stream_id);
+    }
+    for (const auto& [stream_id, primitive] : update.primitives()) {
+      ret.push_back(stream_id);
+    }
+    std::ranges::sort(ret);
+    return ret;
+  }
+
+  static StreamScheduler::Producer Pose() {
+    return [](Builder& builder) {
+      builder.Pose("/vehicle_pose").Position(1, 2, 3);
+    };
+  }
+
+  static StreamScheduler::Producer Shape(std::string stream_id) {
+    return [stream_id](Builder& builder) {
+      builder.Primitive(stream_id).Polygon({{1, 2, 3}, {4, 5, 6}, {7, 8, 9}});
+    };
+  }
+};
+
+TEST_F(StreamSchedulerTest, RateTest) {
+  StreamScheduler scheduler;
+  scheduler.Add("pose", Pose(), {64, 2})
+      .Add("tracking", Shape("/object/tracking"), {8, 1})
+      .Add("map", Shape("/map"), {0.5, 0});
+  EXPECT_EQ(scheduler.NextDue(), -std::numeric_limits<double>::infinity());
+
+  // one tick per pose deadline for a second
+  for (int tick = 0; tick <= 64; tick++) {
+    auto frame = scheduler.Tick(tick / 64.0);
+    ASSERT_FALSE(frame.Empty());
+    EXPECT_EQ(frame.Data().update_type(), StateUpdate::INCREMENTAL);
+    EXPECT_EQ(frame.Data().updates(0).timestamp(), tick / 64.0);
+    if (tick == 0) {
+      EXPECT_EQ(Streams(frame), (std::vector<std::string>{
+                                    "/map", "/object/tracking",
+                                    "/vehicle_pose"}));
+    } else if (tick % 8 == 0) {
+      EXPECT_EQ(Streams(frame), (std::vector<std::string>{
+                                    "/object/tracking", "/vehicle_pose"}));
+    } else {
+      EXPECT_EQ(Streams(frame), std::vector<std::string>{"/vehicle_pose"});
+    }
+  }
+  EXPECT_EQ(scheduler.NextDue(), 65 / 64.0);
+
+  auto stats = scheduler.Stats();
+  ASSERT_EQ(stats.size(), 3);
+  EXPECT_EQ(stats[0].name, "pose");
+  EXPECT_EQ(stats[0].builds, 65);
+  EXPECT_EQ(stats[1].builds, 9);
+  EXPECT_EQ(stats[2].builds, 1);
+  for (const auto& stream : stats) {
+    EXPECT_EQ(stream.misses, 0);
+    EXPECT_EQ(stream.max_lateness, 0);
+  }
+}
+
+TEST_F(StreamSchedulerTest, MissTest) {
+  StreamScheduler scheduler;
+  scheduler.Add("tracking", Shape("/object/tracking"), {8});
+  EXPECT_FALSE(scheduler.Tick(0).Empty());
+  EXPECT_TRUE(scheduler.Tick(0.0625).Empty());
+
+  // the deadlines at 0.125, 0.25 and 0.375 passed without a tick, the one
+  // at 0.5 is built late
+  EXPECT_FALSE(scheduler.Tick(0.5625).Empty());
+  EXPECT_EQ(scheduler.NextDue(), 0.625);
+  EXPECT_FALSE(scheduler.Tick(0.625).Empty());
+
+  auto stats = scheduler.Stats();
+  EXPECT_EQ(stats[0].builds, 3);
+  EXPECT_EQ(stats[0].misses, 3);
+  EXPECT_EQ(stats[0].max_lateness, 0.0625);
+
+  EXPECT_THROW(scheduler.Add("tracking", Shape("/other"), {1}),
+               std::runtime_error);
+  EXPECT_THROW(scheduler.Add("stopped", Shape("/other"), {0}),
+               std::runtime_error);
+}
+
+TEST_F(StreamSchedulerTest, BudgetTest) {
+  // every tick runs out of budget after its first producer
+  StreamScheduler scheduler({1e-9});
+  scheduler.Add("map", Shape("/map"), {1, 0})
+      .Add("pose", Pose(), {1, 1});
+
+  auto first = scheduler.Tick(0);
+  EXPECT_EQ(Streams(first), std::vector<std::string>{"/vehicle_pose"});
+  auto second = scheduler.Tick(0.5);
+  EXPECT_EQ(Streams(second), std::vector<std::string>{"/map"});
+
+  auto stats = scheduler.Stats();
+  EXPECT_EQ(stats[0].deferrals, 1);
+  EXPECT_EQ(stats[0].max_lateness, 0);
+  EXPECT_EQ(stats[1].deferrals, 0);
+  // the pose is due a second after its build, the map after its late one
+  EXPECT_EQ(scheduler.NextDue(), 1.0);
+}
+
+}  // namespace xviz::tests
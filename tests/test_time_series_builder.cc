@@ -0,0 +1,211 @@
+/*
+ * Project: libxviz
+ * Description: C++ Implementation of XVIZ Protocol
+ * Author: Minjun Xu (mjxu96@outlook.com)
+ * -----
+ * MIT License
+ * Copyright (c) 2023 Minjun Xu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <xviz/utils/time_series_accumulator.h>
+#include <xviz/xviz.h>
+#include "utils/cleanup.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace xviz::tests {
+
+class TimeSeriesBuilderTest : public ::testing::Test {
+ public:
+  void SetUp() override {}
+
+  void TearDown() override {}
+
+  xviz::Builder builder_;
+};
+
+TEST_F(TimeSeriesBuilderTest, BatchSameTimestampTest) {
+  std::vector<std::string> stream_ids;
+  std::vector<xviz::TimeSeriesSample> samples;
+  for (int i = 0; i < 300; i++) {
+    stream_ids.push_back("/can/signal/" + std::to_string(i));
+  }
+  for (int i = 0; i < 300; i++) {
+    samples.push_back({stream_ids[i], double(i), 1000});
+  }
+
+  auto& msg = builder_.TimeSeriesBatch(samples).GetData();
+
+  ASSERT_EQ(msg.updates(0).time_series_size(), 1);
+  const auto& state = msg.updates(0).time_series(0);
+  EXPECT_EQ(state.timestamp(), 1000);
+  ASSERT_EQ(state.streams_size(), 300);
+  ASSERT_EQ(state.values().doubles_size(), 300);
+  EXPECT_EQ(state.streams(42), "/can/signal/42");
+  EXPECT_EQ(state.values().doubles(42), 42.0);
+}
+
+TEST_F(TimeSeriesBuilderTest, BatchGroupingTest) {
+  std::vector<xviz::TimeSeriesSample> samples = {
+      {"/a", 1.0, 1000},
+      {"/b", int32_t(2), 1000},
+      {"/c", 3.0, 1000, "object-1"},
+      {"/d", 4.0, 1001},
+      {"/e", "five", 1000},
+      {"/f", 6.0, 1000},
+  };
+
+  // clang-format off
+  auto& msg = builder_
+    .TimeSeries("/single")
+      .Timestamp(1000)
+      .Value(true)
+    .TimeSeriesBatch(samples)
+    .GetData();
+  // clang-format on
+
+  const auto& time_series = msg.updates(0).time_series();
+  ASSERT_EQ(time_series.size(), 6);
+  EXPECT_EQ(time_series[0].streams(0), "/single");
+
+  EXPECT_EQ(time_series[1].streams_size(), 2);
+  EXPECT_EQ(time_series[1].streams(1), "/f");
+  EXPECT_EQ(time_series[1].values().doubles(1), 6.0);
+
+  EXPECT_EQ(time_series[2].values().int32s(0), 2);
+  EXPECT_EQ(time_series[3].object_id(), "object-1");
+  EXPECT_EQ(time_series[4].timestamp(), 1001);
+  EXPECT_EQ(time_series[5].values().strings(0), "five");
+}
+
+TEST_F(TimeSeriesBuilderTest, AccumulatorReductionTest) {
+  xviz::TimeSeriesAccumulator accumulator;
+  auto last = accumulator.Register("/last");
+  auto min = accumulator.Register("/min", xviz::TimeSeriesAccumulator::MIN);
+  auto max = accumulator.Register("/max", xviz::TimeSeriesAccumulator::MAX);
+  auto mean = accumulator.Register("/mean", xviz::TimeSeriesAccumulator::MEAN);
+  std::vector<double> values = {3, 1, 4, 1, 5, 9, 2, 6};
+  for (size_t i = 0; i < values.size(); i++) {
+    for (auto handle : {last, min, max, mean}) {
+      ASSERT_TRUE(accumulator.Push(handle, 100 + double(i), values[i]));
+    }
+  }
+
+  auto samples = accumulator.Collect();
+  ASSERT_EQ(samples.size(), 4);
+  EXPECT_EQ(std::get<double>(samples[0].value), 6);
+  EXPECT_EQ(samples[0].timestamp, 107);
+  EXPECT_EQ(std::get<double>(samples[1].value), 1);
+  EXPECT_EQ(samples[1].timestamp, 101);
+  EXPECT_EQ(std::get<double>(samples[2].value), 9);
+  EXPECT_EQ(samples[2].timestamp, 105);
+  EXPECT_EQ(std::get<double>(samples[3].value), 31.0 / 8);
+
+  // everything was consumed by the previous flush
+  EXPECT_TRUE(accumulator.Collect().empty());
+
+  accumulator.Push(last, 200, 42);
+  accumulator.Flush(builder_);
+  const auto& msg = builder_.GetData();
+  ASSERT_EQ(msg.updates(0).time_series_size(), 1);
+  EXPECT_EQ(msg.updates(0).time_series(0).streams(0), "/last");
+  EXPECT_EQ(msg.updates(0).time_series(0).values().doubles(0), 42);
+}
+
+TEST_F(TimeSeriesBuilderTest, AccumulatorCapacityTest) {
+  xviz::TimeSeriesAccumulator accumulator;
+  xviz::TimeSeriesAccumulator::StreamOption option;
+  option.capacity = 5;
+  auto handle = accumulator.Register("/full", option);
+  for (int i = 0; i < 10; i++) {
+    accumulator.Push(handle, i, i);
+  }
+  // rounded up to 8
+  EXPECT_EQ(accumulator.Dropped(handle), 2);
+  auto samples = accumulator.Collect();
+  ASSERT_EQ(samples.size(), 1);
+  EXPECT_EQ(std::get<double>(samples[0].value), 7);
+  EXPECT_TRUE(accumulator.Push(handle, 10, 10));
+}
+
+TEST_F(TimeSeriesBuilderTest, AccumulatorConcurrentPushTest) {
+  constexpr int kThreads = 4;
+  constexpr int kSamples = 20000;
+  xviz::TimeSeriesAccumulator accumulator;
+  xviz::TimeSeriesAccumulator::StreamOption option;
+  option.reduction = xviz::TimeSeriesAccumulator::MAX;
+  option.capacity = 256;
+  auto handle = accumulator.Register("/imu", option);
+
+  std::atomic<int> finished = 0;
+  std::vector<std::thread> producers;
+  for (int t = 0; t < kThreads; t++) {
+    producers.emplace_back([&accumulator, &finished, handle, t]() {
+      for (int i = 0; i < kSamples; i++) {
+        while (!accumulator.Push(handle, i, t * kSamples + i)) {
+          std::this_thread::yield();
+        }
+      }
+      finished++;
+    });
+  }
+  double max = -1;
+  while (true) {
+    bool done = finished == kThreads;
+    auto samples = accumulator.Collect();
+    if (!samples.empty()) {
+      max = std::max(max, std::get<double>(samples[0].value));
+    }
+    if (done) {
+      break;
+    }
+  }
+  for (auto& producer : producers) {
+    producer.join();
+  }
+  EXPECT_EQ(max, kThreads * kSamples - 1);
+}
+
+TEST_F(TimeSeriesBuilderTest, LargestTriangleThreeBucketsTest) {
+  std::vector<double> x;
+  std::vector<double> y;
+  for (int i = 0; i < 100; i++) {
+    x.push_back(i);
+    y.push_back(i == 42 ? 100 : 0);
+  }
+  auto indices = xviz::util::LargestTriangleThreeBuckets(x, y, 10);
+  ASSERT_EQ(indices.size(), 10);
+  EXPECT_EQ(indices.front(), 0);
+  EXPECT_EQ(indices.back(), 99);
+  EXPECT_TRUE(std::is_sorted(indices.begin(), indices.end()));
+  // the spike survives downsampling
+  EXPECT_NE(std::find(indices.begin(), indices.end(), 42), indices.end());
+
+  EXPECT_EQ(xviz::util::LargestTriangleThreeBuckets(x, y, 200).size(), 100);
+}
+
+}  // namespace xviz::tests
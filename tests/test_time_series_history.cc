@@ -0,0 +1,142 @@
+/*
+ * Project: libxviz
+ * Description: C++ Implementation of XVIZ Protocol
+ * Author: Minjun Xu (mjxu96@outlook.com)
+ * -----
+ * MIT License
+ * Copyright (c) 2023 Minjun Xu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <xviz/xviz.h>
+
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+namespace xviz::tests {
+
+class TimeSeriesHistoryTest : public ::testing::Test {
+ public:
+  void SetUp() override {}
+
+  void TearDown() override {}
+
+  static std::vector<double> Timestamps(const std::vector<Frame>& frames) {
+    std::vector<double> ret;
+    for (const auto& frame : frames) {
+      for (const auto& update : frame.Data().updates()) {
+        ret.push_back(update.timestamp());
+      }
+    }
+    return ret;
+  }
+};
+
+TEST_F(TimeSeriesHistoryTest, RingTest) {
+  TimeSeriesHistory history;
+  auto speed = history.Register("/speed", {8, 60});
+  auto steer = history.Register("/steer", {8, 60});
+  for (int i = 0; i < 20; i++) {
+    history.Push(speed, i, i * 2.0);
+    history.Push(steer, i, -i);
+  }
+
+  // the last 8 samples, three StreamSets per frame
+  auto frames = history.Backfill(3);
+  ASSERT_EQ(frames.size(), 3);
+  EXPECT_EQ(frames[0].Data().updates_size(), 3);
+  EXPECT_EQ(frames[2].Data().updates_size(), 2);
+  EXPECT_EQ(frames[0].Data().update_type(), StateUpdate::INCREMENTAL);
+  EXPECT_EQ(Timestamps(frames),
+            (std::vector<double>{12, 13, 14, 15, 16, 17, 18, 19}));
+
+  const auto& update = frames[0].Data().updates(0);
+  ASSERT_EQ(update.time_series_size(), 1);
+  const auto& time_series = update.time_series(0);
+  EXPECT_EQ(time_series.timestamp(), 12);
+  ASSERT_EQ(time_series.streams_size(), 2);
+  EXPECT_EQ(time_series.streams(0), "/speed");
+  EXPECT_EQ(time_series.values().doubles(0), 24);
+  EXPECT_EQ(time_series.streams(1), "/steer");
+  EXPECT_EQ(time_series.values().doubles(1), -12);
+}
+
+TEST_F(TimeSeriesHistoryTest, WindowAndRecordTest) {
+  TimeSeriesHistory history;
+  history.Register("/speed", {64, 3});
+  history.Register("/gear");
+  Builder builder;
+  for (int i = 0; i < 10; i++) {
+    builder.TimeSeries("/speed").Timestamp(i).Value(double(i));
+    builder.TimeSeries("/gear").Timestamp(i).Value(i % 4);
+    builder.TimeSeries("/ignored").Timestamp(i).Value(1.0);
+    builder.TimeSeries("/speed").Timestamp(i).Value(1.0).ID("object-1");
+    history.Record(builder.Finish().Data());
+  }
+
+  auto frames = history.Backfill();
+  ASSERT_EQ(frames.size(), 1);
+  const auto& updates = frames[0].Data().updates();
+  ASSERT_EQ(updates.size(), 10);
+  // /speed keeps its last 3 seconds only
+  for (const auto& update : updates) {
+    int streams = 0;
+    for (const auto& time_series : update.time_series()) {
+      EXPECT_TRUE(time_series.object_id().empty());
+      streams += time_series.streams_size();
+    }
+    EXPECT_EQ(streams, update.timestamp() >= 6 ? 2 : 1);
+  }
+  EXPECT_EQ(updates[9].time_series(0).values().doubles(1), 1);
+}
+
+TEST_F(TimeSeriesHistoryTest, ConcurrentPushTest) {
+  TimeSeriesHistory history;
+  auto handle = history.Register("/speed", {256, 1e9});
+  std::vector<std::thread> writers;
+  for (int writer = 0; writer < 4; writer++) {
+    writers.emplace_back([&history, handle]() {
+      for (int i = 0; i < 10000; i++) {
+        history.Push(handle, i, i);
+      }
+    });
+  }
+  for (int read = 0; read < 20; read++) {
+    for (const auto& frame : history.Backfill()) {
+      for (const auto& update : frame.Data().updates()) {
+        for (const auto& time_series : update.time_series()) {
+          for (double value : time_series.values().doubles()) {
+            EXPECT_EQ(value, time_series.timestamp());
+          }
+        }
+      }
+    }
+  }
+  for (auto& writer : writers) {
+    writer.join();
+  }
+  auto timestamps = Timestamps(history.Backfill());
+  EXPECT_FALSE(timestamps.empty());
+  EXPECT_EQ(timestamps.back(), 9999);
+}
+
+}  // namespace xviz::tests
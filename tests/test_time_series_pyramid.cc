@@ -0,0 +1,124 @@
+/*
+ * Project: libxviz
+ * Description: C++ Implementation of XVIZ Protocol
+ * Author: Minjun Xu (mjxu96@outlook.com)
+ * -----
+ * MIT License
+ * Copyright (c) 2023 Minjun Xu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <xviz/xviz.h>
+#include <xviz/utils/time_series_pyramid.h>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace xviz::tests {
+
+class TimeSeriesPyramidTest : public ::testing::Test {
+ public:
+  void SetUp() override {}
+
+  void TearDown() override {}
+};
+
+TEST_F(TimeSeriesPyramidTest, MatchesScanTest) {
+  std::mt19937 random(7);
+  std::uniform_real_distribution<double> values(-100, 100);
+  std::vector<double> timestamps;
+  std::vector<double> samples;
+  TimeSeriesPyramid pyramid;
+  double timestamp = 0;
+  for (int i = 0; i < 1000; i++) {
+    // a few repeated timestamps as well
+    timestamp += i % 7 == 0 ? 0 : 0.1 * (1 + i % 3);
+    timestamps.push_back(timestamp);
+    samples.push_back(values(random));
+    pyramid.Add("/speed", timestamps.back(), samples.back());
+  }
+  EXPECT_EQ(pyramid.SampleCount("/speed"), 1000);
+
+  std::uniform_real_distribution<double> times(-10, timestamp + 10);
+  for (int query = 0; query < 50; query++) {
+    double begin = times(random);
+    double end = begin + std::abs(times(random));
+    std::size_t count = 1 + query % 13;
+    auto buckets = pyramid.Buckets("/speed", begin, end, count);
+    ASSERT_EQ(buckets.size(), count);
+    EXPECT_EQ(buckets.front().begin, begin);
+    EXPECT_EQ(buckets.back().end, end);
+    for (const auto& bucket : buckets) {
+      PlotBucket expected;
+      double sum = 0;
+      for (std::size_t i = 0; i < timestamps.size(); i++) {
+        bool inside = timestamps[i] >= bucket.begin &&
+                      (timestamps[i] < bucket.end ||
+                       (&bucket == &buckets.back() && timestamps[i] == end));
+        if (!inside) {
+          continue;
+        }
+        expected.min = expected.count ? std::min(expected.min, samples[i])
+                                      : samples[i];
+        expected.max = expected.count ? std::max(expected.max, samples[i])
+                                      : samples[i];
+        sum += samples[i];
+        expected.count++;
+      }
+      ASSERT_EQ(bucket.count, expected.count);
+      if (expected.count > 0) {
+        EXPECT_EQ(bucket.min, expected.min);
+        EXPECT_EQ(bucket.max, expected.max);
+        EXPECT_NEAR(bucket.mean, sum / double(expected.count), 1e-9);
+      }
+    }
+  }
+}
+
+TEST_F(TimeSeriesPyramidTest, RecordTest) {
+  TimeSeriesPyramid pyramid;
+  Builder builder;
+  for (int i = 0; i < 10; i++) {
+    builder.TimeSeries("/speed").Timestamp(i).Value(double(i));
+    builder.TimeSeries("/gear").Timestamp(i).Value(i % 4);
+    builder.TimeSeries("/speed").Timestamp(i).Value(100.0).ID("object-1");
+    pyramid.Record(builder.Finish().Data());
+  }
+  EXPECT_EQ(pyramid.SampleCount("/speed"), 10);
+  EXPECT_EQ(pyramid.SampleCount("/gear"), 10);
+  EXPECT_EQ(pyramid.SampleCount("/other"), 0);
+
+  auto buckets = pyramid.Buckets("/speed", 0, 10, 2);
+  ASSERT_EQ(buckets.size(), 2);
+  EXPECT_EQ(buckets[0].count, 5);
+  EXPECT_EQ(buckets[0].min, 0);
+  EXPECT_EQ(buckets[0].max, 4);
+  EXPECT_EQ(buckets[0].mean, 2);
+  EXPECT_EQ(buckets[1].count, 5);
+  EXPECT_EQ(buckets[1].max, 9);
+  EXPECT_EQ(pyramid.Buckets("/gear", 0, 9, 1)[0].max, 3);
+
+  EXPECT_THROW(pyramid.Add("/speed", 5, 1), std::runtime_error);
+}
+
+}  // namespace xviz::tests
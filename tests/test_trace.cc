@@ -0,0 +1,125 @@
+/*
+ * Project: libxviz
+ * Description: C++ Implementation of XVIZ Protocol
+ * Author: Minjun Xu (mjxu96@outlook.com)
+ * -----
+ * MIT License
+ * Copyright (c) 2023 Minjun Xu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <xviz/xviz.h>
+#include <xviz/utils/trace.h>
+#include "utils/cleanup.h"
+
+#include <google/protobuf/struct.pb.h>
+#include <google/protobuf/util/json_util.h>
+#include <gtest/gtest.h>
+
+#include <string>
+#include <thread>
+
+namespace xviz::tests {
+
+class TraceTest : public ::testing::Test {
+ public:
+  void SetUp() override {}
+
+  void TearDown() override { trace::Disable(); }
+
+  static std::size_t CountEvents(std::string_view name) {
+    std::size_t count = 0;
+    for (const auto& event : trace::Collect()) {
+      count += event.name == name;
+    }
+    return count;
+  }
+};
+
+TEST_F(TraceTest, DisabledTest) {
+  trace::Disable();
+  { trace::Span span("TraceTest::Disabled"); }
+  EXPECT_EQ(CountEvents("TraceTest::Disabled"), 0);
+}
+
+TEST_F(TraceTest, BuilderTest) {
+  trace::Enable();
+  Builder builder;
+  // clang-format off
+  builder
+    .Primitive("/trace/shape")
+      .Polygon({{0, 0, 0}, {1, 0, 0}, {1, 1, 0}})
+    .TimeSeries("/trace/speed")
+      .Timestamp(1)
+      .Value(1.0)
+    .Primitive("/trace/shape")
+      .Polygon({{0, 0, 0}, {2, 0, 0}, {2, 2, 0}});
+  // clang-format on
+  Message<StateUpdate> message(builder.GetData());
+  message.ToProtobufBinary();
+
+  EXPECT_EQ(CountEvents("/trace/shape"), 2);
+  EXPECT_EQ(CountEvents("/trace/speed"), 1);
+  EXPECT_GE(CountEvents("Builder::GetData"), 1);
+  EXPECT_GE(CountEvents("Message::ToProtobufBinary"), 1);
+
+  bool found = false;
+  for (const auto& event : trace::Collect()) {
+    if (event.name == "/trace/speed") {
+      EXPECT_EQ(event.category, "builder");
+      found = true;
+    }
+  }
+  EXPECT_TRUE(found);
+}
+
+TEST_F(TraceTest, RingTest) {
+  trace::Enable(4);
+  std::thread thread([]() {
+    for (int i = 0; i < 10; i++) {
+      trace::Span span("TraceTest::Ring");
+    }
+  });
+  thread.join();
+  EXPECT_EQ(CountEvents("TraceTest::Ring"), 4);
+}
+
+TEST_F(TraceTest, ChromeTraceTest) {
+  trace::Enable();
+  { trace::Span span("TraceTest::\"Chrome\"", "test"); }
+
+  auto json = trace::DumpChromeTrace();
+  google::protobuf::Struct trace;
+  ASSERT_TRUE(google::protobuf::util::JsonStringToMessage(json, &trace).ok());
+  const auto& events = trace.fields().at("traceEvents").list_value();
+  bool found = false;
+  for (const auto& value : events.values()) {
+    const auto& event = value.struct_value().fields();
+    if (event.at("name").string_value() == "TraceTest::\"Chrome\"") {
+      EXPECT_EQ(event.at("cat").string_value(), "test");
+      EXPECT_EQ(event.at("ph").string_value(), "X");
+      EXPECT_GE(event.at("dur").number_value(), 0);
+      found = true;
+    }
+  }
+  EXPECT_TRUE(found);
+}
+
+}  // namespace xviz::tests
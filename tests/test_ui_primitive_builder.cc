@@ -0,0 +1,139 @@
+/*
+ * Project: libxviz
+ * Description: C++ Implementation of XVIZ Protocol
+ * Author: Minjun Xu (mjxu96@outlook.com)
+ * -----
+ * MIT License
+ * Copyright (c) 2023 Minjun Xu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <xviz/xviz.h>
+#include "utils/cleanup.h"
+
+#include <google/protobuf/util/message_differencer.h>
+#include <gtest/gtest.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace xviz::tests {
+
+class UIPrimitiveBuilderTest : public ::testing::Test {
+ public:
+  void SetUp() override {}
+
+  void TearDown() override {}
+
+  xviz::Builder builder_;
+  std::vector<int> ids_ = {0, 1, 2};
+  std::vector<int> parents_ = {0, 0, 1};
+  std::vector<int> ints_ = {1, -2, 3};
+  std::vector<double> doubles_ = {0.1, 2.5, -3e10};
+  std::vector<std::string> strings_ = {"one", "two", "three"};
+};
+
+TEST_F(UIPrimitiveBuilderTest, ColumnarRowsSameAsRowTest) {
+  // clang-format off
+  auto expected = builder_
+    .UIPrimitive("/test/table")
+      .Column("int", xviz::TreeTableColumn::INT32)
+      .Column("double", xviz::TreeTableColumn::DOUBLE)
+      .Column("string", xviz::TreeTableColumn::STRING)
+        .Row(0, 0, {1, 0.1, "one"})
+        .Row(1, 0, {-2, 2.5, "two"})
+        .Row(2, 1, {3, -3e10, "three"})
+    .GetData();
+  builder_.Reset();
+  auto& msg = builder_
+    .UIPrimitive("/test/table")
+      .Column("int", xviz::TreeTableColumn::INT32)
+      .Column("double", xviz::TreeTableColumn::DOUBLE)
+      .Column("string", xviz::TreeTableColumn::STRING)
+        .Rows(ids_, parents_, {ints_, doubles_, strings_})
+    .GetData();
+  // clang-format on
+
+  EXPECT_TRUE(
+      google::protobuf::util::MessageDifferencer::Equals(expected, msg));
+}
+
+TEST_F(UIPrimitiveBuilderTest, ColumnarRowsWrongTypeTest) {
+  auto& ui_builder = builder_.UIPrimitive("/test/table")
+                         .Column("int", xviz::TreeTableColumn::INT32)
+                         .Column("double", xviz::TreeTableColumn::DOUBLE);
+  EXPECT_THROW(ui_builder.Rows(ids_, {doubles_, doubles_}), std::runtime_error);
+  EXPECT_THROW(ui_builder.Rows(ids_, {ints_}), std::runtime_error);
+  std::vector<int> too_few_ids = {0, 1};
+  EXPECT_THROW(ui_builder.Rows(too_few_ids, {ints_, doubles_}),
+               std::runtime_error);
+}
+
+TEST_F(UIPrimitiveBuilderTest, ColumnarTreeTableUpdateRowsTest) {
+  xviz::ColumnarTreeTable table;
+  table.Column("int", xviz::TreeTableColumn::INT32)
+      .Column("string", xviz::TreeTableColumn::STRING)
+      .Rows(ids_, {ints_, strings_});
+
+  ints_[1] = 42;
+  strings_[0] = "changed but not updated";
+  std::vector<uint32_t> changed = {1};
+  table.UpdateRows(changed, {ints_, strings_});
+
+  auto& msg = builder_.UIPrimitive("/test/table").TreeTable(table).GetData();
+  const auto& nodes =
+      msg.updates(0).ui_primitives().at("/test/table").treetable().nodes();
+  ASSERT_EQ(nodes.size(), 3);
+  EXPECT_EQ(nodes[1].column_values(0), "42");
+  EXPECT_EQ(nodes[1].column_values(1), "two");
+  // row 0 is not marked as changed
+  EXPECT_EQ(nodes[0].column_values(1), "one");
+}
+
+TEST_F(UIPrimitiveBuilderTest, ColumnarTreeTableMoveTest) {
+  xviz::ColumnarTreeTable table;
+  table.Column("int", xviz::TreeTableColumn::INT32)
+      .Column("string", xviz::TreeTableColumn::STRING)
+      .Rows(ids_, {ints_, strings_});
+
+  std::vector<const xviz::TreeTableNode*> rows;
+  std::vector<const char*> cells;
+  for (const auto& node : table.Data().nodes()) {
+    rows.push_back(&node);
+    cells.push_back(node.column_values(1).data());
+  }
+
+  auto& msg = builder_.UIPrimitive("/test/table")
+                  .TreeTable(std::move(table))
+                  .GetData();
+  const auto& nodes =
+      msg.updates(0).ui_primitives().at("/test/table").treetable().nodes();
+  ASSERT_EQ(nodes.size(), 3);
+  for (int idx = 0; idx < nodes.size(); idx++) {
+    // the rows are handed over as they are, not copied or formatted again
+    EXPECT_EQ(&nodes[idx], rows[idx]);
+    EXPECT_EQ(nodes[idx].column_values(1).data(), cells[idx]);
+  }
+  EXPECT_EQ(nodes[1].column_values(1), "two");
+  EXPECT_EQ(table.Data().nodes_size(), 0);
+}
+
+}  // namespace xviz::tests
@@ -0,0 +1,178 @@
+/*
+ * Project: libxviz
+ * Description: C++ Implementation of XVIZ Protocol
+ * Author: Minjun Xu (mjxu96@outlook.com)
+ * -----
+ * MIT License
+ * Copyright (c) 2023 Minjun Xu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <xviz/xviz.h>
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <vector>
+
+namespace xviz::tests {
+
+class UpdateBatcherTest : public ::testing::Test {
+ public:
+  void SetUp() override {}
+
+  void TearDown() override {}
+
+  static Frame BuildFrame(Builder& builder, double timestamp) {
+    // clang-format off
+    builder
+      .Timestamp(timestamp)
+      .Primitive("/object/shape")
+        .Polygon({{1, 2, 3}, {4, 5, 6}, {7, 8, 9}})
+      .TimeSeries("/speed")
+        .Timestamp(timestamp)
+        .Value(timestamp);
+    // clang-format on
+    return builder.Finish();
+  }
+};
+
+TEST_F(UpdateBatcherTest, NextUpdateTest) {
+  Builder builder;
+  auto image = std::make_shared<const std::string>("image");
+  // clang-format off
+  builder
+    .Timestamp(1)
+    .Primitive("/object/shape")
+      .Polygon({{1, 2, 3}, {4, 5, 6}, {7, 8, 9}})
+    .NextUpdate()
+    .Timestamp(2)
+    .Primitive("/object/shape")
+      .Polygon({{1, 2, 3}, {4, 5, 6}, {7, 8, 9}})
+      .Polygon({{1, 2, 3}, {4, 5, 6}, {7, 8, 9}})
+    .Primitive("/camera")
+      .Image(ImageBuffer(image));
+  // clang-format on
+  EXPECT_EQ(builder.UpdateCount(), 2);
+
+  const auto& data = builder.GetData();
+  ASSERT_EQ(data.updates_size(), 2);
+  EXPECT_EQ(data.updates(0).timestamp(), 1);
+  EXPECT_EQ(data.updates(1).timestamp(), 2);
+  EXPECT_EQ(data.updates(0).primitives().at("/object/shape").polygons_size(),
+            1);
+  EXPECT_EQ(data.updates(1).primitives().at("/object/shape").polygons_size(),
+            2);
+  auto images = builder.ImageReferences();
+  ASSERT_EQ(images.size(), 1);
+  EXPECT_EQ(images[0].update_index, 1);
+
+  builder.Reset();
+  EXPECT_EQ(builder.UpdateCount(), 1);
+}
+
+TEST_F(UpdateBatcherTest, CountTest) {
+  std::vector<Frame> sent;
+  auto sink = [&](Frame&& frame) { sent.push_back(std::move(frame)); };
+  BatchOption option;
+  option.max_updates = 3;
+  option.max_window = 100;
+  UpdateBatcher batcher(sink, option);
+  Builder builder;
+  for (int i = 0; i < 7; i++) {
+    batcher.Add(BuildFrame(builder, i));
+  }
+  ASSERT_EQ(sent.size(), 2);
+  EXPECT_EQ(batcher.PendingUpdates(), 1);
+  batcher.Flush();
+  ASSERT_EQ(sent.size(), 3);
+  EXPECT_EQ(batcher.PendingUpdates(), 0);
+
+  EXPECT_EQ(sent[0].Data().updates_size(), 3);
+  EXPECT_EQ(sent[2].Data().updates_size(), 1);
+  for (int i = 0; i < 7; i++) {
+    const auto& update = sent[i / 3].Data().updates(i % 3);
+    EXPECT_EQ(update.timestamp(), i);
+    EXPECT_EQ(update.primitives().at("/object/shape").polygons_size(), 1);
+    EXPECT_EQ(update.time_series_size(), 1);
+  }
+}
+
+TEST_F(UpdateBatcherTest, WindowAndTypeTest) {
+  std::vector<Frame> sent;
+  auto sink = [&](Frame&& frame) { sent.push_back(std::move(frame)); };
+  BatchOption option;
+  option.max_window = 0.25;
+  UpdateBatcher batcher(sink, option);
+  Builder builder;
+  for (int i = 0; i < 6; i++) {
+    batcher.Add(BuildFrame(builder, i * 0.1));
+  }
+  // 0, 0.1, 0.2 | 0.3, 0.4, 0.5
+  ASSERT_EQ(sent.size(), 1);
+  EXPECT_EQ(sent[0].Data().updates_size(), 3);
+
+  auto incremental = BuildFrame(builder, 0.55);
+  incremental.MutableData().set_update_type(StateUpdate::INCREMENTAL);
+  batcher.Add(std::move(incremental));
+  ASSERT_EQ(sent.size(), 2);
+  EXPECT_EQ(sent[1].Data().updates_size(), 3);
+  EXPECT_EQ(sent[1].Data().update_type(), StateUpdate::SNAPSHOT);
+  batcher.Flush();
+  ASSERT_EQ(sent.size(), 3);
+  EXPECT_EQ(sent[2].Data().update_type(), StateUpdate::INCREMENTAL);
+}
+
+TEST_F(UpdateBatcherTest, ImageTest) {
+  std::vector<Frame> sent;
+  auto sink = [&](Frame&& frame) { sent.push_back(std::move(frame)); };
+  BatchOption option;
+  option.max_bytes = 64 * 1024;
+  option.max_window = 100;
+  UpdateBatcher batcher(sink, option);
+  Builder builder;
+  auto image = std::make_shared<const std::string>(40 * 1024, 'x');
+  for (int i = 0; i < 3; i++) {
+    builder.Timestamp(i).Primitive("/camera").Image(ImageBuffer(image));
+    batcher.Add(builder.Finish());
+  }
+  batcher.Flush();
+  // each batch holds at most one image of 40KB
+  ASSERT_EQ(sent.size(), 3);
+
+  Builder other;
+  other.Timestamp(0).Primitive("/object/shape").Polygon({{1, 2, 3}});
+  batcher.Add(other.Finish());
+  builder.Timestamp(1).Primitive("/camera").Image(ImageBuffer(image));
+  batcher.Add(builder.Finish());
+  batcher.Flush();
+  ASSERT_EQ(sent.size(), 4);
+  ASSERT_EQ(sent[3].ImageReferences().size(), 1);
+  EXPECT_EQ(sent[3].ImageReferences()[0].update_index, 1);
+  const auto& batch = sent[3].Data();
+  const auto& found =
+      util::FindReferencedImage(batch, sent[3].ImageReferences()[0]);
+  EXPECT_EQ(&found, &batch.updates(1).primitives().at("/camera").images(0));
+
+  Message<StateUpdate> message(std::move(sent[3]));
+  EXPECT_FALSE(message.ToProtobufBinary().empty());
+}
+
+}  // namespace xviz::tests
@@ -0,0 +1,200 @@
+/*
+ * Project: libxviz
+ * Description: C++ Implementation of XVIZ Protocol
+ * Author: Minjun Xu (mjxu96@outlook.com)
+ * -----
+ * MIT License
+ * Copyright (c) 2023 Minjun Xu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <xviz/xviz.h>
+#include "utils/cleanup.h"
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <string>
+#include <vector>
+
+namespace xviz::tests {
+
+class ValidatorTest : public ::testing::Test {
+ public:
+  void SetUp() override {
+    // clang-format off
+    meta_builder_
+      .Stream("/vehicle_pose")
+        .Category<xviz::StreamMetadata::POSE>()
+      .Stream("/object/shape")
+        .Category(xviz::StreamMetadata::PRIMITIVE)
+        .Type(xviz::StreamMetadata::POLYGON)
+        .Coordinate(xviz::StreamMetadata::VEHICLE_RELATIVE)
+      .Stream("/vehicle/speed")
+        .Category<xviz::StreamMetadata::TIME_SERIES>()
+          .Type(xviz::StreamMetadata::FLOAT);
+    // clang-format on
+  }
+
+  void TearDown() override {}
+
+  void BuildValidUpdate() {
+    // clang-format off
+    builder_
+      .Pose("/vehicle_pose")
+        .Position(0, 0, 0)
+      .Primitive("/object/shape")
+        .Polygon({{0, 0, 0}, {1, 0, 0}, {1, 1, 0}})
+      .TimeSeries("/vehicle/speed")
+        .Timestamp(1)
+        .Value(1.0);
+    // clang-format on
+  }
+
+  xviz::MetadataBuilder meta_builder_;
+  xviz::Builder builder_;
+};
+
+TEST_F(ValidatorTest, ValidUpdateTest) {
+  Validator validator(meta_builder_.GetData());
+  BuildValidUpdate();
+  EXPECT_EQ(validator.Validate(builder_.GetData()), 0);
+  EXPECT_EQ(validator.UpdatesChecked(), 1);
+  EXPECT_EQ(validator.TotalViolations(), 0);
+}
+
+TEST_F(ValidatorTest, ViolationsTest) {
+  std::vector<Violation> violations;
+  std::vector<std::string> stream_ids;
+  ValidatorOption option;
+  option.callback = [&](const Violation& violation) {
+    violations.push_back(violation);
+    stream_ids.emplace_back(violation.stream_id);
+  };
+  Validator validator(meta_builder_.GetData(), option);
+
+  // clang-format off
+  builder_
+    .Primitive("/object/shape")
+      .Polygon({{0, 0, 0}, {1, 0, 0}, {1, 1, 0}})
+      .Circle(std::array<float, 3>{0, 0, 0}, 1)
+    .Primitive("/object/unknown")
+      .Circle({0, 0, 0}, 1)
+    .Pose("/object/shape")
+    .TimeSeries("/vehicle/speed")
+      .Timestamp(1)
+      .Value("fast");
+  // clang-format on
+
+  EXPECT_EQ(validator.Validate(builder_.GetData()), 4);
+  EXPECT_EQ(validator.Violations(ViolationType::UNKNOWN_STREAM), 1);
+  EXPECT_EQ(validator.Violations(ViolationType::WRONG_CATEGORY), 1);
+  EXPECT_EQ(validator.Violations(ViolationType::WRONG_PRIMITIVE_TYPE), 1);
+  EXPECT_EQ(validator.Violations(ViolationType::WRONG_SCALAR_TYPE), 1);
+  // the pose sent on /object/shape is not a vehicle pose either
+  EXPECT_EQ(validator.Violations(ViolationType::MISSING_POSE), 0);
+  ASSERT_EQ(violations.size(), 4);
+  for (std::size_t i = 0; i < violations.size(); i++) {
+    EXPECT_EQ(violations[i].update_index, 0);
+    if (violations[i].type == ViolationType::WRONG_SCALAR_TYPE) {
+      EXPECT_EQ(stream_ids[i], "/vehicle/speed");
+    }
+  }
+}
+
+TEST_F(ValidatorTest, MissingPoseTest) {
+  Validator validator(meta_builder_.GetData());
+  builder_.Primitive("/object/shape").Polygon({{0, 0, 0}, {1, 0, 0}});
+  auto& data = builder_.GetData();
+  data.set_update_type(StateUpdate::COMPLETE_STATE);
+  EXPECT_EQ(validator.Validate(data), 1);
+  EXPECT_EQ(validator.Violations(ViolationType::MISSING_POSE), 1);
+
+  // the pose may be sent earlier for incremental updates
+  data.set_update_type(StateUpdate::SNAPSHOT);
+  EXPECT_EQ(validator.Validate(data), 0);
+  data.set_update_type(StateUpdate::INCREMENTAL);
+  EXPECT_EQ(validator.Validate(data), 0);
+}
+
+TEST_F(ValidatorTest, NoDataAndLinksTest) {
+  std::vector<std::string> stream_ids;
+  ValidatorOption option;
+  option.callback = [&](const Violation& violation) {
+    stream_ids.emplace_back(violation.stream_id);
+  };
+  Validator validator(meta_builder_.GetData(), option);
+
+  BuildValidUpdate();
+  auto& stream_set = *builder_.GetData().mutable_updates(0);
+  stream_set.add_no_data_streams("/vehicle/speed");
+  (*stream_set.mutable_links())["/object/shape"].set_target_pose(
+      "/vehicle_pose");
+  EXPECT_EQ(validator.Validate(builder_.GetData()), 0);
+
+  stream_set.add_no_data_streams("/object/unknown");
+  (*stream_set.mutable_links())["/object/other"].set_target_pose(
+      "/object/shape");
+  EXPECT_EQ(validator.Validate(builder_.GetData()), 3);
+  EXPECT_EQ(validator.Violations(ViolationType::UNKNOWN_STREAM), 2);
+  EXPECT_EQ(validator.Violations(ViolationType::WRONG_CATEGORY), 1);
+  EXPECT_EQ(stream_ids, (std::vector<std::string>{
+                            "/object/unknown", "/object/other",
+                            "/object/shape"}));
+}
+
+TEST_F(ValidatorTest, BuilderValidateTest) {
+  Validator validator(meta_builder_.GetData());
+  builder_.Validate(&validator);
+  builder_.Primitive("/object/unknown").Circle({0, 0, 0}, 1);
+  builder_.GetData();
+  // a frame is only checked once
+  builder_.Finish();
+  EXPECT_EQ(validator.UpdatesChecked(), 1);
+  EXPECT_EQ(validator.Violations(ViolationType::UNKNOWN_STREAM), 1);
+
+  BuildValidUpdate();
+  builder_.Finish();
+  EXPECT_EQ(validator.UpdatesChecked(), 2);
+  EXPECT_EQ(validator.TotalViolations(), 1);
+
+  builder_.Validate(nullptr);
+  builder_.Primitive("/object/unknown").Circle({0, 0, 0}, 1);
+  builder_.Finish();
+  EXPECT_EQ(validator.UpdatesChecked(), 2);
+}
+
+TEST_F(ValidatorTest, SampleTest) {
+  ValidatorOption option;
+  option.sample_every = 4;
+  Validator validator(meta_builder_.GetData(), option);
+  builder_.Primitive("/object/unknown").Circle({0, 0, 0}, 1);
+  const auto& data = builder_.GetData();
+  std::size_t found = 0;
+  for (int i = 0; i < 8; i++) {
+    found += validator.Validate(data);
+  }
+  EXPECT_EQ(found, 2);
+  EXPECT_EQ(validator.UpdatesSeen(), 8);
+  EXPECT_EQ(validator.UpdatesChecked(), 2);
+  EXPECT_EQ(validator.Violations(ViolationType::UNKNOWN_STREAM), 2);
+}
+
+}  // namespace xviz::tests